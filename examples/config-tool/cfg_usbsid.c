@@ -233,6 +233,12 @@ static int import_ini(void* user, const char* section, const char* name, const c
     if (p != 666) ini_config->FMOpl.enabled = p;
   }
 
+  /* ASID */
+  if (MATCH("ASID", "latency")) {
+    p = atoi(value);
+    if (p >= 1 && p <= 64) ini_config->Asid.latency = p;
+  }
+
   /* Audio switch (v1.3+) */
   if (MATCH("Audioswitch", "set_to")) {
     p = value_position(value, mono_stereo);
@@ -326,6 +332,11 @@ void write_config_ini(Config * config, char * filename)
     fprintf(f, "enabled = %s\n", truefalse[config->FMOpl.enabled]);
     fprintf(f, "\n");
 
+    fprintf(f, "[ASID]\n");
+    fprintf(f, "; Buffer latency in frames 1 ~ 64, lower for live play, higher for busy hosts\n");
+    fprintf(f, "latency = %d\n", config->Asid.latency);
+    fprintf(f, "\n");
+
     fprintf(f, "[Audioswitch]\n");
     fprintf(f, "; Possible options: %s, %s\n", mono_stereo[0], mono_stereo[1]);
     fprintf(f, "set_to = %s\n", mono_stereo[config->stereo_en]);
@@ -517,6 +528,9 @@ void write_config(Config * config)
   /* FMOpl */
   write_config_command(SET_CONFIG,0x9,config->FMOpl.enabled,0,0);
 
+  /* ASID */
+  write_config_command(SET_CONFIG,0x10,config->Asid.latency,0,0);
+
   /* Audio switch (works on PCB v1.3+ only) */
   write_config_command(SET_CONFIG,0xA,config->stereo_en,0,0);
   write_config_command(SET_CONFIG,0xB,config->lock_audio_sw,0,0);
@@ -713,6 +727,10 @@ void set_cfg_from_buffer(const uint8_t * buff, size_t len)
         break;
       case 58:
         usbsid_config.lock_audio_sw = buff[i];
+        break;
+      case 59:
+        usbsid_config.Asid.latency = buff[i];
+        break;
       case 60:
         usbsid_config.mirrored = (buff[i] & 0b1);
         usbsid_config.flipped  = ((buff[i] & 0b10) >> 1);
@@ -847,6 +865,8 @@ void print_config(void)
     enabled[(int)usbsid_config.Midi.enabled]);
   printf("  ASID feature = %s\n",
     enabled[(int)usbsid_config.Asid.enabled]);
+  printf("  ASID latency = %d frames\n",
+    (int)usbsid_config.Asid.latency);
   printf("\n");
   printf("Verification of socket change detection on boot = %s\n",
     enabled[(int)!usbsid_config.disable_changedetect]);
@@ -1554,6 +1574,8 @@ void print_help(void)
   printf("  -rs,      --read-sock-config  : Read and print USBSID-Pico socket config settings only\n");
   printf("  -rn,      --read-num-sids     : Read and print USBSID-Pico configured number of SID's only\n");
   printf("  -rn,      --read-num-sids     : Read and print USBSID-Pico configured number of SID's only\n");
+  printf("  -rb,      --read-boot-state   : Read and print USBSID-Pico boot stage and boot timing\n");
+  printf("  -rci,     --read-clock-info   : Read and print USBSID-Pico system clock, SID clock divider, error and jitter\n");
   printf("  -ack,     --acknowledge       : Acknowledge the configuration to apply voltage to the sockets (v1.5+ only!)\n");
   printf("                                  __MAKE SURE YOU READ AND VERIFY THE CONFIG FIRST!__  (v1.5+ only!)\n");
   printf("  -a,       --apply-config      : Apply the current config settings (from USBSID-Pico memory) that you changed with '-w'\n");
@@ -1618,6 +1640,8 @@ void print_help(void)
   printf("  -au ,     --audio-switch N    : Set the mono/stereo audio switch (PCB v1.3+ only!)\n");
   printf("                                  0: %s, 1:%s\n", mono_stereo[0], mono_stereo[1]);
   printf("  -la N,    --lockaudio N       : Lock the audio switch from being changed: True (1) False (0)\n");
+  printf("  -lat N,   --asid-latency N    : Set the ASID buffer latency to N frames (1 ~ 64)\n");
+  printf("                                  ~1 for live play, 10+ for playback on a busy host\n");
   printf("  -sock N,  --socket N          : Configure socket N ~ 1 or 2\n");
   printf("  The following options additionally require '-sock N'\n");
   printf("  Note that you can only configure 1 socket at a time!\n");
@@ -1847,6 +1871,40 @@ void config_usbsidpico(int argc, char **argv)
       printf("USBSID-Pico is configured to use %d SID's\n", read_data[0]);
       break;
     }
+    if (!strcmp(argv[param_count], "-rb") || !strcmp(argv[param_count], "--read-boot-state")) {
+      const char *stages[] = { "Hardware", "SID states", "Detection", "Socket verification", "Ready" };
+      printf("Reading boot state\n");
+      write_config_command(READ_BOOTSTATE, 0x0, 0x0, 0x0, 0x0);
+      int len;
+      len = read_chars(read_data, count_of(read_data));
+      if (debug == 1) printf("Read %d byte of data, byte 0 = %02X\n", len, read_data[0]);
+      uint32_t ms[3];
+      for (int i = 0; i < 3; i++) {
+        ms[i] = ((uint32_t)read_data[2 + (i * 4)] << 24 | read_data[3 + (i * 4)] << 16 | read_data[4 + (i * 4)] << 8 | read_data[5 + (i * 4)]);
+      }
+      printf("Boot stage: %s (%s)\n", (read_data[0] < count_of(stages) ? stages[read_data[0]] : "Unknown"), (read_data[1] ? "ready" : "not ready"));
+      printf("USB connected after %u ms, mounted after %u ms, ready after %u ms\n", ms[0], ms[1], ms[2]);
+      break;
+    }
+    if (!strcmp(argv[param_count], "-rci") || !strcmp(argv[param_count], "--read-clock-info")) {
+      printf("Reading clock info\n");
+      write_config_command(GET_CLOCKINFO, 0x0, 0x0, 0x0, 0x0);
+      int len;
+      len = read_chars(read_data, count_of(read_data));
+      if (debug == 1) printf("Read %d byte of data, byte 0 = %02X\n", len, read_data[0]);
+      uint32_t v[4];
+      for (int i = 0; i < 4; i++) {  /* sysclk, requested, achieved, error */
+        v[i] = ((uint32_t)read_data[(i * 4)] << 24 | read_data[1 + (i * 4)] << 16 | read_data[2 + (i * 4)] << 8 | read_data[3 + (i * 4)]);
+      }
+      uint16_t jitter = (read_data[16] << 8 | read_data[17]);
+      float sid_div = ((read_data[18] << 8 | read_data[19]) + (read_data[20] / 256.0f));
+      float bus_div = ((read_data[21] << 8 | read_data[22]) + (read_data[23] / 256.0f));
+      printf("System clock: %u Hz%s\n", v[0], (read_data[24] ? " (tuned for this SID clock)" : ""));
+      printf("SID clock: %u Hz requested, %u Hz achieved, error %.3f ppm\n", v[1], v[2], ((int32_t)v[3] / 1000.0));
+      printf("PHI1 divider: %.4f, jitter %u ps\n", sid_div, jitter);
+      printf("BUS divider: %.4f\n", bus_div);
+      break;
+    }
     if (!strcmp(argv[param_count], "-ack") || !strcmp(argv[param_count], "--acknowledge")) {
       printf("Acknowledging the detected/current configuration!\n");
       write_config_command(CONFIG_ACK, 0x0, 0x0, 0x0, 0x0);
@@ -2116,6 +2174,18 @@ void config_usbsidpico(int argc, char **argv)
           write_config_command(SET_CONFIG, 0xB, sw, 0x0, 0x0);
           continue;
         }
+        if (!strcmp(argv[pc], "-lat") || !strcmp(argv[pc], "--asid-latency")) {
+          pc++;
+          int lat = atoi(argv[pc]);
+          if(lat < 1 || lat > 64) {
+            printf("%d is not a correct ASID latency option!\n", lat);
+            goto exit;
+          }
+          printf("Set ASID latency from %d to: %d frames\n", usbsid_config.Asid.latency, lat);
+          usbsid_config.Asid.latency = lat;
+          write_config_command(SET_CONFIG, 0x10, lat, 0x0, 0x0);
+          continue;
+        }
         if (!strcmp(argv[pc], "-fm") || !strcmp(argv[pc], "--fmopl-enabled")) {
           pc++;
           int en = atoi(argv[pc]);
@@ -87,6 +87,7 @@ enum
   RELOAD_CONFIG    = 0x38,  /* Reload and apply stored config from flash */
   READ_NUMSIDS     = 0x39,  /* Returns the number of SIDs in byte 0 */
   READ_FMOPLSID    = 0x3A,  /* Returns the sidno for FMOpl 1~4, 0 is disable */
+  READ_BOOTSTATE   = 0x3E,  /* Returns boot stage, ready and the connect, mount and ready times in ms since boot */
   READ_CONFIGACK   = 0x3F,  /* Returns 1 if socket power is disabled and read/writes are dropped */
 
   SINGLE_SID       = 0x40,  /* Single SID Socket One */
@@ -115,6 +116,7 @@ enum
   STOP_TESTS       = 0x59,  /* Interrupt any running SID tests */
   DETECT_CLONES    = 0x5A,  /* Detect clone SID types */
   AUTO_DETECT      = 0x5B,  /* Run auto detection routine (fallback/workaround for rp2350 bug) */
+  GET_CLOCKINFO    = 0x5C,  /* Returns clk_sys, the PIO dividers and the achieved SID clock error and jitter */
 
   LOAD_MIDI_STATE  = 0x60,
   SAVE_MIDI_STATE  = 0x61,
@@ -236,6 +238,7 @@ typedef struct Config {
     bool enabled : 1;           /* Cannot be disabled */
   } WebUSB;                     /* 6 */
   struct {
+    uint8_t latency;            /* ASID buffer pre-roll and target depth in frames (1 ~ 64) */
     bool enabled : 1;
     /* bool buffered : 1; */          /* Enable/Disable ASID buffering by default (protocal can enable this) */
   } Asid;                       /* 7 */
@@ -307,6 +310,7 @@ typedef struct Config {
     .enabled = true \
   }, \
   .Asid = { \
+    .latency = 3, \
     .enabled = true, \
     /* .buffered = false */ \
   }, \
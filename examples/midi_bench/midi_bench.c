@@ -0,0 +1,259 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * midi_bench.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <globals.h>
+#include <config.h>
+#include <midi.h>
+#include <midi_defs.h>
+#include <midi_handler.h>
+
+/* Times note on, note off and CC messages through process_midi from
+ * src/midi_handler.c, or any other revision of it, on the host. SID writes
+ * land in counters so the numbers are the handler cost only. Build a second
+ * time with MIDI_HANDLER_SOURCE pointing at an older handler to compare */
+
+#define BENCH_COUNT   (1u << 16)  /* Messages per timing run */
+#define BENCH_RUNS    51          /* Best of, short runs dodge scheduler noise */
+#define HELD_NOTES    3           /* Notes held per channel before the oldest is released */
+
+/* Variables the handler expects from usbsid.c and config.c */
+volatile char dtype = 0, ntype = 0, rtype = 0;
+const char cdc = 'C', asid = 'A', midi = 'M', sysex = 'S', wusb = 'W', uart = 'U';
+uint8_t sid_memory[0x100];
+Config usbsid_config = { .clock_rate = 985248, .raster_rate = 19656 };  /* PAL */
+RuntimeCFG cfg = { .numsids = 1, .ids = { 0, 1, 2, 3 }, .sidaddr = { 0x00, 0x20, 0x40, 0x60 } };
+const midi_ccvalues midi_ccvalues_defaults = MIDI_DEFAULT_CCVALUES_INIT;
+
+/* Erased flash image for the patch bank */
+uint8_t bench_flash[MIDI_PATCHES * FLASH_SECTOR_SIZE];
+
+/* Bus writes the handler made */
+static uint64_t bus_writes, bus_calls;
+
+void cycled_write_operation(uint8_t address, uint8_t data, uint16_t cycles)
+{
+  (void)address; (void)data; (void)cycles;
+  bus_writes++;
+  bus_calls++;
+}
+
+void cycled_write_burst(const uint8_t *address, const uint8_t *data, uint8_t n, uint16_t lead, uint16_t spacing)
+{
+  (void)address; (void)data; (void)lead; (void)spacing;
+  bus_writes += n;
+  bus_calls++;
+}
+
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t ints) { (void)ints; }
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t timeout_ms)
+{
+  (void)timeout_ms;
+  func(param);
+  return PICO_OK;
+}
+
+void flash_range_erase(uint32_t offset, size_t count)
+{
+  memset(&bench_flash[offset], 0xFF, count);
+}
+
+void flash_range_program(uint32_t offset, const uint8_t *data, size_t count)
+{
+  memcpy(&bench_flash[offset], data, count);
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((double)ts.tv_sec * 1e9) + (double)ts.tv_nsec;
+}
+
+uint32_t time_us_32(void)
+{
+  return (uint32_t)(now_ns() / 1000.0);
+}
+
+static uint32_t rng_state = 1;
+
+/* xorshift32, every build gets the same messages */
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+/* Note ons until HELD_NOTES are down on a channel, then the oldest is
+ * released, across all 16 channels */
+static void make_notes(uint8_t *msgs, uint32_t count)
+{
+  uint8_t held[MAX_CHANNELS][HELD_NOTES];
+  uint8_t nheld[MAX_CHANNELS] = { 0 };
+  for (uint32_t m = 0; m < count; m++) {
+    uint8_t *msg = &msgs[m * 3];
+    uint8_t c = (rng() & 0x0F);
+    if (nheld[c] < HELD_NOTES) {
+      uint8_t note = (uint8_t)(36 + (rng() % 60));
+      held[c][nheld[c]++] = note;
+      msg[0] = (0x90 | c);
+      msg[1] = note;
+      msg[2] = (uint8_t)(1 + (rng() % 127));
+    } else {
+      msg[0] = (0x80 | c);
+      msg[1] = held[c][0];
+      msg[2] = 0x40;
+      memmove(&held[c][0], &held[c][1], (HELD_NOTES - 1));
+      nheld[c]--;
+    }
+  }
+}
+
+/* Sound shaping CCs that every handler revision knows */
+static void make_ccs(uint8_t *msgs, uint32_t count)
+{
+  const midi_ccvalues *cc = &midi_ccvalues_defaults;
+  const uint8_t ccs[] = {
+    cc->CC_PWM, cc->CC_ATT, cc->CC_DEC, cc->CC_SUS, cc->CC_REL,
+    cc->CC_FFC, cc->CC_RES, cc->CC_VOL, cc->CC_NOTE,
+  };
+  for (uint32_t m = 0; m < count; m++) {
+    uint8_t *msg = &msgs[m * 3];
+    msg[0] = (0xB0 | (rng() & 0x0F));
+    msg[1] = ccs[rng() % count_of(ccs)];
+    msg[2] = (rng() & 0x7F);
+  }
+}
+
+/* Polyphony on for every SID of every channel */
+static void set_poly(void)
+{
+  for (uint8_t c = 0; c < MAX_CHANNELS; c++) {
+    for (uint8_t s = 0; s < cfg.numsids; s++) {
+      uint8_t msg[3] = { (0xB0 | c), midi_ccvalues_defaults.CC_SID1 + s, 127 };
+      process_midi(msg, 3);
+      msg[1] = midi_ccvalues_defaults.CC_SPLY;
+      process_midi(msg, 3);
+    }
+  }
+}
+
+static void bench(const char *name, const uint8_t *msgs, uint32_t count, bool poly)
+{
+  double best = 1e30;
+  uint64_t writes = 0, calls = 0;
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    memset(sid_memory, 0, sizeof(sid_memory));
+    midi_processor_init();
+    if (poly) set_poly();
+    bus_writes = bus_calls = 0;
+    double t0 = now_ns();
+    for (uint32_t m = 0; m < count; m++) process_midi((uint8_t *)&msgs[m * 3], 3);
+    double t1 = now_ns();
+    if ((t1 - t0) < best) best = (t1 - t0);
+    writes = bus_writes;
+    calls = bus_calls;
+  }
+  fprintf(stdout, "%-12s %8u msgs  %7.2f ns/msg  %5.2f SID writes/msg in %5.2f bus calls/msg\n",
+    name, count, (best / count), ((double)writes / count), ((double)calls / count));
+}
+
+/**
+ * @brief Print help to stdout
+ *
+ */
+void print_help(void)
+{
+  fprintf(stdout, "*** Usage ***\n");
+  fprintf(stdout, "\n");
+  fprintf(stdout, "midi_bench [options]\n");
+  fprintf(stdout, "  -h: Show this information\n");
+  fprintf(stdout, "  -n N: number of SIDs the handler sees (defaults to 1, max %d)\n", MAX_SIDS);
+  fprintf(stdout, "  -s N: random seed (defaults to 1)\n");
+  fprintf(stdout, "\n");
+  fprintf(stdout, "Times note on/off and CC messages through process_midi.\n");
+  return;
+}
+
+/**
+ * @brief Main entrypoint
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char* argv[])
+{
+  uint32_t seed = 1;
+  int numsids = 1;
+
+  for (int a = 1; a < argc; a++) {
+    if (!strcmp(argv[a], "-h") || !strcmp(argv[a], "--help")) {
+      print_help();
+      return EXIT_SUCCESS;
+    } else if (!strcmp(argv[a], "-n") && (a + 1) < argc) {
+      numsids = atoi(argv[++a]);
+    } else if (!strcmp(argv[a], "-s") && (a + 1) < argc) {
+      seed = (uint32_t)strtoul(argv[++a], NULL, 0);
+    } else {
+      print_help();
+      return EXIT_FAILURE;
+    }
+  }
+  if (numsids < 1) numsids = 1;
+  if (numsids > MAX_SIDS) numsids = MAX_SIDS;
+  cfg.numsids = (uint8_t)numsids;
+  rng_state = (seed != 0 ? seed : 1);
+  memset(bench_flash, 0xFF, sizeof(bench_flash));
+
+  uint8_t *notes = malloc(BENCH_COUNT * 3), *ccs = malloc(BENCH_COUNT * 3);
+  if (notes == NULL || ccs == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  make_notes(notes, BENCH_COUNT);
+  make_ccs(ccs, BENCH_COUNT);
+
+  fprintf(stdout, "%d SID(s)\n", numsids);
+  bench("notes mono", notes, BENCH_COUNT, false);
+  bench("notes poly", notes, BENCH_COUNT, true);
+  bench("cc", ccs, BENCH_COUNT, false);
+
+  free(notes);
+  free(ccs);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,403 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * midi_fuzz.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <globals.h>
+#include <midi.h>
+#include <midi_handler.h>
+#include <midi_sequencer.h>
+#include <sysex.h>
+
+/* Compiles src/midi.c on the host with everything behind it replaced by
+ * recorders. Random valid MIDI is encoded twice, as USB-MIDI event packets
+ * and as a flat byte stream, and both parsers must hand the same messages
+ * to the handlers. Random garbage is then fed to both to check they stay
+ * inside their buffers. Last both parsers are timed on the same messages */
+
+#define MAX_MESSAGES  64            /* Messages per fuzz iteration */
+#define LOG_SIZE      (64 * 1024)   /* Handler calls per iteration */
+#define BENCH_COUNT   (1u << 20)    /* Messages per timing run */
+
+/* Variables the parser expects from usbsid.c */
+volatile char dtype = 0, ntype = 0, rtype = 0;
+const char cdc = 'C', asid = 'A', midi = 'M', sysex = 'S', wusb = 'W', uart = 'U';
+
+/* Handler call log, every call leaves a tag followed by its data */
+static uint8_t *log_buf;
+static size_t log_len;
+static bool log_overflow;
+static uint32_t calls;  /* Counted even when not recording */
+
+static void log_bytes(uint8_t tag, const uint8_t *data, int size)
+{
+  calls++;
+  if (log_buf == NULL) return;
+  if ((log_len + 2 + size) > LOG_SIZE) {
+    log_overflow = true;
+    return;
+  }
+  log_buf[log_len++] = tag;
+  log_buf[log_len++] = (uint8_t)size;
+  if (size > 0) memcpy(&log_buf[log_len], data, size);
+  log_len += size;
+}
+
+/* Recorders for midi_handler.c, midi_sequencer.c and sysex.c */
+void midi_processor_init(void)            { log_bytes('I', NULL, 0); }
+void process_midi(uint8_t *buffer, int size) { log_bytes('M', buffer, size); }
+void process_sysex(uint8_t *buffer, int size) { log_bytes('S', buffer, size); }
+void midi_sequencer_init(void)            { log_bytes('i', NULL, 0); }
+void midi_sequencer_clock(void)           { log_bytes('c', NULL, 0); }
+void midi_sequencer_start(void)           { log_bytes('s', NULL, 0); }
+void midi_sequencer_continue(void)        { log_bytes('o', NULL, 0); }
+void midi_sequencer_stop(void)            { log_bytes('p', NULL, 0); }
+bool midi_sequencer_capture(uint8_t *buffer, int size) { (void)buffer; (void)size; return false; }
+
+/* Same message in both encodings */
+typedef struct {
+  uint8_t *packets;  /* 4 byte USB-MIDI event packets */
+  size_t npackets;
+  uint8_t *stream;   /* Flat byte stream */
+  size_t nstream;
+  uint8_t running;   /* Running status the stream may use, 0 for none */
+} encoding_t;
+
+static uint32_t rng_state = 1;
+
+/* xorshift32, reproducible from the seed on every host */
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static void put_packet(encoding_t *e, uint8_t cin, uint8_t b1, uint8_t b2, uint8_t b3)
+{
+  uint8_t *p = &e->packets[(e->npackets++) * 4];
+  p[0] = (uint8_t)((MIDI_CABLE << 4) | cin);
+  p[1] = b1;
+  p[2] = b2;
+  p[3] = b3;
+}
+
+static void put_stream(encoding_t *e, uint8_t b)
+{
+  e->stream[e->nstream++] = b;
+}
+
+/* Channel message, the stream leaves out a repeated 3 byte status */
+static void encode_channel(encoding_t *e, uint8_t status, uint8_t d1, uint8_t d2)
+{
+  uint8_t cin = (status >> 4);
+  bool two = (cin == 0xC || cin == 0xD);
+  put_packet(e, cin, status, d1, (two ? 0 : d2));
+  if (two || status != e->running || (rng() & 1)) put_stream(e, status);
+  put_stream(e, d1);
+  if (!two) put_stream(e, d2);
+  e->running = (two ? 0 : status);
+}
+
+/* Real-Time byte, allowed anywhere including inside SysEx */
+static void encode_realtime(encoding_t *e, uint8_t rt)
+{
+  put_packet(e, 0xF, rt, 0, 0);
+  put_stream(e, rt);
+}
+
+/* SysEx of len data bytes, split in 3 byte chunks with
+ * Real-Time bytes between the chunks now and then */
+static void encode_sysex(encoding_t *e, const uint8_t *data, int len)
+{
+  uint8_t msg[2 + 256];
+  int n = 0;
+  msg[n++] = 0xF0;
+  memcpy(&msg[n], data, len);
+  n += len;
+  msg[n++] = 0xF7;
+  for (int i = 0; i < n; i += 3) {
+    int left = (n - i);
+    if (left > 3) {
+      put_packet(e, 0x4, msg[i], msg[i + 1], msg[i + 2]);
+    } else {
+      put_packet(e, (uint8_t)(0x4 + left), msg[i], (left > 1 ? msg[i + 1] : 0), (left > 2 ? msg[i + 2] : 0));
+    }
+    for (int j = 0; j < 3 && (i + j) < n; j++) put_stream(e, msg[i + j]);
+    if (left > 3 && (rng() & 7) == 0) encode_realtime(e, (uint8_t)(0xF8 + (rng() & 7)));
+  }
+  e->running = 0;
+}
+
+/* System Common, parsed but never handled */
+static void encode_common(encoding_t *e)
+{
+  uint8_t d1 = (rng() & 0x7F), d2 = (rng() & 0x7F);
+  switch (rng() % 4) {
+    case 0:  /* MTC Quarter Frame */
+      put_packet(e, 0x2, 0xF1, d1, 0);
+      put_stream(e, 0xF1); put_stream(e, d1);
+      break;
+    case 1:  /* Song Position Pointer */
+      put_packet(e, 0x3, 0xF2, d1, d2);
+      put_stream(e, 0xF2); put_stream(e, d1); put_stream(e, d2);
+      break;
+    case 2:  /* Song Select */
+      put_packet(e, 0x2, 0xF3, d1, 0);
+      put_stream(e, 0xF3); put_stream(e, d1);
+      break;
+    default: /* Tune Request */
+      put_packet(e, 0x5, 0xF6, 0, 0);
+      put_stream(e, 0xF6);
+      break;
+  }
+  e->running = 0;
+}
+
+/* One random valid message, SysEx sizes run past the 64 byte buffer */
+static void encode_random(encoding_t *e)
+{
+  uint32_t r = (rng() % 100);
+  if (r < 55) {
+    uint8_t status = (uint8_t)(0x80 + (rng() % 0x70));
+    encode_channel(e, status, rng() & 0x7F, rng() & 0x7F);
+  } else if (r < 75) {
+    uint8_t data[70];
+    int len = (int)(rng() % sizeof(data));
+    for (int i = 0; i < len; i++) data[i] = rng() & 0x7F;
+    encode_sysex(e, data, len);
+  } else if (r < 88) {
+    encode_realtime(e, (uint8_t)(0xF8 + (rng() & 7)));
+  } else {
+    encode_common(e);
+  }
+}
+
+/* Feeds the stream in random sized pieces like a serial port would */
+static void feed_stream(const encoding_t *e)
+{
+  size_t i = 0;
+  while (i < e->nstream) {
+    size_t n = (1 + (rng() % 64));
+    if (n > (e->nstream - i)) n = (e->nstream - i);
+    process_stream(&e->stream[i], n);
+    i += n;
+  }
+}
+
+static bool machine_sane(void)
+{
+  return (midimachine.index <= count_of(midimachine.streambuffer));
+}
+
+/* Random valid MIDI, both parsers must make the same handler calls */
+static int fuzz_valid(uint32_t iterations)
+{
+  static uint8_t packets[MAX_MESSAGES * 48 * 4], stream[MAX_MESSAGES * 96];
+  static uint8_t packet_log[LOG_SIZE], stream_log[LOG_SIZE];
+
+  for (uint32_t it = 0; it < iterations; it++) {
+    encoding_t e = { packets, 0, stream, 0, 0 };
+    int messages = (int)(1 + (rng() % MAX_MESSAGES));
+    for (int m = 0; m < messages; m++) encode_random(&e);
+
+    midi_init();
+    log_buf = packet_log; log_len = 0; log_overflow = false;
+    for (size_t p = 0; p < e.npackets; p++) process_packet(&e.packets[p * 4]);
+    size_t packet_len = log_len;
+
+    midi_init();
+    log_buf = stream_log; log_len = 0;
+    feed_stream(&e);
+    size_t stream_len = log_len;
+    log_buf = NULL;
+
+    if (log_overflow) {
+      fprintf(stderr, "Iteration %u: log overflow\n", it);
+      return -1;
+    }
+    if (packet_len != stream_len || memcmp(packet_log, stream_log, packet_len) != 0) {
+      size_t at = 0;
+      while (at < packet_len && at < stream_len && packet_log[at] == stream_log[at]) at++;
+      fprintf(stderr, "Iteration %u: packet and stream paths differ at log byte %zu (%zu vs %zu bytes)\n",
+        it, at, packet_len, stream_len);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* Random bytes and random packets on any cable and CIN */
+static int fuzz_garbage(uint32_t iterations)
+{
+  uint8_t buffer[64];
+  midi_init();
+  for (uint32_t it = 0; it < iterations; it++) {
+    uint8_t packet[4];
+    for (int i = 0; i < 4; i++) packet[i] = (uint8_t)rng();
+    if (rng() & 1) packet[0] &= 0x0F;  /* Mostly our cable */
+    process_packet(packet);
+    if (!machine_sane()) {
+      fprintf(stderr, "Iteration %u: packet %02x %02x %02x %02x left index at %u\n",
+        it, packet[0], packet[1], packet[2], packet[3], midimachine.index);
+      return -1;
+    }
+    size_t n = (1 + (rng() % sizeof(buffer)));
+    for (size_t i = 0; i < n; i++) buffer[i] = (uint8_t)rng();
+    process_stream(buffer, n);
+    if (!machine_sane()) {
+      fprintf(stderr, "Iteration %u: stream left index at %u\n", it, midimachine.index);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((double)ts.tv_sec * 1e9) + (double)ts.tv_nsec;
+}
+
+/* Times both parsers on the same messages, best of a few runs */
+static void bench(const char *name, bool with_sysex)
+{
+  encoding_t e = { malloc(BENCH_COUNT * 48 * 4), 0, malloc(BENCH_COUNT * 96), 0, 0 };
+  if (e.packets == NULL || e.stream == NULL) {
+    perror("malloc failed");
+    exit(EXIT_FAILURE);
+  }
+  uint32_t messages = (with_sysex ? (BENCH_COUNT / 16) : BENCH_COUNT);
+  for (uint32_t m = 0; m < messages; m++) {
+    if (with_sysex) {
+      uint8_t data[60];
+      for (size_t i = 0; i < sizeof(data); i++) data[i] = rng() & 0x7F;
+      encode_sysex(&e, data, sizeof(data));
+    } else {
+      static const uint8_t status[] = { 0x90, 0x80, 0xB0 };  /* Note on, note off, CC */
+      encode_channel(&e, (uint8_t)(status[m % 3] | (rng() & 0x0F)), rng() & 0x7F, rng() & 0x7F);
+    }
+  }
+
+  double best_packet = 1e30, best_stream = 1e30;
+  for (int run = 0; run < 5; run++) {
+    midi_init();
+    calls = 0;
+    double t0 = now_ns();
+    for (size_t p = 0; p < e.npackets; p++) process_packet(&e.packets[p * 4]);
+    double t1 = now_ns();
+    uint32_t packet_calls = calls;
+    midi_init();
+    calls = 0;
+    for (size_t i = 0; i < e.nstream; i += 64) {
+      process_stream(&e.stream[i], ((e.nstream - i) < 64 ? (e.nstream - i) : 64));
+    }
+    double t2 = now_ns();
+    if (packet_calls != calls) {
+      fprintf(stderr, "%s: packet path made %u calls, stream path %u\n", name, packet_calls, calls);
+      exit(EXIT_FAILURE);
+    }
+    if ((t1 - t0) < best_packet) best_packet = (t1 - t0);
+    if ((t2 - t1) < best_stream) best_stream = (t2 - t1);
+  }
+  fprintf(stdout, "%-8s %8u msgs  packet %7.2f ns/msg  stream %7.2f ns/msg  (%zu packets, %zu bytes)\n",
+    name, messages, (best_packet / messages), (best_stream / messages), e.npackets, e.nstream);
+  free(e.packets);
+  free(e.stream);
+}
+
+/**
+ * @brief Print help to stdout
+ *
+ */
+void print_help(void)
+{
+  fprintf(stdout, "*** Usage ***\n");
+  fprintf(stdout, "\n");
+  fprintf(stdout, "midi_fuzz [options]\n");
+  fprintf(stdout, "  -h: Show this information\n");
+  fprintf(stdout, "  -s N: random seed (defaults to 1)\n");
+  fprintf(stdout, "  -n N: fuzz iterations (defaults to 100000)\n");
+  fprintf(stdout, "  -b: skip the timing runs\n");
+  fprintf(stdout, "\n");
+  fprintf(stdout, "Compares the USB-MIDI packet parser with the byte stream parser in src/midi.c.\n");
+  return;
+}
+
+/**
+ * @brief Main entrypoint
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char* argv[])
+{
+  uint32_t seed = 1, iterations = 100000;
+  bool timing = true;
+
+  for (int a = 1; a < argc; a++) {
+    if (!strcmp(argv[a], "-h") || !strcmp(argv[a], "--help")) {
+      print_help();
+      return EXIT_SUCCESS;
+    } else if (!strcmp(argv[a], "-s") && (a + 1) < argc) {
+      seed = (uint32_t)strtoul(argv[++a], NULL, 0);
+    } else if (!strcmp(argv[a], "-n") && (a + 1) < argc) {
+      iterations = (uint32_t)strtoul(argv[++a], NULL, 0);
+    } else if (!strcmp(argv[a], "-b")) {
+      timing = false;
+    } else {
+      print_help();
+      return EXIT_FAILURE;
+    }
+  }
+  rng_state = (seed != 0 ? seed : 1);
+
+  if (fuzz_valid(iterations) != 0) {
+    fprintf(stderr, "Valid MIDI fuzz failed, seed %u\n", seed);
+    return EXIT_FAILURE;
+  }
+  fprintf(stdout, "Valid MIDI: %u iterations, packet and stream paths agree\n", iterations);
+  if (fuzz_garbage(iterations) != 0) {
+    fprintf(stderr, "Garbage fuzz failed, seed %u\n", seed);
+    return EXIT_FAILURE;
+  }
+  fprintf(stdout, "Garbage: %u packets and byte runs, state stayed in bounds\n", iterations);
+
+  if (timing) {
+    bench("channel", false);
+    bench("sysex", true);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * config.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+/* Host stand-in for src/config.h, only the fields the MIDI handler reads */
+
+#ifndef _USBSID_CONFIG_H_
+#define _USBSID_CONFIG_H_
+#pragma once
+
+#include <stdint.h>
+
+/* MIDI patch bank offset in the host flash image, one sector per program */
+#define FLASH_MIDI_OFFSET 0
+#define MIDI_PATCHES 128
+
+typedef struct Config {
+  uint32_t clock_rate;  /* clock speed identifier */
+  uint16_t raster_rate; /* raster rate identifier based on clockspeed */
+} Config;
+
+typedef struct RuntimeCFG {
+  uint8_t numsids;
+  uint8_t ids[4];
+  uint8_t sidaddr[4];
+} RuntimeCFG;
+
+extern Config        usbsid_config;
+extern RuntimeCFG    cfg;
+
+#endif /* _USBSID_CONFIG_H_ */
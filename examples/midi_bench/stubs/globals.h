@@ -0,0 +1,68 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * globals.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Host stand-in for src/globals.h, only what the MIDI sources use */
+
+#ifndef _USBSID_GLOBALS_H_
+#define _USBSID_GLOBALS_H_
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* Project headers to always include */
+#include <macros.h>
+#include <sid_defs.h>
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define __not_in_flash_func(f) f
+#define __no_inline_not_in_flash_func(f) f
+#define __not_in_flash(s)
+#define __dmb()
+
+#define MIDI_CABLE 0
+#define PICO_OK 0
+#define XIP_BASE ((uintptr_t)bench_flash)
+#define FLASH_PAGE_SIZE 256
+#define FLASH_SECTOR_SIZE 4096
+
+/* USB data type */
+extern volatile char dtype, ntype, rtype;
+extern const char cdc, asid, midi, sysex, wusb, uart;
+
+/* Flash, an erased RAM image big enough for the MIDI patch bank */
+extern uint8_t bench_flash[];
+uint32_t save_and_disable_interrupts(void);
+void     restore_interrupts(uint32_t ints);
+int      flash_safe_execute(void (*func)(void *), void *param, uint32_t timeout_ms);
+void     flash_range_erase(uint32_t offset, size_t count);
+void     flash_range_program(uint32_t offset, const uint8_t *data, size_t count);
+uint32_t time_us_32(void);
+
+#endif /* _USBSID_GLOBALS_H_ */
@@ -0,0 +1,43 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * logging.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Host stand-in for src/logging.h, all logging compiled out */
+
+#ifndef _USBSID_LOGGING_H_
+#define _USBSID_LOGGING_H_
+#pragma once
+
+#define usNFO(...)  ((void)0)
+#define usERR(...)  ((void)0)
+#define usWRN(...)  ((void)0)
+#define usDBG(...)  ((void)0)
+#define usCFG(...)  ((void)0)
+#define usMIDI(...) ((void)0)
+#define usMCMD(...) ((void)0)
+#define usMDAT(...) ((void)0)
+#define usMVCE(...) ((void)0)
+#define usSID(...)  ((void)0)
+
+#endif /* _USBSID_LOGGING_H_ */
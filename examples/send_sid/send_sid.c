@@ -33,6 +33,7 @@
 #include <string.h> // `strerror(errno)`
 #include <stdbool.h>
 #include <ctype.h>
+#include <time.h>   // `nanosleep()`
 
 #include <libusb.h>
 
@@ -63,6 +64,10 @@ enum {
   UPLOAD_SID_DATA  = 0xD1,  /* Init byte for each packet containing data */
   UPLOAD_SID_END   = 0xD2,  /* End command for USBSID to exit receiving mode */
   UPLOAD_SID_SIZE  = 0xD3,  /* Packet containing the actual file size */
+  UPLOAD_SID_BEGIN = 0xD5,  /* Framed upload: filetype, size and CRC32 */
+  UPLOAD_SID_CHUNK = 0xD6,  /* Framed upload: offset, length, CRC32 and data */
+  UPLOAD_SID_COMMIT = 0xD7, /* Framed upload: verify and hand over to the player */
+  SID_CACHE_LOOKUP = 0xD8,  /* Look up a tune in the flash cache by size and CRC32 */
 
   /* Internal SID player */
   SID_PLAYER_LOAD  = 0xE0,  /* Load SID file into SID player memory and initialize internal SID player */
@@ -78,6 +83,20 @@ enum {
   PRG_FILE         = 0x02,  /* File is PRG */
 };
 
+/* Framed upload replies, see sid_upload.h */
+enum {
+  UPLOAD_OK = 0,
+  UPLOAD_RECEIVING,
+  UPLOAD_BAD_HEADER,
+  UPLOAD_BAD_CRC,
+  UPLOAD_NO_MEMORY,
+  UPLOAD_BUSY,
+  UPLOAD_IDLE,
+};
+#define UPLOAD_CHUNK_HEADER 9
+#define UPLOAD_CHUNK_MAX    54
+#define UPLOAD_RETRIES      5
+
 /**
  * @brief Initialize a connection with USBSID-Pico
  *
@@ -226,52 +245,182 @@ char* get_extension_and_tolower(const char* fname) {
   return NULL; /* No extension found */
 }
 
+/**
+ * @brief CRC32 (IEEE 802.3), chainable, start with 0
+ *
+ * @param crc
+ * @param data
+ * @param len
+ * @return uint32_t
+ */
+static uint32_t crc32_update(uint32_t crc, const unsigned char *data, size_t len)
+{
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    for (int b = 0; b < 8; b++) {
+      crc = ((crc >> 1) ^ (0xEDB88320u & -(crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+static void put_be24(unsigned char *p, uint32_t v)
+{
+  p[0] = ((v >> 16) & 0xFF);
+  p[1] = ((v >> 8) & 0xFF);
+  p[2] = (v & 0xFF);
+  return;
+}
+
+static void put_be32(unsigned char *p, uint32_t v)
+{
+  p[0] = ((v >> 24) & 0xFF);
+  put_be24(&p[1], v);
+  return;
+}
+
+/**
+ * @brief Send a config command and read the reply
+ *
+ * @param buff
+ * @param reply, 64 bytes
+ * @return int 0 on success
+ */
+static int config_request(unsigned char *buff, unsigned char *reply)
+{
+  int actual_length;
+  write_chars(buff, 64);
+  /* A commit may store the tune in flash first, allow for that */
+  if (libusb_bulk_transfer(devh, ep_in_addr, reply, 64, &actual_length, 5000) < 0 || actual_length < 4) {
+    fprintf(stderr, "No reply from USBSID-Pico\n");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Send a framed upload command and read the { STATUS, RECEIVED, CACHE_ID } reply
+ *
+ * @param buff
+ * @param received
+ * @return int status or -1 on error
+ */
+static int upload_request(unsigned char *buff, uint32_t *received)
+{
+  unsigned char reply[64] = {0};
+  if (config_request(buff, reply) != 0) return -1;
+  *received = ((uint32_t)reply[1] << 16 | (uint32_t)reply[2] << 8 | reply[3]);
+  return reply[0];
+}
+
 /**
  * @brief Send input file to USBSID-Pico
  *
+ * Chunks are pipelined without waiting for a reply, the commit reply
+ * tells where the device stopped receiving and the upload resumes there.
+ * Tunes already in the flash cache on the device are not sent again.
+ *
  * @param input_f
  * @param filetype
+ * @param tune_id, set to the cache id or 0 for the uploaded file
+ * @param use_cache
+ * @return int 0 on success
  */
-static void send_sid(FILE* input_f, int filetype)
+static int send_sid(FILE* input_f, int filetype, int *tune_id, bool use_cache)
 {
-  int byte;
-  unsigned int i = 0U;
   unsigned char buff[64] = {0};
-  static int bytecount = 2;
-
-  fseek(input_f, 0L, SEEK_END);
-  unsigned int file_size = ftell(input_f);
-  rewind(input_f);
+  unsigned char *file = NULL;
+  size_t file_size = 0, cap = 0, n;
+  uint32_t received = 0;
+  int status = -1;
+
+  /* Read everything first, this works for stdin too */
+  do {
+    if (file_size == cap) {
+      cap = (cap ? (cap * 2) : 0x4000);
+      unsigned char *f = realloc(file, cap);
+      if (f == NULL) {
+        perror("realloc failed");
+        free(file);
+        return -1;
+      }
+      file = f;
+    }
+    n = fread(file + file_size, 1, (cap - file_size), input_f);
+    file_size += n;
+  } while (n > 0);
+  uint32_t crc = crc32_update(0, file, file_size);
+  *tune_id = 0;
+
+  if (use_cache) {
+    unsigned char reply[64] = {0};
+    buff[0] = (PACKET_TYPE|CONFIG);
+    buff[1] = SID_CACHE_LOOKUP;
+    put_be24(&buff[2], (uint32_t)file_size);
+    put_be32(&buff[5], crc);
+    if (config_request(buff, reply) == 0 && reply[0] != 0) {
+      fprintf(stdout, "Found in cache as id %d (%d songs), skipping upload\n",
+        reply[0], (reply[1] << 8 | reply[2]));
+      *tune_id = reply[0];
+      free(file);
+      return 0;
+    }
+    memset(buff, 0, 64);
+  }
 
   buff[0] = (PACKET_TYPE|CONFIG);
-  buff[1] = UPLOAD_SID_START;
+  buff[1] = UPLOAD_SID_BEGIN;
   buff[2] = (filetype);
-  write_chars(buff, 64);
+  put_be24(&buff[3], (uint32_t)file_size);
+  put_be32(&buff[6], crc);
+  status = upload_request(buff, &received);
 
-  buff[1] = UPLOAD_SID_DATA;
-  while ((byte = getc(input_f)) != EOF) {
-    buff[bytecount++] = byte;
-    if (bytecount == 64 || i == (file_size - 1)) {
-      bytecount = 2;
-      write_chars(buff, 64);
+  for (int retry = 0; retry < UPLOAD_RETRIES && status == UPLOAD_RECEIVING; retry++) {
+    for (uint32_t offset = received; offset < file_size; offset += UPLOAD_CHUNK_MAX) {
+      uint8_t l = (((file_size - offset) < UPLOAD_CHUNK_MAX) ? (file_size - offset) : UPLOAD_CHUNK_MAX);
       memset(buff, 0, 64);
       buff[0] = (PACKET_TYPE|CONFIG);
-      buff[1] = UPLOAD_SID_DATA;
+      buff[1] = UPLOAD_SID_CHUNK;
+      put_be24(&buff[2], offset);
+      buff[5] = l;
+      put_be32(&buff[6], crc32_update(0, file + offset, l));
+      memcpy(&buff[1 + UPLOAD_CHUNK_HEADER], file + offset, l);
+      write_chars(buff, 64);
+    }
+    memset(buff, 0, 64);
+    buff[0] = (PACKET_TYPE|CONFIG);
+    buff[1] = UPLOAD_SID_COMMIT;
+    status = upload_request(buff, &received);
+    if (status == UPLOAD_BAD_CRC) {
+      fprintf(stderr, "File CRC mismatch, resending\n");
+      status = UPLOAD_RECEIVING;
+    } else if (status == UPLOAD_RECEIVING) {
+      fprintf(stderr, "Resuming at %u of %zu bytes\n", received, file_size);
+    } else if (status == UPLOAD_BUSY) {
+      nanosleep(&(struct timespec){ .tv_sec = 0, .tv_nsec = 100000000 }, NULL);
+      status = UPLOAD_RECEIVING;  /* Device keeps the file, commit again */
     }
-    ++i;
   }
-  memset(buff, 0, 64);
-  buff[0] = (PACKET_TYPE|CONFIG);
-  buff[1] = UPLOAD_SID_END;
-  write_chars(buff, 64);
-  memset(buff, 0, 64);
-  buff[0] = (PACKET_TYPE|CONFIG);
-  buff[1] = UPLOAD_SID_SIZE;
-  buff[2] = ((i&0xFF00)>>8); /* High byte */
-  buff[3] = (i&0xFF); /* Low byte */
-  write_chars(buff, 64);
-
-  return;
+  free(file);
+
+  switch (status) {
+    case UPLOAD_OK:
+      fprintf(stdout, "Sent %zu bytes, CRC32 %08X\n", file_size, crc);
+      return 0;
+    case UPLOAD_BAD_HEADER:
+      fprintf(stderr, "USBSID-Pico rejected the file\n");
+      break;
+    case UPLOAD_NO_MEMORY:
+      fprintf(stderr, "USBSID-Pico is out of memory\n");
+      break;
+    case -1:
+      break;
+    default:
+      fprintf(stderr, "Upload failed with status %d\n", status);
+      break;
+  }
+  return -1;
 }
 
 /**
@@ -288,6 +437,7 @@ void print_help(void)
   fprintf(stdout, "  -sid -: to read _SID_ file data from stdin instead of sidfile.sid (PRG not supported yet!)\n");
   fprintf(stdout, "  -t N: provide subtune number together with sid to set subtune (defaults to 1))\n");
   fprintf(stdout, "  -f: Force play on second SID / socket (depends on USBSID-Pico configuration)\n");
+  fprintf(stdout, "  -u: Always upload, even if the tune is in the USBSID-Pico flash cache\n");
   //  fprintf(stdout, "* -start: start play\n");
   fprintf(stdout, "-stop: stop play\n");
   //  fprintf(stdout, "* -pause: pause play\n");
@@ -334,6 +484,8 @@ int main(int argc, char* argv[])
 
   bool sentfile = false;
   bool forcetwo = false;
+  bool use_cache = true;
+  int tune_id = 0;
   bool sidfile = false;
   bool prgfile = false;
 
@@ -351,6 +503,9 @@ int main(int argc, char* argv[])
     if(!strcmp(argv[a], "-f")) {
       forcetwo = true;
     }
+    if(!strcmp(argv[a], "-u")) {
+      use_cache = false;
+    }
   }
 
   for(int arg = 1; arg < argc; arg++) {
@@ -387,7 +542,9 @@ int main(int argc, char* argv[])
         configbuff[1] = SID_PLAYER_STOP;
         write_chars(configbuff, 5);
       }
-      send_sid((input_f ? input_f : stdin), (sidfile ? SID_FILE : prgfile ? PRG_FILE : FROM_STDIN));
+      if (send_sid((input_f ? input_f : stdin), (sidfile ? SID_FILE : prgfile ? PRG_FILE : FROM_STDIN), &tune_id, use_cache) != 0) {
+        goto exit;
+      }
       sentfile = true;
     }
 
@@ -398,7 +555,9 @@ int main(int argc, char* argv[])
         configbuff[1] = SID_PLAYER_STOP;
         write_chars(configbuff, 5);
       }
-      send_sid(stdin, FROM_STDIN);
+      if (send_sid(stdin, FROM_STDIN, &tune_id, use_cache) != 0) {
+        goto exit;
+      }
       sentfile = true;
     }
     if (sentfile) {
@@ -412,7 +571,7 @@ int main(int argc, char* argv[])
       {
         fprintf(stdout, "Setting subtune to ");
         configbuff[1] = SID_PLAYER_LOAD;
-        configbuff[2] = 0; //strtol(argv[arg+1], NULL, 16); /* Tune ID, 0 is uploaded SID file */
+        configbuff[2] = tune_id; /* Tune ID, 0 is uploaded SID file */
         configbuff[3] = 0; /* subtune */
         for(int arg_ = 1; arg_ < argc; arg_++) {
           if(!strcmp(argv[arg_], "-t") || !strcmp(argv[arg_], "t")) {
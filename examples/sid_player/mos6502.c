@@ -0,0 +1,519 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * mos6502.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "mos6502.h"
+
+
+/* NMOS 6502 cycles per opcode, page crossing and taken branches are added */
+static const uint8_t cycletable[256] = {
+/*       0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F */
+/* 0 */  7, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6,
+/* 1 */  2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 2 */  6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6,
+/* 3 */  2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 4 */  6, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6,
+/* 5 */  2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 6 */  6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6,
+/* 7 */  2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* 8 */  2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,
+/* 9 */  2, 6, 2, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5,
+/* A */  2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4,
+/* B */  2, 5, 2, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4,
+/* C */  2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,
+/* D */  2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+/* E */  2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6,
+/* F */  2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,
+};
+
+#define RD(a)    c->read(c->ctx, (uint16_t)(a))
+#define WR(a, v) c->write(c->ctx, (uint16_t)(a), (uint8_t)(v))
+
+
+/**
+ * Helpers
+ */
+
+static inline void setnz(mos6502_t *c, uint8_t v)
+{
+  c->p = (c->p & ~(FLAG_N | FLAG_Z)) | (v & FLAG_N) | (v ? 0 : FLAG_Z);
+}
+
+static inline void setflag(mos6502_t *c, uint8_t flag, bool on)
+{
+  c->p = (on ? (c->p | flag) : (c->p & ~flag));
+}
+
+static inline void push(mos6502_t *c, uint8_t v)
+{
+  WR((0x100 | c->sp), v);
+  c->sp--;
+}
+
+static inline uint8_t pull(mos6502_t *c)
+{
+  c->sp++;
+  return RD(0x100 | c->sp);
+}
+
+static inline uint16_t fetch16(mos6502_t *c)
+{
+  uint16_t lo = RD(c->pc++);
+  return (lo | (RD(c->pc++) << 8));
+}
+
+/* Read-modify-write instructions write the old value back first */
+static inline void rmw_write(mos6502_t *c, uint16_t ea, uint8_t old, uint8_t v)
+{
+  c->icycles--;
+  WR(ea, old);
+  c->icycles++;
+  WR(ea, v);
+}
+
+
+/**
+ * Addressing modes
+ */
+
+static inline uint16_t imm(mos6502_t *c) { return c->pc++; }
+static inline uint16_t zp(mos6502_t *c)  { return RD(c->pc++); }
+static inline uint16_t zpx(mos6502_t *c) { return ((RD(c->pc++) + c->x) & 0xFF); }
+static inline uint16_t zpy(mos6502_t *c) { return ((RD(c->pc++) + c->y) & 0xFF); }
+static inline uint16_t ab(mos6502_t *c)  { return fetch16(c); }
+
+static inline uint16_t abi(mos6502_t *c, uint8_t i, bool penalty)
+{
+  uint16_t base = fetch16(c);
+  uint16_t ea = (uint16_t)(base + i);
+  if (penalty && ((base ^ ea) & 0xFF00)) c->icycles++;
+  return ea;
+}
+
+static inline uint16_t izx(mos6502_t *c)
+{
+  uint8_t z = (RD(c->pc++) + c->x);
+  return (RD(z) | (RD((uint8_t)(z + 1)) << 8));
+}
+
+static inline uint16_t izy(mos6502_t *c, bool penalty)
+{
+  uint8_t z = RD(c->pc++);
+  uint16_t base = (RD(z) | (RD((uint8_t)(z + 1)) << 8));
+  uint16_t ea = (uint16_t)(base + c->y);
+  if (penalty && ((base ^ ea) & 0xFF00)) c->icycles++;
+  return ea;
+}
+
+/* Effective address for the regular cc=01/cc=11 column layout */
+static uint16_t ea_group(mos6502_t *c, uint8_t op, bool penalty)
+{
+  switch ((op >> 2) & 7) {
+    case 0: return izx(c);
+    case 1: return zp(c);
+    case 2: return imm(c);
+    case 3: return ab(c);
+    case 4: return izy(c, penalty);
+    case 5: return zpx(c);
+    case 6: return abi(c, c->y, penalty);
+    default: return abi(c, c->x, penalty);
+  }
+}
+
+
+/**
+ * Arithmetic
+ */
+
+static void adc(mos6502_t *c, uint8_t v)
+{
+  unsigned carry = (c->p & FLAG_C);
+  if (c->p & FLAG_D) {
+    unsigned al = ((c->a & 0x0F) + (v & 0x0F) + carry);
+    if (al > 9) al += 6;
+    unsigned ah = ((c->a >> 4) + (v >> 4) + (al > 0x0F));
+    setflag(c, FLAG_Z, (((c->a + v + carry) & 0xFF) == 0));
+    setflag(c, FLAG_N, (ah & 0x08));
+    setflag(c, FLAG_V, ((((ah << 4) ^ c->a) & 0x80) && !((c->a ^ v) & 0x80)));
+    if (ah > 9) ah += 6;
+    setflag(c, FLAG_C, (ah > 0x0F));
+    c->a = (((ah << 4) | (al & 0x0F)) & 0xFF);
+    return;
+  }
+  unsigned sum = (c->a + v + carry);
+  setflag(c, FLAG_V, (~(c->a ^ v) & (c->a ^ sum) & 0x80));
+  setflag(c, FLAG_C, (sum > 0xFF));
+  c->a = (uint8_t)sum;
+  setnz(c, c->a);
+}
+
+static void sbc(mos6502_t *c, uint8_t v)
+{
+  unsigned borrow = ((c->p & FLAG_C) ? 0 : 1);
+  unsigned diff = (c->a - v - borrow);
+  /* NMOS flags follow the binary result in both modes */
+  setflag(c, FLAG_V, ((c->a ^ v) & (c->a ^ diff) & 0x80));
+  setflag(c, FLAG_C, (diff < 0x100));
+  setnz(c, (uint8_t)diff);
+  if (c->p & FLAG_D) {
+    int al = ((c->a & 0x0F) - (v & 0x0F) - (int)borrow);
+    int ah = ((c->a >> 4) - (v >> 4));
+    if (al & 0x10) { al -= 6; ah--; }
+    if (ah & 0x10) ah -= 6;
+    c->a = (((ah << 4) | (al & 0x0F)) & 0xFF);
+    return;
+  }
+  c->a = (uint8_t)diff;
+}
+
+static inline void cmp(mos6502_t *c, uint8_t r, uint8_t v)
+{
+  setflag(c, FLAG_C, (r >= v));
+  setnz(c, (uint8_t)(r - v));
+}
+
+static inline uint8_t asl(mos6502_t *c, uint8_t v)
+{
+  setflag(c, FLAG_C, (v & 0x80));
+  v <<= 1;
+  setnz(c, v);
+  return v;
+}
+
+static inline uint8_t lsr(mos6502_t *c, uint8_t v)
+{
+  setflag(c, FLAG_C, (v & 0x01));
+  v >>= 1;
+  setnz(c, v);
+  return v;
+}
+
+static inline uint8_t rol(mos6502_t *c, uint8_t v)
+{
+  uint8_t r = ((v << 1) | (c->p & FLAG_C));
+  setflag(c, FLAG_C, (v & 0x80));
+  setnz(c, r);
+  return r;
+}
+
+static inline uint8_t ror(mos6502_t *c, uint8_t v)
+{
+  uint8_t r = ((v >> 1) | ((c->p & FLAG_C) << 7));
+  setflag(c, FLAG_C, (v & 0x01));
+  setnz(c, r);
+  return r;
+}
+
+static inline void branch(mos6502_t *c, bool taken)
+{
+  int8_t off = (int8_t)RD(c->pc++);
+  if (!taken) return;
+  uint16_t to = (uint16_t)(c->pc + off);
+  c->icycles += (((c->pc ^ to) & 0xFF00) ? 2 : 1);
+  c->pc = to;
+}
+
+static void interrupt(mos6502_t *c, uint16_t vector, bool brk)
+{
+  push(c, (c->pc >> 8));
+  push(c, (c->pc & 0xFF));
+  push(c, ((c->p | FLAG_U | (brk ? FLAG_B : 0)) & (brk ? 0xFF : ~FLAG_B)));
+  c->p |= FLAG_I;
+  c->pc = (RD(vector) | (RD(vector + 1) << 8));
+}
+
+
+/**
+ * @brief Reset the registers and start at pc
+ *
+ * @param c
+ * @param pc
+ */
+void mos6502_reset(mos6502_t *c, uint16_t pc)
+{
+  c->a = c->x = c->y = 0;
+  c->sp = 0xFF;
+  c->p = (FLAG_U | FLAG_I);
+  c->pc = pc;
+  c->irq = c->nmi = c->jammed = false;
+  c->icycles = 0;
+}
+
+/**
+ * @brief Execute one instruction or take a pending interrupt
+ *
+ * @param c
+ * @return int cycles used
+ */
+int mos6502_step(mos6502_t *c)
+{
+  if (c->jammed) {
+    c->icycles = 2;
+    c->cycles += 2;
+    return 2;
+  }
+  if (c->nmi || (c->irq && !(c->p & FLAG_I))) {
+    c->icycles = 7;
+    bool nmi = c->nmi;
+    c->nmi = false;
+    interrupt(c, (nmi ? 0xFFFA : 0xFFFE), false);
+    c->cycles += 7;
+    return 7;
+  }
+
+  uint8_t op = RD(c->pc++);
+  uint16_t ea;
+  uint8_t v;
+  c->icycles = cycletable[op];
+
+  switch (op) {
+    /* Loads, stores and the ALU group */
+    case 0x01: case 0x05: case 0x09: case 0x0D: case 0x11: case 0x15: case 0x19: case 0x1D:
+      c->a |= RD(ea_group(c, op, true)); setnz(c, c->a); break;
+    case 0x21: case 0x25: case 0x29: case 0x2D: case 0x31: case 0x35: case 0x39: case 0x3D:
+      c->a &= RD(ea_group(c, op, true)); setnz(c, c->a); break;
+    case 0x41: case 0x45: case 0x49: case 0x4D: case 0x51: case 0x55: case 0x59: case 0x5D:
+      c->a ^= RD(ea_group(c, op, true)); setnz(c, c->a); break;
+    case 0x61: case 0x65: case 0x69: case 0x6D: case 0x71: case 0x75: case 0x79: case 0x7D:
+      adc(c, RD(ea_group(c, op, true))); break;
+    case 0x81: case 0x85: case 0x8D: case 0x91: case 0x95: case 0x99: case 0x9D:
+      WR(ea_group(c, op, false), c->a); break;
+    case 0xA1: case 0xA5: case 0xA9: case 0xAD: case 0xB1: case 0xB5: case 0xB9: case 0xBD:
+      c->a = RD(ea_group(c, op, true)); setnz(c, c->a); break;
+    case 0xC1: case 0xC5: case 0xC9: case 0xCD: case 0xD1: case 0xD5: case 0xD9: case 0xDD:
+      cmp(c, c->a, RD(ea_group(c, op, true))); break;
+    case 0xE1: case 0xE5: case 0xE9: case 0xED: case 0xF1: case 0xF5: case 0xF9: case 0xFD: case 0xEB:
+      sbc(c, RD(ea_group(c, op, true))); break;
+
+    case 0xA2: c->x = RD(imm(c)); setnz(c, c->x); break;
+    case 0xA6: c->x = RD(zp(c)); setnz(c, c->x); break;
+    case 0xB6: c->x = RD(zpy(c)); setnz(c, c->x); break;
+    case 0xAE: c->x = RD(ab(c)); setnz(c, c->x); break;
+    case 0xBE: c->x = RD(abi(c, c->y, true)); setnz(c, c->x); break;
+    case 0xA0: c->y = RD(imm(c)); setnz(c, c->y); break;
+    case 0xA4: c->y = RD(zp(c)); setnz(c, c->y); break;
+    case 0xB4: c->y = RD(zpx(c)); setnz(c, c->y); break;
+    case 0xAC: c->y = RD(ab(c)); setnz(c, c->y); break;
+    case 0xBC: c->y = RD(abi(c, c->x, true)); setnz(c, c->y); break;
+    case 0x86: WR(zp(c), c->x); break;
+    case 0x96: WR(zpy(c), c->x); break;
+    case 0x8E: WR(ab(c), c->x); break;
+    case 0x84: WR(zp(c), c->y); break;
+    case 0x94: WR(zpx(c), c->y); break;
+    case 0x8C: WR(ab(c), c->y); break;
+
+    case 0xE0: cmp(c, c->x, RD(imm(c))); break;
+    case 0xE4: cmp(c, c->x, RD(zp(c))); break;
+    case 0xEC: cmp(c, c->x, RD(ab(c))); break;
+    case 0xC0: cmp(c, c->y, RD(imm(c))); break;
+    case 0xC4: cmp(c, c->y, RD(zp(c))); break;
+    case 0xCC: cmp(c, c->y, RD(ab(c))); break;
+
+    case 0x24: case 0x2C:
+      v = RD((op == 0x24) ? zp(c) : ab(c));
+      setflag(c, FLAG_Z, !(c->a & v));
+      c->p = (c->p & ~(FLAG_N | FLAG_V)) | (v & (FLAG_N | FLAG_V));
+      break;
+
+    /* Shifts, increments and decrements */
+    case 0x0A: c->a = asl(c, c->a); break;
+    case 0x4A: c->a = lsr(c, c->a); break;
+    case 0x2A: c->a = rol(c, c->a); break;
+    case 0x6A: c->a = ror(c, c->a); break;
+    case 0x06: case 0x16: case 0x0E: case 0x1E:
+    case 0x46: case 0x56: case 0x4E: case 0x5E:
+    case 0x26: case 0x36: case 0x2E: case 0x3E:
+    case 0x66: case 0x76: case 0x6E: case 0x7E:
+    case 0xC6: case 0xD6: case 0xCE: case 0xDE:
+    case 0xE6: case 0xF6: case 0xEE: case 0xFE: {
+      switch ((op >> 3) & 3) {
+        case 0: ea = zp(c); break;
+        case 1: ea = ab(c); break;
+        case 2: ea = zpx(c); break;
+        default: ea = abi(c, c->x, false); break;
+      }
+      uint8_t old = RD(ea);
+      switch (op >> 5) {
+        case 0: v = asl(c, old); break;
+        case 1: v = rol(c, old); break;
+        case 2: v = lsr(c, old); break;
+        case 3: v = ror(c, old); break;
+        case 6: v = (old - 1); setnz(c, v); break;
+        default: v = (old + 1); setnz(c, v); break;
+      }
+      rmw_write(c, ea, old, v);
+      break;
+    }
+    case 0xCA: c->x--; setnz(c, c->x); break;
+    case 0x88: c->y--; setnz(c, c->y); break;
+    case 0xE8: c->x++; setnz(c, c->x); break;
+    case 0xC8: c->y++; setnz(c, c->y); break;
+
+    /* Transfers and stack */
+    case 0xAA: c->x = c->a; setnz(c, c->x); break;
+    case 0x8A: c->a = c->x; setnz(c, c->a); break;
+    case 0xA8: c->y = c->a; setnz(c, c->y); break;
+    case 0x98: c->a = c->y; setnz(c, c->a); break;
+    case 0xBA: c->x = c->sp; setnz(c, c->x); break;
+    case 0x9A: c->sp = c->x; break;
+    case 0x48: push(c, c->a); break;
+    case 0x68: c->a = pull(c); setnz(c, c->a); break;
+    case 0x08: push(c, (c->p | FLAG_B | FLAG_U)); break;
+    case 0x28: c->p = ((pull(c) & ~FLAG_B) | FLAG_U); break;
+
+    /* Flags */
+    case 0x18: c->p &= ~FLAG_C; break;
+    case 0x38: c->p |= FLAG_C; break;
+    case 0x58: c->p &= ~FLAG_I; break;
+    case 0x78: c->p |= FLAG_I; break;
+    case 0xB8: c->p &= ~FLAG_V; break;
+    case 0xD8: c->p &= ~FLAG_D; break;
+    case 0xF8: c->p |= FLAG_D; break;
+
+    /* Flow */
+    case 0x10: branch(c, !(c->p & FLAG_N)); break;
+    case 0x30: branch(c, (c->p & FLAG_N)); break;
+    case 0x50: branch(c, !(c->p & FLAG_V)); break;
+    case 0x70: branch(c, (c->p & FLAG_V)); break;
+    case 0x90: branch(c, !(c->p & FLAG_C)); break;
+    case 0xB0: branch(c, (c->p & FLAG_C)); break;
+    case 0xD0: branch(c, !(c->p & FLAG_Z)); break;
+    case 0xF0: branch(c, (c->p & FLAG_Z)); break;
+    case 0x4C: c->pc = ab(c); break;
+    case 0x6C: {  /* The high byte doesn't cross pages */
+      ea = ab(c);
+      c->pc = (RD(ea) | (RD((ea & 0xFF00) | ((ea + 1) & 0xFF)) << 8));
+      break;
+    }
+    case 0x20:
+      ea = ab(c);
+      c->pc--;
+      push(c, (c->pc >> 8));
+      push(c, (c->pc & 0xFF));
+      c->pc = ea;
+      break;
+    case 0x60:
+      c->pc = pull(c);
+      c->pc |= (pull(c) << 8);
+      c->pc++;
+      break;
+    case 0x40:
+      c->p = ((pull(c) & ~FLAG_B) | FLAG_U);
+      c->pc = pull(c);
+      c->pc |= (pull(c) << 8);
+      break;
+    case 0x00:
+      c->pc++;
+      interrupt(c, 0xFFFE, true);
+      break;
+
+    /* Undocumented opcodes used by SID tunes */
+    case 0x03: case 0x07: case 0x0F: case 0x13: case 0x17: case 0x1B: case 0x1F:
+      ea = ea_group(c, op, false); v = RD(ea); {
+        uint8_t old = v; setflag(c, FLAG_C, (v & 0x80)); v <<= 1;
+        rmw_write(c, ea, old, v); c->a |= v; setnz(c, c->a);
+      } break;
+    case 0x23: case 0x27: case 0x2F: case 0x33: case 0x37: case 0x3B: case 0x3F:
+      ea = ea_group(c, op, false); v = RD(ea); {
+        uint8_t old = v; v = rol(c, v);
+        rmw_write(c, ea, old, v); c->a &= v; setnz(c, c->a);
+      } break;
+    case 0x43: case 0x47: case 0x4F: case 0x53: case 0x57: case 0x5B: case 0x5F:
+      ea = ea_group(c, op, false); v = RD(ea); {
+        uint8_t old = v; v = lsr(c, v);
+        rmw_write(c, ea, old, v); c->a ^= v; setnz(c, c->a);
+      } break;
+    case 0x63: case 0x67: case 0x6F: case 0x73: case 0x77: case 0x7B: case 0x7F:
+      ea = ea_group(c, op, false); v = RD(ea); {
+        uint8_t old = v; v = ror(c, v);
+        rmw_write(c, ea, old, v); adc(c, v);
+      } break;
+    case 0xC3: case 0xC7: case 0xCF: case 0xD3: case 0xD7: case 0xDB: case 0xDF:
+      ea = ea_group(c, op, false); v = RD(ea); {
+        uint8_t old = v; v--;
+        rmw_write(c, ea, old, v); cmp(c, c->a, v);
+      } break;
+    case 0xE3: case 0xE7: case 0xEF: case 0xF3: case 0xF7: case 0xFB: case 0xFF:
+      ea = ea_group(c, op, false); v = RD(ea); {
+        uint8_t old = v; v++;
+        rmw_write(c, ea, old, v); sbc(c, v);
+      } break;
+    case 0x83: WR(izx(c), (c->a & c->x)); break;
+    case 0x87: WR(zp(c), (c->a & c->x)); break;
+    case 0x8F: WR(ab(c), (c->a & c->x)); break;
+    case 0x97: WR(zpy(c), (c->a & c->x)); break;
+    case 0xA3: c->a = c->x = RD(izx(c)); setnz(c, c->a); break;
+    case 0xA7: c->a = c->x = RD(zp(c)); setnz(c, c->a); break;
+    case 0xAF: c->a = c->x = RD(ab(c)); setnz(c, c->a); break;
+    case 0xB3: c->a = c->x = RD(izy(c, true)); setnz(c, c->a); break;
+    case 0xB7: c->a = c->x = RD(zpy(c)); setnz(c, c->a); break;
+    case 0xBF: c->a = c->x = RD(abi(c, c->y, true)); setnz(c, c->a); break;
+    case 0x0B: case 0x2B:
+      c->a &= RD(imm(c)); setnz(c, c->a); setflag(c, FLAG_C, (c->a & 0x80)); break;
+    case 0x4B:
+      c->a = lsr(c, (c->a & RD(imm(c)))); break;
+    case 0x6B:
+      c->a &= RD(imm(c));
+      c->a = ((c->a >> 1) | ((c->p & FLAG_C) << 7));
+      setnz(c, c->a);
+      setflag(c, FLAG_C, (c->a & 0x40));
+      setflag(c, FLAG_V, (((c->a >> 6) ^ (c->a >> 5)) & 1));
+      break;
+    case 0xCB: {
+      uint8_t ax = (c->a & c->x);
+      v = RD(imm(c));
+      setflag(c, FLAG_C, (ax >= v));
+      c->x = (uint8_t)(ax - v);
+      setnz(c, c->x);
+      break;
+    }
+    case 0x8B: c->a = ((c->a | 0xEE) & c->x & RD(imm(c))); setnz(c, c->a); break;
+    case 0xAB: c->a = c->x = ((c->a | 0xEE) & RD(imm(c))); setnz(c, c->a); break;
+    case 0xBB:
+      c->a = c->x = c->sp = (RD(abi(c, c->y, true)) & c->sp); setnz(c, c->a); break;
+    case 0x93: ea = izy(c, false); WR(ea, (c->a & c->x & ((ea >> 8) + 1))); break;
+    case 0x9F: ea = abi(c, c->y, false); WR(ea, (c->a & c->x & ((ea >> 8) + 1))); break;
+    case 0x9E: ea = abi(c, c->y, false); WR(ea, (c->x & ((ea >> 8) + 1))); break;
+    case 0x9C: ea = abi(c, c->x, false); WR(ea, (c->y & ((ea >> 8) + 1))); break;
+    case 0x9B:
+      ea = abi(c, c->y, false); c->sp = (c->a & c->x); WR(ea, (c->sp & ((ea >> 8) + 1))); break;
+
+    /* NOPs, with their operand reads */
+    case 0x1A: case 0x3A: case 0x5A: case 0x7A: case 0xDA: case 0xEA: case 0xFA: break;
+    case 0x80: case 0x82: case 0x89: case 0xC2: case 0xE2: c->pc++; break;
+    case 0x04: case 0x44: case 0x64: RD(zp(c)); break;
+    case 0x14: case 0x34: case 0x54: case 0x74: case 0xD4: case 0xF4: RD(zpx(c)); break;
+    case 0x0C: RD(ab(c)); break;
+    case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC: RD(abi(c, c->x, true)); break;
+
+    /* KIL */
+    default:
+      c->pc--;
+      c->jammed = true;
+      break;
+  }
+
+  c->cycles += c->icycles;
+  return c->icycles;
+}
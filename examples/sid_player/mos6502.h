@@ -0,0 +1,77 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * mos6502.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _MOS6502_H_
+#define _MOS6502_H_
+#pragma once
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* Status register flags */
+enum {
+  FLAG_C = 0x01,
+  FLAG_Z = 0x02,
+  FLAG_I = 0x04,
+  FLAG_D = 0x08,
+  FLAG_B = 0x10,
+  FLAG_U = 0x20,
+  FLAG_V = 0x40,
+  FLAG_N = 0x80,
+};
+
+typedef struct mos6502 {
+  uint16_t pc;
+  uint8_t  a, x, y, sp, p;
+  bool     irq;          /* IRQ line level, set by the machine */
+  bool     nmi;          /* NMI edge, cleared when taken */
+  bool     jammed;       /* A KIL opcode halted the cpu */
+  uint64_t cycles;       /* Cycles at the start of the current instruction */
+  uint8_t  icycles;      /* Cycles of the current instruction */
+  uint8_t  (*read)(void *ctx, uint16_t addr);
+  void     (*write)(void *ctx, uint16_t addr, uint8_t data);
+  void     *ctx;
+} mos6502_t;
+
+/* Cycle of the write that is being executed, stores write on their last cycle */
+static inline uint64_t mos6502_write_cycle(const mos6502_t *c)
+{
+  return (c->cycles + c->icycles - 1);
+}
+
+void mos6502_reset(mos6502_t *c, uint16_t pc);
+int  mos6502_step(mos6502_t *c);
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* _MOS6502_H_ */
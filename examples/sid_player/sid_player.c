@@ -0,0 +1,454 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sid_player.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <sys/time.h> // `struct timeval`
+
+#include <libusb.h>
+
+#include "sidplay.h"
+
+/* Runs the tune on the host and streams the SID writes with their cycle
+ * timing, USBSID-Pico only does the bus timing. Any board plays any tune.
+ *
+ * Compile with:
+ * gcc -O2 -L/usr/local/lib sid_player.c sidplay.c mos6502.c -o sid_player $(pkg-config --libs --cflags libusb-1.0)
+ */
+
+#define VENDOR_ID      0xcafe //5553
+#define PRODUCT_ID     0x4011
+#define ACM_CTRL_DTR   0x01
+#define ACM_CTRL_RTS   0x02
+
+#define PACKET_SIZE    64
+#define WRITES_PER_PACKET 15      /* 15 * { ADDR, DATA, CYCLES(2) } = 60 bytes */
+#define DEPTH_DEFAULT  8          /* Frames in flight */
+#define DEPTH_MAX      64
+
+static struct libusb_device_handle *devh = NULL;
+static unsigned char encoding[] = { 0x00, 0x10, 0x0E, 0x00, 0x00, 0x00, 0x08 };
+static int ep_out_addr = 0x02;
+
+static int rc;
+static int usid_dev = -1;
+
+enum {
+  /* Command bytes */
+  CYCLED_WRITE     = 0x80,  /* 0b10000000 ~ 128  */
+  PACKET_TYPE      = 0xC0,  /* 0b11000000 ~ 192  */
+  DELAY_CYCLES     = 0x05,  /*      0b101 ~ 0x05 */
+  RESET_SID        = 0x0E,  /*     0b1110 ~ 0x0E */
+  CONFIG           = 0x12,  /*    0b10010 ~ 0x12 */
+
+  /* Config commands */
+  SET_CLOCK        = 0x50,  /* Change SID clock frequency by array id */
+  CLOCK_PAL        = 1,
+  CLOCK_NTSC       = 2,
+};
+
+/* One frame of packets, submitted as a single bulk transfer */
+typedef struct frame {
+  struct libusb_transfer *xfer;
+  unsigned char *buf;
+  size_t len, cap;
+  volatile bool busy;
+} frame_t;
+
+static frame_t frames[DEPTH_MAX];
+static volatile sig_atomic_t stop = 0;
+static volatile bool usb_error = false;
+
+/* Packet builder */
+static size_t pkt_at;        /* Offset of the open packet in the frame */
+static int pkt_writes;       /* Writes in the open packet, 0 is closed */
+static uint64_t last_write;  /* Cycle of the previous write */
+
+
+/**
+ * @brief Initialize a connection with USBSID-Pico
+ *
+ * @return int
+ */
+int usbsid_init(void)
+{
+  if (devh != NULL) {
+    libusb_close(devh);
+  }
+
+  rc = libusb_init(NULL);
+  if (rc != 0) {
+  fprintf(stderr, "Error initializing libusb: %s: %s\n",
+    libusb_error_name(rc), libusb_strerror(rc));
+    goto out;
+  }
+
+  devh = libusb_open_device_with_vid_pid(NULL, VENDOR_ID, PRODUCT_ID);
+  if (!devh) {
+    fprintf(stderr, "Error finding USB device\n");
+    rc = -1;
+    goto out;
+  }
+
+  for (int if_num = 0; if_num < 2; if_num++) {
+    if (libusb_kernel_driver_active(devh, if_num) == 1) {
+      libusb_detach_kernel_driver(devh, if_num);
+    }
+    rc = libusb_claim_interface(devh, if_num);
+    if (rc < 0) {
+      fprintf(stderr, "Error claiming interface: %d, %s: %s\n",
+      rc, libusb_error_name(rc), libusb_strerror(rc));
+      goto out;
+    }
+  }
+
+  rc = libusb_control_transfer(devh, 0x21, 0x22, ACM_CTRL_DTR | ACM_CTRL_RTS, 0, NULL, 0, 0);
+  if (rc != 0 && rc != 7) {
+    fprintf(stderr, "?Error configuring line state during control transfer: %d, %s: %s\n",
+      rc, libusb_error_name(rc), libusb_strerror(rc));
+    goto out;
+  }
+
+  rc = libusb_control_transfer(devh, 0x21, 0x20, 0, 0, encoding, sizeof(encoding), 0);
+  if (rc != 0 && rc != 7) {
+  fprintf(stderr, "Error configuring line encoding during control transfer: %d, %s: %s\n",
+    rc, libusb_error_name(rc), libusb_strerror(rc));
+    goto out;
+  }
+
+  usid_dev = (rc == 0 || rc == 7) ? 0 : -1;
+
+  if (usid_dev < 0) {
+    fprintf(stderr, "Could not open SID device USBSID.\n");
+    goto out;
+  }
+
+  return usid_dev;
+out:
+  if (devh != NULL)
+  libusb_close(devh);
+  libusb_exit(NULL);
+  rc = -1;
+  return rc;
+}
+
+/**
+ * @brief Close the connection with USBSID-Pico
+ *
+ */
+void usbsid_close(void)
+{
+  for (int if_num = 0; if_num < 2; if_num++) {
+    libusb_release_interface(devh, if_num);
+    if (libusb_kernel_driver_active(devh, if_num)) {
+      libusb_detach_kernel_driver(devh, if_num);
+    }
+  }
+  libusb_close(devh);
+  libusb_exit(NULL);
+  return;
+}
+
+/**
+ * @brief Write a single packet to USBSID-Pico, blocking
+ *
+ * @param data
+ * @param size
+ */
+void write_chars(unsigned char * data, int size)
+{
+  int actual_length;
+  if (libusb_bulk_transfer(devh, ep_out_addr, data, size, &actual_length, 0) < 0) {
+    fprintf(stderr, "Error while sending char\n");
+  }
+  return;
+}
+
+static void on_sigint(int sig)
+{
+  (void)sig;
+  stop = 1;
+  return;
+}
+
+
+/**
+ * Packet stream
+ */
+
+static unsigned char *frame_packet(frame_t *f)
+{
+  if ((f->len + PACKET_SIZE) > f->cap) {
+    size_t cap = (f->cap ? (f->cap * 2) : (PACKET_SIZE * 64));
+    unsigned char *b = realloc(f->buf, cap);
+    if (b == NULL) {
+      perror("realloc failed");
+      exit(EXIT_FAILURE);
+    }
+    f->buf = b;
+    f->cap = cap;
+  }
+  unsigned char *p = &f->buf[f->len];
+  memset(p, 0, PACKET_SIZE);
+  f->len += PACKET_SIZE;
+  return p;
+}
+
+static void frame_delay(frame_t *f, uint16_t cycles)
+{
+  unsigned char *p = frame_packet(f);
+  p[0] = (PACKET_TYPE | DELAY_CYCLES);
+  p[1] = (cycles >> 8);
+  p[2] = (cycles & 0xFF);
+  pkt_writes = 0;
+  return;
+}
+
+/**
+ * @brief sidplay write callback, packs writes into cycled write packets
+ * @note the firmware delays each write relative to the previous one,
+ *       gaps longer than a 16 bit delay go out as DELAY_CYCLES first
+ */
+static void on_sid_write(void *ctx, uint64_t cycle, uint8_t reg, uint8_t data)
+{
+  frame_t *f = (frame_t *)ctx;
+  uint64_t delta = (cycle - last_write);
+  last_write = cycle;
+
+  while (delta > 0xFFFF) {
+    frame_delay(f, 0xFFFF);
+    delta -= 0xFFFF;
+  }
+  if (pkt_writes == 0) {
+    frame_packet(f);
+    pkt_at = (f->len - PACKET_SIZE);
+  }
+  unsigned char *p = &f->buf[pkt_at];
+  unsigned char *w = &p[(1 + (pkt_writes * 4))];
+  w[0] = reg;
+  w[1] = data;
+  w[2] = ((delta >> 8) & 0xFF);
+  w[3] = (delta & 0xFF);
+  pkt_writes++;
+  p[0] = (CYCLED_WRITE | (pkt_writes * 4));
+  if (pkt_writes == WRITES_PER_PACKET) pkt_writes = 0;
+  return;
+}
+
+static void LIBUSB_CALL on_transfer(struct libusb_transfer *xfer)
+{
+  frame_t *f = (frame_t *)xfer->user_data;
+  if (xfer->status != LIBUSB_TRANSFER_COMPLETED && xfer->status != LIBUSB_TRANSFER_CANCELLED) {
+    fprintf(stderr, "Transfer failed with status %d\n", xfer->status);
+    usb_error = true;
+  }
+  f->busy = false;
+  return;
+}
+
+static void wait_frame(frame_t *f)
+{
+  struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+  while (f->busy) {
+    if (stop && f->xfer) libusb_cancel_transfer(f->xfer);
+    libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+  }
+  return;
+}
+
+static int submit_frame(frame_t *f)
+{
+  if (f->xfer == NULL && (f->xfer = libusb_alloc_transfer(0)) == NULL) return -1;
+  libusb_fill_bulk_transfer(f->xfer, devh, ep_out_addr, f->buf, (int)f->len, on_transfer, f, 0);
+  f->busy = true;
+  int r = libusb_submit_transfer(f->xfer);
+  if (r < 0) {
+    f->busy = false;
+    fprintf(stderr, "Error submitting transfer: %s\n", libusb_error_name(r));
+  }
+  return r;
+}
+
+static void send_command(unsigned char cmd, unsigned char arg)
+{
+  unsigned char buff[PACKET_SIZE] = {0};
+  buff[0] = (PACKET_TYPE | cmd);
+  buff[1] = arg;
+  write_chars(buff, PACKET_SIZE);
+  return;
+}
+
+/**
+ * @brief Run the tune and keep depth frames queued on the device
+ *
+ * @param sidplay_t *s
+ * @param int depth
+ * @param uint64_t end, absolute cycle to stop at
+ * @return int 0 on success
+ */
+static int stream(sidplay_t *s, int depth, uint64_t end)
+{
+  uint64_t target = 0;
+  int slot = 0, result = 0;
+
+  s->write = on_sid_write;
+  last_write = 0;
+  while (!stop && !usb_error && target < end) {
+    frame_t *f = &frames[slot];
+    wait_frame(f);
+    if (stop || usb_error) break;
+
+    f->len = 0;
+    pkt_writes = 0;
+    s->write_ctx = f;
+    target += s->frame_cycles;
+    sidplay_run(s, target);
+    if (s->cpu.jammed) {
+      fprintf(stderr, "CPU jammed at $%04X\n", s->cpu.pc);
+      result = -1;
+      break;
+    }
+    if (f->len == 0) continue;  /* Nothing written this frame, the next write carries the gap */
+    if (submit_frame(f) < 0) {
+      result = -1;
+      break;
+    }
+    slot = ((slot + 1) % depth);
+  }
+
+  for (int i = 0; i < depth; i++) {
+    wait_frame(&frames[i]);
+    if (frames[i].xfer) libusb_free_transfer(frames[i].xfer);
+    free(frames[i].buf);
+  }
+  return (usb_error ? -1 : result);
+}
+
+/**
+ * @brief Print help to stdout
+ *
+ */
+void print_help(void)
+{
+  fprintf(stdout, "*** Usage ***\n");
+  fprintf(stdout, "\n");
+  fprintf(stdout, "sid_player [options] sidfile.sid\n");
+  fprintf(stdout, "  -h: Show this information\n");
+  fprintf(stdout, "  -t N: subtune to play (defaults to the start song)\n");
+  fprintf(stdout, "  -s N: stop after N seconds (defaults to forever, Ctrl+C stops)\n");
+  fprintf(stdout, "  -d N: frames queued ahead on the device (defaults to %d, max %d)\n", DEPTH_DEFAULT, DEPTH_MAX);
+  fprintf(stdout, "\n");
+  fprintf(stdout, "The tune runs on this computer, PSID and RSID with CIA and raster timing.\n");
+  fprintf(stdout, "USBSID-Pico receives cycle timed SID writes and only does the bus timing.\n");
+  return;
+}
+
+/**
+ * @brief Main entrypoint
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char* argv[])
+{
+  int result = EXIT_FAILURE;
+  int song = 0, seconds = 0, depth = DEPTH_DEFAULT;
+  const char *filename = NULL;
+
+  for (int a = 1; a < argc; a++) {
+    if (!strcmp(argv[a], "-h") || !strcmp(argv[a], "--help")) {
+      print_help();
+      return EXIT_SUCCESS;
+    } else if (!strcmp(argv[a], "-t") && (a + 1) < argc) {
+      song = atoi(argv[++a]);
+    } else if (!strcmp(argv[a], "-s") && (a + 1) < argc) {
+      seconds = atoi(argv[++a]);
+    } else if (!strcmp(argv[a], "-d") && (a + 1) < argc) {
+      depth = atoi(argv[++a]);
+    } else {
+      filename = argv[a];
+    }
+  }
+  if (filename == NULL) {
+    print_help();
+    return EXIT_FAILURE;
+  }
+  if (depth < 1) depth = 1;
+  if (depth > DEPTH_MAX) depth = DEPTH_MAX;
+
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    perror(filename);
+    return EXIT_FAILURE;
+  }
+  static unsigned char file[0x10000 + 0x7C + 2];
+  size_t size = fread(file, 1, sizeof(file), fp);
+  fclose(fp);
+
+  sidplay_t *s = malloc(sizeof(sidplay_t));
+  if (s == NULL) {
+    perror("malloc failed");
+    return EXIT_FAILURE;
+  }
+  int r = sidplay_load(s, file, size);
+  if (r == SIDPLAY_OK) r = sidplay_init(s, (uint16_t)song);
+  if (r != SIDPLAY_OK) {
+    fprintf(stderr, "%s: %s\n", filename, sidplay_error(r));
+    free(s);
+    return EXIT_FAILURE;
+  }
+  fprintf(stdout, "%s %.32s: song %u/%u, $%04X-$%04X init $%04X play $%04X, %u SID(s), %s\n",
+    (s->rsid ? "RSID" : "PSID"), (const char*)&file[0x16], s->song, s->songs,
+    s->load, (unsigned)(s->load + s->datalen - 1), s->init, s->play, s->numsids,
+    (s->pal ? "PAL" : "NTSC"));
+
+  if (usbsid_init() != 0) {
+    free(s);
+    return EXIT_FAILURE;
+  }
+  signal(SIGINT, on_sigint);
+
+  unsigned char buff[PACKET_SIZE] = {0};
+  buff[0] = (PACKET_TYPE | CONFIG);
+  buff[1] = SET_CLOCK;
+  buff[2] = (s->pal ? CLOCK_PAL : CLOCK_NTSC);
+  write_chars(buff, PACKET_SIZE);  /* Ignored when the clock is locked */
+  send_command(RESET_SID, 0);
+
+  uint64_t end = (seconds > 0 ? ((uint64_t)seconds * s->clock) : UINT64_MAX);
+  if (stream(s, depth, end) == 0) result = EXIT_SUCCESS;
+
+  send_command(RESET_SID, 1);  /* Silence */
+  usbsid_close();
+  free(s);
+  return result;
+}
@@ -0,0 +1,516 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sidplay.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include "sidplay.h"
+
+
+/* PSID/RSID header fields, big endian */
+#define PSID_VERSION     0x04
+#define PSID_DATAOFFSET  0x06
+#define PSID_LOADADDRESS 0x08
+#define PSID_INITADDRESS 0x0A
+#define PSID_PLAYADDRESS 0x0C
+#define PSID_SONGS       0x0E
+#define PSID_STARTSONG   0x10
+#define PSID_SPEED       0x12
+#define PSID_FLAGS       0x76
+#define PSID_SECONDSID   0x7A
+#define PSID_THIRDSID    0x7B
+
+/* Init and play return here, the cpu idles on it like a `JMP *` */
+#define RETURN_SENTINEL  0xFFF8
+
+/* Frame length in cycles for VBI tunes */
+#define PAL_FRAME        (312 * 63)
+#define NTSC_FRAME       (263 * 65)
+/* CIA1 timer A after a kernal reset */
+#define PAL_CIA_LATCH    0x4025
+#define NTSC_CIA_LATCH   0x4295
+
+/* Kernal stub, everything not listed is RTS */
+static const struct { uint16_t addr; uint8_t len; uint8_t code[20]; } kernal_stub[] = {
+  /* IRQ entry: save registers, then BRK or IRQ vector */
+  { 0xFF48, 19, { 0x48, 0x8A, 0x48, 0x98, 0x48, 0xBA, 0xBD, 0x04, 0x01, 0x29,
+                  0x10, 0xF0, 0x03, 0x6C, 0x16, 0x03, 0x6C, 0x14, 0x03 } },
+  /* $EA31 default IRQ handler: acknowledge CIA1 and exit */
+  { 0xEA31, 6, { 0xAD, 0x0D, 0xDC, 0x4C, 0x81, 0xEA } },
+  /* $EA81 restore registers and RTI */
+  { 0xEA81, 6, { 0x68, 0xA8, 0x68, 0xAA, 0x68, 0x40 } },
+  /* NMI entry through $0318, default handler is a plain RTI */
+  { 0xFE43, 5, { 0x78, 0x6C, 0x18, 0x03, 0x40 } },
+  /* Hardware vectors */
+  { 0xFFFA, 6, { 0x43, 0xFE, 0xE2, 0xFC, 0x48, 0xFF } },
+};
+
+
+/**
+ * Helpers
+ */
+
+static inline uint16_t read_be16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t read_be32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+}
+
+static inline bool io_visible(const sidplay_t *s)
+{
+  uint8_t port = (s->ram[1] & 7);
+  return ((port & 4) && (port & 3));
+}
+
+static inline bool kernal_visible(const sidplay_t *s)
+{
+  return (s->ram[1] & 2);
+}
+
+/* PSID banking, depends on where the routine that is called lives */
+static inline uint8_t psid_bank(uint16_t addr)
+{
+  return ((addr < 0xA000) ? 0x37 : (addr < 0xD000) ? 0x36 : 0x35);
+}
+
+static void update_interrupts(sidplay_t *s)
+{
+  bool deliver = (s->rsid || s->play == 0);
+  bool irq = ((s->cia1.icr_data & s->cia1.icr_mask & 0x1F) || (s->vic_irq & s->vic_irq_mask & 0x0F));
+  bool nmi = (s->cia2.icr_data & s->cia2.icr_mask & 0x1F);
+  s->cpu.irq = (deliver && irq);
+  if (deliver && nmi && !s->nmi_line) s->cpu.nmi = true;
+  s->nmi_line = nmi;
+  return;
+}
+
+
+/**
+ * CIA
+ */
+
+static void cia_reset(cia_t *cia)
+{
+  memset(cia, 0, sizeof(cia_t));
+  cia->ta = cia->tb = cia->la = cia->lb = 0xFFFF;
+  return;
+}
+
+/* Count down n cycles, returns the number of underflows */
+static uint32_t timer_count(uint16_t *counter, uint16_t latch, uint32_t n)
+{
+  uint32_t t = *counter;
+  if (n <= t) {
+    *counter = (uint16_t)(t - n);
+    return 0;
+  }
+  n -= (t + 1);
+  uint32_t period = ((uint32_t)latch + 1);
+  *counter = (uint16_t)(latch - (n % period));
+  return (1 + (n / period));
+}
+
+static void cia_tick(cia_t *cia, uint32_t n)
+{
+  uint32_t underflows = 0;
+  if (cia->cra & 0x01) {
+    underflows = timer_count(&cia->ta, cia->la, n);
+    if (underflows) {
+      cia->icr_data |= 0x01;
+      if (cia->cra & 0x08) {  /* One shot */
+        cia->cra &= ~0x01;
+        cia->ta = cia->la;
+      }
+    }
+  }
+  if (cia->crb & 0x01) {
+    uint32_t count;
+    switch ((cia->crb >> 5) & 3) {
+      case 0: count = n; break;
+      case 2: case 3: count = underflows; break;
+      default: count = 0; break;  /* CNT pin, not connected */
+    }
+    if (count && timer_count(&cia->tb, cia->lb, count)) {
+      cia->icr_data |= 0x02;
+      if (cia->crb & 0x08) {
+        cia->crb &= ~0x01;
+        cia->tb = cia->lb;
+      }
+    }
+  }
+  return;
+}
+
+static uint8_t cia_read(cia_t *cia, uint8_t reg)
+{
+  switch (reg) {
+    case 0x04: return (cia->ta & 0xFF);
+    case 0x05: return (cia->ta >> 8);
+    case 0x06: return (cia->tb & 0xFF);
+    case 0x07: return (cia->tb >> 8);
+    case 0x0D: {  /* Reading acknowledges */
+      uint8_t v = (cia->icr_data | ((cia->icr_data & cia->icr_mask & 0x1F) ? 0x80 : 0));
+      cia->icr_data = 0;
+      return v;
+    }
+    case 0x0E: return cia->cra;
+    case 0x0F: return cia->crb;
+    default: return cia->regs[reg];
+  }
+}
+
+static void cia_write(cia_t *cia, uint8_t reg, uint8_t data)
+{
+  switch (reg) {
+    case 0x04: cia->la = ((cia->la & 0xFF00) | data); break;
+    case 0x05:
+      cia->la = ((cia->la & 0x00FF) | (data << 8));
+      if (!(cia->cra & 0x01)) cia->ta = cia->la;
+      break;
+    case 0x06: cia->lb = ((cia->lb & 0xFF00) | data); break;
+    case 0x07:
+      cia->lb = ((cia->lb & 0x00FF) | (data << 8));
+      if (!(cia->crb & 0x01)) cia->tb = cia->lb;
+      break;
+    case 0x0D:
+      if (data & 0x80) cia->icr_mask |= (data & 0x1F);
+      else cia->icr_mask &= ~(data & 0x1F);
+      break;
+    case 0x0E:
+      if (data & 0x10) cia->ta = cia->la;  /* Force load strobe */
+      cia->cra = (data & ~0x10);
+      break;
+    case 0x0F:
+      if (data & 0x10) cia->tb = cia->lb;
+      cia->crb = (data & ~0x10);
+      break;
+    default: cia->regs[reg] = data; break;
+  }
+  return;
+}
+
+
+/**
+ * VIC raster
+ */
+
+static void vic_tick(sidplay_t *s, uint32_t n)
+{
+  s->raster_cycle += n;
+  while (s->raster_cycle >= s->raster_cycles) {
+    s->raster_cycle -= s->raster_cycles;
+    if (++s->raster >= s->raster_lines) s->raster = 0;
+    if (s->raster == s->raster_irq_line) s->vic_irq |= 0x01;
+  }
+  return;
+}
+
+static uint8_t vic_read(sidplay_t *s, uint8_t reg)
+{
+  switch (reg) {
+    case 0x11: return ((s->d011 & 0x7F) | ((s->raster >> 1) & 0x80));
+    case 0x12: return (s->raster & 0xFF);
+    case 0x19: return (s->vic_irq | ((s->vic_irq & s->vic_irq_mask) ? 0x80 : 0) | 0x70);
+    case 0x1A: return (s->vic_irq_mask | 0xF0);
+    default: return 0xFF;
+  }
+}
+
+static void vic_write(sidplay_t *s, uint8_t reg, uint8_t data)
+{
+  switch (reg) {
+    case 0x11:
+      s->d011 = data;
+      s->raster_irq_line = ((s->raster_irq_line & 0xFF) | ((data & 0x80) << 1));
+      break;
+    case 0x12: s->raster_irq_line = ((s->raster_irq_line & 0x100) | data); break;
+    case 0x19: s->vic_irq &= ~(data & 0x0F); break;
+    case 0x1A: s->vic_irq_mask = (data & 0x0F); break;
+    default: break;
+  }
+  return;
+}
+
+
+/**
+ * Memory
+ */
+
+/* SID number for an IO address or -1, extra SIDs take priority over the $D400 mirrors */
+static int sid_number(const sidplay_t *s, uint16_t addr)
+{
+  for (int i = (s->numsids - 1); i > 0; i--) {
+    if ((addr & 0xFFE0) == s->sidbase[i]) return i;
+  }
+  return ((addr >= 0xD400 && addr < 0xD800) ? 0 : -1);
+}
+
+static uint8_t mem_read(void *ctx, uint16_t addr)
+{
+  sidplay_t *s = (sidplay_t *)ctx;
+  if (addr >= 0xD000 && addr < 0xE000 && io_visible(s)) {
+    if (sid_number(s, addr) >= 0) {  /* Only OSC3/ENV3 are readable, no readback from the device */
+      uint8_t reg = (addr & 0x1F);
+      return ((reg == 0x1B || reg == 0x1C) ? (uint8_t)(s->cpu.cycles >> 2) : 0);
+    }
+    switch (addr >> 8) {
+      case 0xD0: case 0xD1: case 0xD2: case 0xD3: return vic_read(s, (addr & 0x3F));
+      case 0xDC: return cia_read(&s->cia1, (addr & 0x0F));
+      case 0xDD: return cia_read(&s->cia2, (addr & 0x0F));
+      default: return s->ram[addr];  /* Color RAM and open IO */
+    }
+  }
+  if (addr >= 0xE000 && kernal_visible(s)) return s->kernal[(addr - 0xE000)];
+  return s->ram[addr];
+}
+
+static void mem_write(void *ctx, uint16_t addr, uint8_t data)
+{
+  sidplay_t *s = (sidplay_t *)ctx;
+  if (addr >= 0xD000 && addr < 0xE000 && io_visible(s)) {
+    int sid = sid_number(s, addr);
+    if (sid >= 0) {
+      if (s->write) s->write(s->write_ctx, mos6502_write_cycle(&s->cpu), (uint8_t)((sid * 0x20) | (addr & 0x1F)), data);
+      return;
+    }
+    switch (addr >> 8) {
+      case 0xD0: case 0xD1: case 0xD2: case 0xD3: vic_write(s, (addr & 0x3F), data); break;
+      case 0xDC: cia_write(&s->cia1, (addr & 0x0F), data); break;
+      case 0xDD: cia_write(&s->cia2, (addr & 0x0F), data); break;
+      default: s->ram[addr] = data; break;
+    }
+    update_interrupts(s);
+    return;
+  }
+  s->ram[addr] = data;  /* Writes under ROM always land in RAM */
+  return;
+}
+
+
+/**
+ * Running
+ */
+
+static void call(sidplay_t *s, uint16_t addr, uint8_t a)
+{
+  uint16_t ret = (RETURN_SENTINEL - 1);
+  s->cpu.write(s, (0x100 | s->cpu.sp--), (ret >> 8));
+  s->cpu.write(s, (0x100 | s->cpu.sp--), (ret & 0xFF));
+  s->cpu.a = a;
+  s->cpu.pc = addr;
+  if (!s->rsid) s->ram[1] = psid_bank(addr);
+  s->in_call = true;
+  return;
+}
+
+static uint32_t play_period(const sidplay_t *s)
+{
+  uint8_t song = ((s->song > 32) ? 31 : (s->song - 1));
+  if ((s->speed >> song) & 1) {
+    return (s->cia1.la ? ((uint32_t)s->cia1.la + 1) : s->frame_cycles);
+  }
+  return s->frame_cycles;
+}
+
+static void tick(sidplay_t *s, uint32_t n)
+{
+  cia_tick(&s->cia1, n);
+  cia_tick(&s->cia2, n);
+  vic_tick(s, n);
+  update_interrupts(s);
+  return;
+}
+
+/**
+ * @brief Parse a PSID/RSID file
+ * @note the file must stay valid until the player is done with it
+ *
+ * @param sidplay_t *s
+ * @param const uint8_t *file
+ * @param size_t size
+ * @return int SIDPLAY_OK or an error
+ */
+int sidplay_load(sidplay_t *s, const uint8_t *file, size_t size)
+{
+  memset(s, 0, sizeof(sidplay_t));
+  if (size < 0x7C || ((memcmp(file, "PSID", 4) != 0) && (memcmp(file, "RSID", 4) != 0))) {
+    return SIDPLAY_ERR_HEADER;
+  }
+  s->rsid = (file[0] == 'R');
+  uint16_t version = read_be16(&file[PSID_VERSION]);
+  uint16_t offset = read_be16(&file[PSID_DATAOFFSET]);
+  if (version < 1 || version > 4 || offset < 0x76 || ((size_t)offset + 2) > size) return SIDPLAY_ERR_HEADER;
+
+  s->load = read_be16(&file[PSID_LOADADDRESS]);
+  s->init = read_be16(&file[PSID_INITADDRESS]);
+  s->play = read_be16(&file[PSID_PLAYADDRESS]);
+  s->songs = read_be16(&file[PSID_SONGS]);
+  s->startsong = read_be16(&file[PSID_STARTSONG]);
+  s->speed = read_be32(&file[PSID_SPEED]);
+  s->data = &file[offset];
+  s->datalen = (size - offset);
+  if (s->load == 0) {  /* Load address is in the first two data bytes */
+    s->load = (s->data[0] | s->data[1] << 8);
+    s->data += 2;
+    s->datalen -= 2;
+  }
+  if ((s->load + s->datalen) > 0x10000) return SIDPLAY_ERR_SIZE;
+  if (s->init == 0) s->init = s->load;
+  if (s->songs == 0) s->songs = 1;
+  if (s->startsong == 0 || s->startsong > s->songs) s->startsong = 1;
+
+  uint16_t flags = ((version >= 2) ? read_be16(&file[PSID_FLAGS]) : 0);
+  if (s->rsid && (flags & 0x02)) return SIDPLAY_ERR_BASIC;
+  s->pal = (((flags >> 2) & 3) != 2);  /* Unknown and both play as PAL */
+  s->clock = (s->pal ? SIDPLAY_PAL_CLOCK : SIDPLAY_NTSC_CLOCK);
+  s->frame_cycles = (s->pal ? PAL_FRAME : NTSC_FRAME);
+
+  s->sidbase[0] = 0xD400;
+  s->numsids = 1;
+  /* Address byte xx maps to $Dxx0, only even values from $42 are valid */
+  uint8_t extra[2] = {
+    ((version >= 3) ? file[PSID_SECONDSID] : 0),
+    ((version >= 4) ? file[PSID_THIRDSID] : 0),
+  };
+  for (int i = 0; i < 2; i++) {
+    uint8_t b = extra[i];
+    if (b == 0 || (b & 1) || (b < 0x42) || (b > 0x7F && b < 0xE0)) break;
+    s->sidbase[s->numsids++] = (0xD000 | (b << 4));
+  }
+  return SIDPLAY_OK;
+}
+
+/**
+ * @brief Set up the machine and call init for song
+ *
+ * @param sidplay_t *s
+ * @param uint16_t song, 1 based, 0 for the start song
+ * @return int SIDPLAY_OK or an error
+ */
+int sidplay_init(sidplay_t *s, uint16_t song)
+{
+  if (song == 0) song = s->startsong;
+  if (song > s->songs) return SIDPLAY_ERR_SONG;
+  s->song = song;
+
+  memset(s->ram, 0, sizeof(s->ram));
+  memset(s->kernal, 0x60, sizeof(s->kernal));
+  for (size_t i = 0; i < (sizeof(kernal_stub) / sizeof(kernal_stub[0])); i++) {
+    memcpy(&s->kernal[(kernal_stub[i].addr - 0xE000)], kernal_stub[i].code, kernal_stub[i].len);
+  }
+  s->ram[0] = 0x2F;
+  s->ram[1] = 0x37;
+  s->ram[0x02A6] = (s->pal ? 1 : 0);
+  s->ram[0x0314] = 0x31; s->ram[0x0315] = 0xEA;
+  s->ram[0x0316] = 0x81; s->ram[0x0317] = 0xEA;
+  s->ram[0x0318] = 0x47; s->ram[0x0319] = 0xFE;
+  memcpy(&s->ram[s->load], s->data, s->datalen);
+
+  cia_reset(&s->cia1);
+  cia_reset(&s->cia2);
+  s->cia1.la = s->cia1.ta = (s->pal ? PAL_CIA_LATCH : NTSC_CIA_LATCH);
+  s->cia1.cra = 0x01;
+  s->cia1.icr_mask = 0x01;
+  s->nmi_line = false;
+
+  s->raster_lines = (s->pal ? 312 : 263);
+  s->raster_cycles = (s->pal ? 63 : 65);
+  s->raster = s->raster_cycle = 0;
+  s->raster_irq_line = 0;
+  s->vic_irq = s->vic_irq_mask = 0;
+  s->d011 = 0x1B;
+
+  mos6502_t *c = &s->cpu;
+  c->read = mem_read;
+  c->write = mem_write;
+  c->ctx = s;
+  c->cycles = 0;
+  mos6502_reset(c, RETURN_SENTINEL);
+  s->playing = false;
+  call(s, s->init, (uint8_t)(song - 1));
+  return SIDPLAY_OK;
+}
+
+/**
+ * @brief Run the machine up to a cycle
+ * @note PSID tunes with a play address get play called every frame,
+ *       everything else runs from its own interrupts after init
+ *
+ * @param sidplay_t *s
+ * @param uint64_t until, absolute cycle
+ * @return uint64_t the cycle the machine stopped at, >= until
+ */
+uint64_t sidplay_run(sidplay_t *s, uint64_t until)
+{
+  mos6502_t *c = &s->cpu;
+  bool play_mode = (!s->rsid && s->play != 0);
+
+  while (c->cycles < until && !c->jammed) {
+    if (c->pc == RETURN_SENTINEL) {
+      if (s->in_call) {
+        s->in_call = false;
+        if (!s->playing) {  /* Init returned */
+          s->playing = true;
+          s->next_play = (c->cycles + play_period(s));
+          if (!play_mode) c->p &= ~FLAG_I;
+        }
+      }
+      if (play_mode && c->cycles >= s->next_play) {
+        call(s, s->play, 0);
+        s->next_play += play_period(s);
+        if (s->next_play <= c->cycles) s->next_play = (c->cycles + play_period(s));  /* Overran, drop frames */
+        continue;
+      }
+      if (!c->nmi && !(c->irq && !(c->p & FLAG_I))) {  /* Idle like `JMP *` */
+        c->cycles += 3;
+        tick(s, 3);
+        continue;
+      }
+    }
+    tick(s, (uint32_t)mos6502_step(c));
+  }
+  return c->cycles;
+}
+
+/**
+ * @brief Error text for a sidplay error
+ *
+ * @param int err
+ * @return const char*
+ */
+const char *sidplay_error(int err)
+{
+  switch (err) {
+    case SIDPLAY_OK: return "ok";
+    case SIDPLAY_ERR_HEADER: return "not a valid PSID/RSID file";
+    case SIDPLAY_ERR_SIZE: return "tune does not fit in C64 memory";
+    case SIDPLAY_ERR_SONG: return "song number out of range";
+    case SIDPLAY_ERR_BASIC: return "RSID BASIC tunes are not supported";
+    default: return "unknown error";
+  }
+}
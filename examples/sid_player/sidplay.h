@@ -0,0 +1,115 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sidplay.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _SIDPLAY_H_
+#define _SIDPLAY_H_
+#pragma once
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "mos6502.h"
+
+
+/* Host side C64 for running PSID/RSID tunes
+ *
+ * Only what SID tunes use is emulated: RAM with the processor port banking,
+ * a kernal stub with the IRQ/NMI entry and exit sequences, both CIA's timers
+ * and interrupt control, and the VIC raster interrupt. Every SID write is
+ * handed to the write callback with the absolute cycle it happened on and
+ * the USBSID register address (SID number * 0x20 + register).
+ */
+
+#define SIDPLAY_MAXSIDS      4
+#define SIDPLAY_PAL_CLOCK    985248
+#define SIDPLAY_NTSC_CLOCK   1022727
+
+enum {
+  SIDPLAY_OK         =  0,
+  SIDPLAY_ERR_HEADER = -1,  /* Not a PSID/RSID file or a broken header */
+  SIDPLAY_ERR_SIZE   = -2,  /* Data doesn't fit in C64 memory */
+  SIDPLAY_ERR_SONG   = -3,  /* Song number out of range */
+  SIDPLAY_ERR_BASIC  = -4,  /* RSID BASIC tunes need a real kernal */
+};
+
+typedef void (*sidplay_write_cb)(void *ctx, uint64_t cycle, uint8_t reg, uint8_t data);
+
+typedef struct cia {
+  uint16_t ta, tb;       /* Counters */
+  uint16_t la, lb;       /* Latches */
+  uint8_t  cra, crb;
+  uint8_t  icr_mask;
+  uint8_t  icr_data;
+  uint8_t  regs[16];     /* Ports and TOD, stored only */
+} cia_t;
+
+typedef struct sidplay {
+  mos6502_t cpu;
+  uint8_t   ram[0x10000];
+  uint8_t   kernal[0x2000];
+  cia_t     cia1, cia2;
+  bool      nmi_line;    /* CIA2 interrupt output, NMI is edge triggered */
+
+  /* VIC raster */
+  uint16_t  raster_lines, raster_cycles;
+  uint16_t  raster, raster_cycle, raster_irq_line;
+  uint8_t   vic_irq, vic_irq_mask, d011;
+
+  /* Tune */
+  const uint8_t *data;   /* C64 data of the file, owned by the caller */
+  size_t    datalen;
+  bool      rsid, pal;
+  uint16_t  load, init, play, songs, startsong, song;
+  uint32_t  speed;       /* Bit per song, set plays from the CIA timer */
+  uint16_t  sidbase[SIDPLAY_MAXSIDS];
+  uint8_t   numsids;
+  uint32_t  frame_cycles;
+  uint32_t  clock;
+
+  /* Run state */
+  bool      playing;     /* Init returned */
+  bool      in_call;     /* Running init or play from the host */
+  uint64_t  next_play;
+
+  sidplay_write_cb write;
+  void      *write_ctx;
+} sidplay_t;
+
+int      sidplay_load(sidplay_t *s, const uint8_t *file, size_t size);
+int      sidplay_init(sidplay_t *s, uint16_t song);
+uint64_t sidplay_run(sidplay_t *s, uint64_t until);
+const char *sidplay_error(int err);
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* _SIDPLAY_H_ */
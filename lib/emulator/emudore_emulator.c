@@ -57,6 +57,7 @@ extern unsigned int run_specified_cycle(
   bool callback,
   bool cpu, bool cia1, bool cia2,
   bool vic, bool io,   bool cart);
+extern unsigned int run_cynthcart_batch(unsigned int cycles);
 extern void _set_logging(void);
 extern void logging_enable(int logid);
 extern void logging_disable(int logid);
@@ -97,14 +98,6 @@ void stop_cynthcart(void)
 }
 
 unsigned int run_cynthcart(void)
-{
-  return run_specified_cycle(
-    false, // callback
-    true,  // cpu
-    true,  // cia1
-    false, // cia2
-    true,  // vic
-    false, // io
-    true   // cart
-  );
+{ /* CPU, CIA1, VIC & cart for up to EMULATOR_BATCH_CYCLES per core 1 loop */
+  return run_cynthcart_batch(EMULATOR_BATCH_CYCLES);
 }
@@ -35,6 +35,9 @@
 #endif
 
 
+/* Cycles per run call, the core 1 loop runs in between batches */
+#define EMULATOR_BATCH_CYCLES 64
+
 /* Functions from emodure_emulator.c */
 void start_cynthcart(void);
 void stop_cynthcart(void);
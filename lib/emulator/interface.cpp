@@ -39,6 +39,7 @@
 extern "C" {
   #include "globals.h"
   #include "logging.h"
+  #include "midi.h"
 }
 
 
@@ -264,6 +265,24 @@ extern "C" unsigned int run_specified_cycle(
   return c64_->emulate_specified(callback,cpu,cia1,cia2,vic,io,cart);
 }
 
+/**
+ * @brief Cynthcart: CPU + CIA1 + VIC + cart, a batch of cycles per call
+ * saves the C interface call and the core 1 loop per cycle
+ * returns early when the host loop has MIDI input for the cart
+ *
+ * @param cycles, the maximum number of cycles to run
+ * @return the summed result of the emulated cycles
+ */
+extern "C" unsigned int run_cynthcart_batch(unsigned int cycles)
+{
+  unsigned int r = 0;
+  for (unsigned int i = 0; i < cycles; i++) {
+    r += c64_->emulate_specified(false,true,true,false,true,false,true);
+    if (emulator_midi_pending()) break; /* MIDI input for the cart */
+  }
+  return r;
+}
+
 /**
  * @brief stop Emudore and free up memory
  */
@@ -0,0 +1,94 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * arena.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "hardware/sync.h"
+
+#include <globals.h>
+#include <logging.h>
+#include <arena.h>
+
+
+#define _ARENA_STR(x) #x
+#define ARENA_STR(x) _ARENA_STR(x)
+#pragma message("Mode arena: ASID " ARENA_STR(ARENA_ASID_SIZE) " bytes, SID player " ARENA_STR(ARENA_SIDPLAYER_SIZE) " bytes")
+
+static uint8_t arena[ARENA_SIZE] __aligned(8);  /* .bss, not copied at boot */
+static volatile ArenaMode owner = ARENA_FREE;
+/* Both cores change the owner, a striped lock is meant for short uncontended sections like this */
+#define ARENA_SPINLOCK_ID PICO_SPINLOCK_ID_STRIPED_FIRST
+
+static const size_t arena_layout[] = {
+  [ARENA_FREE]      = 0,
+  [ARENA_ASID]      = ARENA_ASID_SIZE,
+  [ARENA_SIDPLAYER] = ARENA_SIDPLAYER_SIZE,
+};
+
+
+/**
+ * @brief Take the arena for a mode
+ * @note calling it again from the owning mode returns the same block
+ * @note and clears it again, a new upload never sees the old image
+ *
+ * @param ArenaMode mode
+ * @param size_t size, bytes to clear, at most the layout size of the mode
+ * @return void* start of the arena or NULL if another mode owns it
+ */
+void *arena_acquire(ArenaMode mode, size_t size)
+{
+  if (mode == ARENA_FREE || size > arena_layout[mode]) {
+    usERR("[ARENA] %u bytes exceeds the layout of mode %d\n", size, mode);
+    return NULL;
+  }
+  spin_lock_t *lock = spin_lock_instance(ARENA_SPINLOCK_ID);
+  uint32_t save = spin_lock_blocking(lock);
+  ArenaMode held = owner;
+  if (held == ARENA_FREE) owner = mode;
+  spin_unlock(lock, save);
+  if (held != ARENA_FREE && held != mode) {
+    usERR("[ARENA] Mode %d requested while owned by mode %d\n", mode, held);
+    return NULL;
+  }
+  memset(arena, 0, size);
+  return arena;
+}
+
+/**
+ * @brief Release the arena if the mode owns it
+ *
+ * @param ArenaMode mode
+ */
+void arena_release(ArenaMode mode)
+{
+  spin_lock_t *lock = spin_lock_instance(ARENA_SPINLOCK_ID);
+  uint32_t save = spin_lock_blocking(lock);
+  if (owner == mode) owner = ARENA_FREE;
+  spin_unlock(lock, save);
+  return;
+}
+
+ArenaMode arena_owner(void)
+{
+  return owner;
+}
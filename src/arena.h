@@ -0,0 +1,72 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * arena.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _USBSID_ARENA_H_
+#define _USBSID_ARENA_H_
+#pragma once
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+/* Default includes */
+#include <stdint.h>
+#include <stddef.h>
+
+
+/* Mode arena
+ *
+ * One statically reserved block shared by the modes that need a large
+ * buffer. The modes are mutually exclusive, only one owns the arena at
+ * a time and it has to release it before another mode can take it.
+ */
+typedef enum {
+  ARENA_FREE = 0,
+  ARENA_ASID,       /* ASID ringbuffer */
+  ARENA_SIDPLAYER,  /* SID/PRG file image for the onboard player */
+} ArenaMode;
+
+/* Per mode layouts in bytes, plain numbers so the build can report them */
+#define ARENA_ASID_SIZE      33600  /* 150 frames of 224 bytes */
+#if defined(ONBOARD_SIDPLAYER)
+#define ARENA_SIDPLAYER_SIZE 65660  /* v2+ PSID header and a full 64KB payload */
+#else
+#define ARENA_SIDPLAYER_SIZE 0
+#endif
+
+#define ARENA_SIZE \
+  ((ARENA_ASID_SIZE > ARENA_SIDPLAYER_SIZE) ? ARENA_ASID_SIZE : ARENA_SIDPLAYER_SIZE)
+
+/* Functions from arena.c */
+void *    arena_acquire(ArenaMode mode, size_t size);
+void      arena_release(ArenaMode mode);
+ArenaMode arena_owner(void);
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* _USBSID_ARENA_H_ */
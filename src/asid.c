@@ -52,6 +52,7 @@ static bool buffer_started = false;
 static bool default_order = false;
 static bool default_order_on_start = false;
 static bool write_ordered = false;
+static bool telemetry_enabled = false;  /* Host opts in with the telemetry SysEx */
 /* thanks to thomasj */
 struct asid_regpair_t {
   uint8_t index;
@@ -59,6 +60,25 @@ struct asid_regpair_t {
 };
 /* thanks to thomasj ~ SF2 Driver 11 no waits */
 struct asid_regpair_t asid_to_writeorder[NO_SID_REGISTERS_ASID] = {};
+/* Set bits per 7 bit mask byte, [0] is the number of bits set
+ * and [1...7] the bit positions, mask byte n bit b is
+ * asid_sid_registers[n * 7 + b] */
+static uint8_t asid_mask_bits[128][8];
+
+/**
+ * @brief Fill the mask byte lookup table
+ */
+static void init_asid_mask_bits(void)
+{
+  for (int mask = 0; mask < 128; mask++) {
+    uint8_t n = 0;
+    for (uint8_t bit = 0; bit < 7; bit++) {
+      if (mask & (1 << bit)) asid_mask_bits[mask][++n] = bit;
+    }
+    asid_mask_bits[mask][0] = n;
+  }
+  return;
+}
 
 /**
  * @brief Resets SID write order back to defaults
@@ -88,7 +108,8 @@ void init_asid_buffer(uint16_t framedelta_us)
   if (!buffer_started) {
     usASID("Init buffer queue, timer and irq\n");
 
-    asid_ring_init();
+    set_buffer_latency(usbsid_config.Asid.latency);
+    if (!asid_ring_init()) return;  /* Arena busy, the next frame retries */
     init_buffer_pio();
     buffer_started = true;
   }
@@ -122,6 +143,7 @@ void deinit_asid_buffer(void)
 void asid_init(void)
 {
   usNFO("[ASID] Init\n");
+  init_asid_mask_bits();
   if (!default_order_on_start) reset_asid_to_writeorder();  /* Set defaults once on boot */
   else { ring_buffer_reset_size(); reset_arrival_tracking(); }
   return;
@@ -140,7 +162,7 @@ void handle_asid_fmoplmessage(uint8_t* buffer)
 
   for (uint8_t mask = 0; mask < nmask_bytes; mask++) {
     field = 0x01;
-    for (uint8_t bit = 0; (bit < 7) && (asid_fm_register_index < ndata_in_buffer); bit++) {
+    for (uint8_t bit = 0; (bit < 7) && (asid_fm_register_index < ndata_in_buffer) && (asid_fm_register_index < (MAX_FM_REG_PAIRS * 2)); bit++) {
       data = buffer[data_index++];
       if ((buffer[1 + mask] & field) == field) {
         data += 0x80;
@@ -149,19 +171,24 @@ void handle_asid_fmoplmessage(uint8_t* buffer)
       field <<= 1;
     }
   }
+  /* Register pairs are pushed to the ringbuffer as one frame so they
+   * are played in sync with the SID frames of the same stream */
   uint8_t addr = ((cfg.fmopl_sid << 5) - 0x20);
-  for (uint8_t reg = 0; reg < asid_fm_register_index; reg++) {
-    dtype = asid;  /* Set data type to asid */
-    /* Pico 2 requires at least 10 cycles between writes
-     * or it will be too damn fast! So we do this for other
-     * Pico's too */
-    if((reg % 2 == 0)) {
-      cycled_write_operation((addr | OPL_REG_ADDRESS), fm_registers[reg], 10);
-      WRITEDBG(dtype, reg, asid_fm_register_index, (addr | OPL_REG_ADDRESS), fm_registers[reg], 10);
-    } else {
-      cycled_write_operation((addr | OPL_REG_DATA), fm_registers[reg], 10);
-      WRITEDBG(dtype, reg, asid_fm_register_index, (addr | OPL_REG_DATA), fm_registers[reg], 10);
+  uint8_t npairs = (asid_fm_register_index >> 1);
+  uint8_t *frame = asid_ring_frame_reserve();
+  if (frame != NULL) {
+    for (uint8_t pos = 0; pos < NO_SID_REGISTERS_ASID; pos++) {
+      if (pos < npairs) {
+        dtype = asid;  /* Set data type to asid */
+        uint8_t reg = (pos << 1);
+        frame = asid_frame_fmopl(frame, fm_registers[reg], fm_registers[reg + 1], OPL_WRITE_CYCLES);
+        WRITEDBG(dtype, reg, asid_fm_register_index, (addr | OPL_REG_ADDRESS), fm_registers[reg], OPL_WRITE_CYCLES);
+        WRITEDBG(dtype, (reg + 1), asid_fm_register_index, (addr | OPL_REG_DATA), fm_registers[reg + 1], OPL_WRITE_CYCLES);
+      } else {
+        frame = asid_frame_skip(frame);
+      }
     }
+    asid_ring_frame_commit();
   }
   midimachine.fmopl = 0;
   return;
@@ -233,6 +260,8 @@ void handle_asid_message(uint8_t sid, uint8_t* buffer)
 
 /**
  * @brief But this one lost track of time
+ * @note decodes straight into a ringbuffer frame using
+ * @note the mask byte lookup table
  *
  * @param uint8_t sid     ~ the sidnumber
  * @param uint8_t* buffer ~ the buffer to process
@@ -254,44 +283,63 @@ void handle_writeordered_asid_message(uint8_t sid, uint8_t* buffer)
   };
   static struct asid_regpair_local_t writeOrder[USBSID_MAX_SIDS][NO_SID_REGISTERS_ASID];
   vu = (vu == 0 ? 100 : vu);  /* NOTICE: Testfix for core1 setting dtype to 0 */
+  dtype = asid;  /* Set data type to asid again */
+
+  uint8_t *frame = asid_ring_frame_reserve();
+  if (frame == NULL) return;  /* Dropped, buffer is full */
+
+  const uint8_t *data = &buffer[8];  /* Register values start after 4 mask and 4 msb bytes */
   unsigned int reg = 0;
-  for (uint8_t mask = 0; mask < 4; mask++) {  /* no more then 4 masks */
-    for (uint8_t bit = 0; bit < 7; bit++) {  /* each packet has 7 bits ~ stoopid midi */
-      if (buffer[mask] & (1 << bit)) {  /* 3 byte message */
-        uint8_t register_value = buffer[reg + 8];  /* get the value to write from the buffer */
-        if(buffer[mask + 4] & (1 << bit)) {  /* if anything higher then 0 */
-          register_value |= 0x80;  /* the register_value needs its 8th MSB bit */
-        }
-        writeOrder[chip][asid_to_writeorder[reg].index].reg = asid_sid_registers[mask * 7 + bit];
-        writeOrder[chip][asid_to_writeorder[reg].index].data = register_value;
-        /* Pico 2 requires at least 10 cycles between writes
-         * or it will be too damn fast! So if wait_us is lower then 10 we use 10 cycles
-         * and do this for other Pico's aswell */
-        writeOrder[chip][asid_to_writeorder[reg].index].wait_us = asid_to_writeorder[reg].wait_us;
-        /* usASID("[%d] $%02X:%02X %u\n", asid_to_writeorder[reg].index, (writeOrder[chip][asid_to_writeorder[reg].index].reg |= sid), writeOrder[chip][asid_to_writeorder[reg].index].data, writeOrder[chip][asid_to_writeorder[reg].index].wait_us); */
-        dtype = asid;  /* Set data type to asid again */
+  if (!write_ordered) {
+    /* Default order is the order of arrival, write directly into the frame */
+    for (uint8_t mask = 0; mask < 4; mask++) {  /* no more then 4 masks */
+      const uint8_t *bits = asid_mask_bits[(buffer[mask] & 0x7F)];
+      uint8_t msb = buffer[mask + 4];
+      const uint8_t *registers = &asid_sid_registers[mask * 7];
+      for (uint8_t i = 1; i <= bits[0]; i++) {
+        uint8_t bit = bits[i];
+        uint8_t register_value = (data[reg] | (((msb >> bit) & 0x1) << 7));  /* add the 8th MSB bit */
+        frame = asid_frame_write(frame, (registers[bit] | sid), register_value, asid_to_writeorder[reg].wait_us);
+        WRITEDBG(dtype, reg, NO_SID_REGISTERS_ASID, (registers[bit] | sid), register_value, asid_to_writeorder[reg].wait_us);
         reg++;
       }
     }
+    for (; reg < NO_SID_REGISTERS_ASID; reg++) {
+      frame = asid_frame_skip(frame);
+    }
+    asid_ring_frame_commit();
+    return;
+  }
+
+  for (uint8_t mask = 0; mask < 4; mask++) {  /* no more then 4 masks */
+    const uint8_t *bits = asid_mask_bits[(buffer[mask] & 0x7F)];
+    uint8_t msb = buffer[mask + 4];
+    for (uint8_t i = 1; i <= bits[0]; i++) {
+      uint8_t bit = bits[i];
+      uint8_t pos = asid_to_writeorder[reg].index;
+      writeOrder[chip][pos].reg = asid_sid_registers[mask * 7 + bit];
+      writeOrder[chip][pos].data = (data[reg] | (((msb >> bit) & 0x1) << 7));  /* add the 8th MSB bit */
+      /* Pico 2 requires at least 10 cycles between writes
+       * or it will be too damn fast! So if wait_us is lower then 10 we use 10 cycles
+       * and do this for other Pico's aswell */
+      writeOrder[chip][pos].wait_us = asid_to_writeorder[reg].wait_us;
+      reg++;
+    }
   }
   for (size_t pos = 0; pos < NO_SID_REGISTERS_ASID; pos++) {
     if (writeOrder[chip][pos].wait_us != 0xff) {
-      /* Push data to ASID ringbuffer */
-      asid_ring_write(
-        (writeOrder[chip][pos].reg |= sid),
+      /* Push data to ASID ringbuffer frame */
+      frame = asid_frame_write(frame,
+        (writeOrder[chip][pos].reg | sid),
         writeOrder[chip][pos].data,
-        /* Account for 1 cycle overhead in PIO bus */
-        // ((writeOrder[chip][pos].wait_us >= 0) ? (writeOrder[chip][pos].wait_us - 1) : 0));
         writeOrder[chip][pos].wait_us);
-        // (write_ordered ? writeOrder[chip][pos].wait_us : 10)); /* Default write order has 10 cycles per write */
-      WRITEDBG(dtype, pos, NO_SID_REGISTERS_ASID, (writeOrder[chip][pos].reg |= sid), writeOrder[chip][pos].data, writeOrder[chip][pos].wait_us);
+      WRITEDBG(dtype, pos, NO_SID_REGISTERS_ASID, (writeOrder[chip][pos].reg | sid), writeOrder[chip][pos].data, writeOrder[chip][pos].wait_us);
     } else {
-      asid_ring_write(0xffu,0xffu,0xffffu);
+      frame = asid_frame_skip(frame);
     }
-  }
-  for (size_t pos = 0; pos < NO_SID_REGISTERS_ASID; pos++) {
     writeOrder[chip][pos].wait_us = 0xff;  /* indicate not used */
   }
+  asid_ring_frame_commit();
   return;
 }
 
@@ -405,6 +453,71 @@ void handle_asid_typemessage(uint8_t* buffer)
   return;
 }
 
+/**
+ * @brief Enable or disable the periodic buffer telemetry
+ * @note off at boot, ASID players that don't ask for it never see it
+ *
+ * @param bool enable
+ */
+void set_asid_telemetry(bool enable)
+{
+  usASID("Telemetry %s\n", (enable ? "enabled" : "disabled"));
+  telemetry_enabled = enable;
+  return;
+}
+
+/**
+ * @brief Pack a 16 bit value into 3 midi data bytes
+ * @note same 7+7+2 layout as the framedelta in the env message
+ */
+static inline uint8_t * pack_asid_u16(uint8_t * p, uint16_t value)
+{
+  *p++ = (value & 0x7F);
+  *p++ = ((value >> 7) & 0x7F);
+  *p++ = ((value >> 14) & 0x03);
+  return p;
+}
+
+/**
+ * @brief Send ASID buffer health to the host on MIDI IN
+ * @note Called from the main loop, sends once per telemetry interval
+ * @note while the buffer is running and the host enabled it
+ *
+ * outgoing message build up:
+ * 0xF0, 0x2D, 0x70, FILL, SIDS, FMOPL,
+ * RATE1-3, UNDERRUNS1-3, OVERFLOWS1-3, GROWS1-3, JITTER1-3, 0xF7
+ * FILL  : ring fill in percent (0-100)
+ * SIDS  : estimated SID count (1-4)
+ * FMOPL : 1 if FMOpl frames are received
+ * 16 bit values are LSB first as 7+7+2 bits
+ */
+void asid_telemetry_task(void)
+{
+  if (!telemetry_enabled || !buffer_started) return;
+  if (!asid_buffer_telemetry_due()) return;
+  if (!tud_midi_n_mounted(MIDI_ITF)) return;
+
+  asid_buffer_stats_t stats;
+  get_asid_buffer_stats(&stats);
+
+  uint8_t message[22];
+  uint8_t *p = message;
+  *p++ = 0xF0;
+  *p++ = 0x2D;
+  *p++ = 0x70;  /* Buffer telemetry */
+  *p++ = (stats.fill_percent & 0x7F);
+  *p++ = (stats.sid_count & 0x7F);
+  *p++ = (stats.fmopl_count & 0x7F);
+  p = pack_asid_u16(p, stats.rate);
+  p = pack_asid_u16(p, stats.underruns);
+  p = pack_asid_u16(p, stats.overflows);
+  p = pack_asid_u16(p, stats.grows);
+  p = pack_asid_u16(p, stats.jitter);
+  *p++ = 0xF7;
+  tud_midi_n_stream_write(MIDI_ITF, MIDI_CABLE, message, (uint32_t)(p - message));
+  return;
+}
+
 /* Spy vs Spy ? */
 void decode_asid_message(uint8_t* buffer, int size)
 {
@@ -466,9 +579,13 @@ void decode_asid_message(uint8_t* buffer, int size)
       break;
     case 0x60:  /* FMOpl */
       if (cfg.fmopl_enabled) {  /* Only if FMOpl is enabled, drop otherwise */
+        if (!buffer_started) init_asid_buffer(usbsid_config.refresh_rate); /* Start buffer on first write */
         midimachine.fmopl = 1;
+        update_fmopl_count();
+        adjust_buffer_rate_dynamic(0);
         handle_asid_fmoplmessage(&buffer[3]);  /* Skip first 3 bytes */
       };
+      break;
     default:
       break;
   }
@@ -43,12 +43,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 
 /* FMOPL ~ Really, CAPSLOCK ONLY HUH? */
 #define MAX_FM_REG_PAIRS 16
 #define OPL_REG_ADDRESS 0x00
 #define OPL_REG_DATA 0x10
+#define OPL_WRITE_CYCLES 10 /* Cycles before each OPL address and data write */
 
 /* ASID, or ACID? */
 #define NO_SID_REGISTERS_ASID 28 /* 25 + 3 extra */
@@ -91,6 +93,8 @@ static const uint8_t asid_sid_registers[NO_SID_REGISTERS_ASID] =
 void asid_init(void);
 void deinit_asid_buffer(void);
 void decode_asid_message(uint8_t *buffer, int size);
+void set_asid_telemetry(bool enable);
+void asid_telemetry_task(void);
 
 
 #ifdef __cplusplus
@@ -46,6 +46,8 @@
 #include <logging.h>
 #include <asid.h>
 #include <sid.h>
+#include <asid_buffer.h>
+#include <arena.h>
 
 
 /* PIO */
@@ -69,6 +71,11 @@ volatile static uint8_t sid_count_estimate = 1;  /* Estimated number of SIDs in
 volatile uint8_t frames_since_nowrites = 0;  /* Frames since last SID2/3/4 message */
 volatile static uint8_t frames_since_multisid = 0;  /* Frames since last SID2/3/4 message */
 
+/* FMOpl frames share the ring with the SID frames, see asid_frame_fmopl() */
+#define FMOPL_TIMEOUT_FRAMES 30  /* Stop counting the FMOpl frame after this many frames without one */
+volatile static uint8_t fmopl_count_estimate = 0;  /* 1 if the tune sends FMOpl frames */
+volatile static uint8_t frames_since_fmopl = 0;  /* Frames since last FMOpl message */
+
 /* IRQ */
 const int BUFFPIOIRQ = 2;
 volatile static int pio_irq = 0;
@@ -78,12 +85,25 @@ volatile uint32_t irq_now_at = 0;
 volatile uint32_t irq_end_at = 0;
 volatile uint32_t irq_prev_at = 0;
 
-/* Ring buffer */
-static uint8_t ring_get(void);
+/* Telemetry */
+#define TELEMETRY_INTERVAL_FRAMES 50  /* Flag a telemetry report every ~1 second at 50Hz */
+volatile static uint16_t stat_underruns = 0;  /* IRQ ticks that found no frame while playing */
+volatile static uint16_t stat_overflows = 0;  /* Frames dropped on overflow */
+volatile static uint16_t stat_grows = 0;  /* Times the ring was grown */
+volatile static uint16_t stat_jitter_max = 0;  /* Max IRQ interval deviation since last report */
+volatile static uint8_t telemetry_frames = 0;
+volatile static bool telemetry_due = false;
+
+/* Ring buffer
+ * Frames are always written and read whole and every
+ * ring size is a multiple of the frame size, a frame
+ * therefor never wraps around the end of the ring */
 static int ring_diff(void);
+static uint16_t ring_size_default(void);
 static const uint8_t ASID_FRAME_WRITES_MAX = 28;
 volatile uint16_t corrected_rate = 0;
 const uint8_t diff_size = (2 * (4 * ASID_FRAME_WRITES_MAX)); /* = 224 bytes | 112 bytes == 1 frame, was 64 bytes */
+static const uint8_t frame_size = (4 * ASID_FRAME_WRITES_MAX); /* = 112 bytes == 1 frame */
 typedef struct {
   uint16_t ring_read;
   uint16_t ring_write;
@@ -95,11 +115,15 @@ static ring_buffer_t __not_in_flash("asid_buffer") asid_ringbuffer;
 /* Dynamic ring buffer sizing */
 static const uint16_t RING_SIZE_MIN = (10 * 224);       /* 2240 bytes - minimum size */
 static const uint16_t RING_SIZE_DEFAULT = (20 * 224);   /* 4480 bytes - default/starting size */
-static const uint16_t RING_SIZE_MAX = (150 * 224);      /* 33600 bytes - maximum size (~150 frames, ~33KB) */
+static const uint16_t RING_SIZE_MAX = ARENA_ASID_SIZE;  /* 33600 bytes - maximum size (~150 frames, ~33KB) */
 static const uint16_t RING_SIZE_STEP = (20 * 224);      /* 4480 bytes - grow/shrink increment */
 volatile static uint16_t ring_size = RING_SIZE_DEFAULT; /* Current effective size */
 static uint16_t ring_size_allocated = 0;                /* Actual allocated size */
 
+/* Latency target */
+volatile static uint16_t target_size = (USBSID_ASID_LATENCY_DEFAULT * 112); /* Pre-roll and target depth in bytes */
+volatile static bool prerolled = false;  /* Pre-roll depth reached, consuming frames */
+
 
 /**
  * Here be magicians
@@ -187,8 +211,10 @@ uint32_t track_asid_arrival(void)
       arrival_count = 0;
       sid_count_estimate = 1;
       frames_since_multisid = 0;
+      fmopl_count_estimate = 0;
+      frames_since_fmopl = 0;
       base_rate = 0;  /* Reset base rate for new auto-detection */
-      ring_size = RING_SIZE_DEFAULT;  /* Reset buffer size for new tune */
+      ring_size = ring_size_default();  /* Reset buffer size for new tune */
       for (int i = 0; i < ARRIVAL_HISTORY_SIZE; i++) {
         arrival_times[i] = 0;
       }
@@ -239,6 +265,21 @@ uint32_t track_asid_arrival(void)
   return calculated_rate;
 }
 
+/**
+ * @brief Returns the starting ring size for the current latency target
+ * @note Keeps at least 4 frames of headroom above the target
+ *
+ * @return uint16_t ~ ring size in bytes
+ */
+static uint16_t ring_size_default(void)
+{
+  uint16_t size = RING_SIZE_DEFAULT;
+  while ((size < (target_size + (diff_size * 4))) && (size < RING_SIZE_MAX)) {
+    size += RING_SIZE_STEP;
+  }
+  return size;
+}
+
 /**
  * @brief Grow the ring buffer when approaching overflow
  *
@@ -273,6 +314,7 @@ static bool ring_buffer_grow(void)
   }
 
   ring_size = new_size;
+  if (stat_grows < UINT16_MAX) stat_grows++;
   usASID("Buffer grown to %u bytes (diff=%d)\n", ring_size, ring_diff());
   return true;
 }
@@ -283,7 +325,7 @@ static bool ring_buffer_grow(void)
  */
 void ring_buffer_reset_size(void)
 {
-  ring_size = RING_SIZE_DEFAULT;
+  ring_size = ring_size_default();
   usASID("Buffer size reset to %u bytes\n", ring_size);
   return;
 }
@@ -308,6 +350,25 @@ void update_sid_count(uint8_t sid_num)
   return;
 }
 
+/**
+ * @brief Update FMOpl frame count when we see an FMOpl message
+ * @note Call from decode_asid_message when processing FMOpl messages
+ * @note Each FMOpl message occupies one frame slot in the ring
+ */
+void update_fmopl_count(void)
+{
+  still_receiving = true;
+
+  /* Reset timeout - we just saw an FMOpl message */
+  frames_since_fmopl = 0;
+
+  if (fmopl_count_estimate == 0) {
+    fmopl_count_estimate = 1;
+    usASID("FMOpl frames detected\n");
+  }
+  return;
+}
+
 /**
  * @brief Dynamically adjust buffer rate based on calculated rate and buffer state
  * @param uint32_t target_rate ~ The calculated frame rate from track_asid_arrival (0 if not available)
@@ -337,11 +398,22 @@ void adjust_buffer_rate_dynamic(uint32_t target_rate)
     }
   }
 
+  /* Track frames since last FMOpl message (only on SID1 frames) */
+  if (target_rate > 0 && fmopl_count_estimate > 0) {
+    frames_since_fmopl++;
+    if (frames_since_fmopl > FMOPL_TIMEOUT_FRAMES) {
+      usASID("No FMOpl messages for %u frames, resetting FMOpl count\n",
+          frames_since_fmopl);
+      fmopl_count_estimate = 0;
+      frames_since_fmopl = 0;
+    }
+  }
+
   /* Calculate target rate based on CR and actual SID count */
   int32_t new_rate;
   if (target_rate > 0) {
-    /* Use calculated rate divided by SID count */
-    new_rate = (int32_t)(target_rate / sid_count_estimate);
+    /* Use calculated rate divided by SID count plus FMOpl frame */
+    new_rate = (int32_t)(target_rate / (sid_count_estimate + fmopl_count_estimate));
   } else {
     /* No valid CR yet, use current rate with buffer adjustment */
     new_rate = (int32_t)corrected_rate;
@@ -371,10 +443,12 @@ void adjust_buffer_rate_dynamic(uint32_t target_rate)
     new_rate -= 150;
   } else if (fill_percent > 60) {
     new_rate -= 50;
-  } else if (diff < (diff_size / 2)) {
-    new_rate += 100;  /* Buffer nearly empty */
-  } else if (diff < diff_size) {
+  } else if (diff < (target_size / 2)) {
+    new_rate += 100;  /* Buffer far below latency target */
+  } else if (diff < target_size) {
     new_rate += 50;
+  } else if (diff > (target_size + diff_size)) {
+    new_rate -= 100;  /* More than 2 frames above latency target */
   }
   /* else: buffer in acceptable range, use rate as-is */
 
@@ -404,14 +478,49 @@ void reset_arrival_tracking(void)
   calculated_rate = 0;
   sid_count_estimate = 1;  /* Reset SID count estimate */
   frames_since_multisid = 0;  /* Reset multi-SID timeout */
+  fmopl_count_estimate = 0;  /* Reset FMOpl frame count */
+  frames_since_fmopl = 0;  /* Reset FMOpl timeout */
   /* Clear stale timestamps to prevent bogus deltas */
   for (int i = 0; i < ARRIVAL_HISTORY_SIZE; i++) {
     arrival_times[i] = 0;
   }
   /* Note: don't reset base_rate here, it's set from set_buffer_rate() */
+  stat_underruns = stat_overflows = stat_grows = stat_jitter_max = 0;
+  telemetry_frames = 0;
+  prerolled = false;
+  return;
+}
+
+/**
+ * @brief Retrieve the current buffer health
+ * @note Resets the max jitter gauge and clears the report flag
+ *
+ * @param asid_buffer_stats_t * stats ~ struct to fill
+ */
+void get_asid_buffer_stats(asid_buffer_stats_t * stats)
+{
+  int diff = ring_diff();
+  stats->fill_percent = (uint8_t)((diff * 100) / (int)ring_size);
+  stats->sid_count = sid_count_estimate;
+  stats->fmopl_count = fmopl_count_estimate;
+  stats->underruns = stat_underruns;
+  stats->overflows = stat_overflows;
+  stats->grows = stat_grows;
+  stats->rate = corrected_rate;
+  stats->jitter = stat_jitter_max;
+  stat_jitter_max = 0;
+  telemetry_due = false;
   return;
 }
 
+/**
+ * @brief Returns true once every TELEMETRY_INTERVAL_FRAMES irq ticks
+ */
+bool asid_buffer_telemetry_due(void)
+{
+  return telemetry_due;
+}
+
 
 /**
  * Here be IRQ and PIO magic mushrooms
@@ -426,23 +535,50 @@ void __not_in_flash_func(buffer_irq_handler)(void)
   irq_prev_at = irq_now_at;
   irq_now_at = clockcycles();
 
+  /* Deviation of this tick from the requested rate, pio has 1 cycle overhead */
+  if (__us_likely(irq_prev_at != 0 && corrected_rate != 0)) {
+    int32_t jitter = (int32_t)(irq_now_at - irq_prev_at) - (int32_t)(corrected_rate + 1);
+    if (jitter < 0) jitter = -jitter;
+    if (jitter > stat_jitter_max) stat_jitter_max = (jitter > UINT16_MAX ? UINT16_MAX : (uint16_t)jitter);
+  }
+  if (++telemetry_frames >= TELEMETRY_INTERVAL_FRAMES) {
+    telemetry_frames = 0;
+    telemetry_due = true;
+  }
+
   /* Retrieve the current diff */
   int current_diff = ring_diff();
+  /* Pre-roll until the latency target is reached */
+  if (!prerolled && (current_diff >= target_size)) {
+    prerolled = true;
+  }
   /* Only start if head and tail are not the same */
-  if(asid_ringbuffer.ring_read != asid_ringbuffer.ring_write) {
-    // if (current_diff > (diff_size + (28 * 4))) {  // Ensure we keep diff_size bytes after reading
-    /* Only consume if we have enough data AND will stay above minimum */
-    if (current_diff > diff_size) {  // Ensure we keep diff_size bytes after reading
-      for (size_t pos = 0; pos < 28; pos++) {
-        uint8_t reg = ring_get();
-        uint8_t val = ring_get();
-        uint8_t c_hi = ring_get();
-        uint8_t c_lo = ring_get();
-        if (reg != 0xffu) {
+  if(prerolled && (asid_ringbuffer.ring_read != asid_ringbuffer.ring_write)) {
+    /* Only consume complete frames */
+    if (current_diff >= frame_size) {
+      const uint8_t * frame = &asid_ringbuffer.ringbuffer[asid_ringbuffer.ring_read];
+      for (size_t pos = 0; pos < ASID_FRAME_WRITES_MAX; pos++, frame += 4) {
+        uint8_t reg = frame[0];
+        uint8_t val = frame[1];
+        uint8_t c_hi = frame[2];
+        uint8_t c_lo = frame[3];
+        if (c_hi == OPL_PAIR_MARKER) {  /* FMOpl register pair */
+          uint8_t addr = ((cfg.fmopl_sid << 5) - 0x20);
+          cycled_write_operation((addr | OPL_REG_ADDRESS), reg, c_lo);
+          cycled_write_operation((addr | OPL_REG_DATA), val, c_lo);
+        } else if (reg != 0xffu) {
           cycled_write_operation(reg,val,(c_hi<<8|c_lo));
         }
       }
+      asid_ringbuffer.ring_read = (asid_ringbuffer.ring_read + frame_size) % ring_size;
+    } else {
+      /* Ran dry, pre-roll again */
+      if (stat_underruns < UINT16_MAX) stat_underruns++;
+      prerolled = false;
     }
+  } else if (prerolled) {
+    if (stat_underruns < UINT16_MAX) stat_underruns++;
+    prerolled = false;
   }
 
   if (!still_receiving) {
@@ -450,7 +586,8 @@ void __not_in_flash_func(buffer_irq_handler)(void)
     if (frames_since_nowrites > NOWRITES_TIMEOUT_FRAMES) {
       extern void deinit_asid_buffer(void);
       usASID("More then 100 frames since last write, deactivating\n");
-      frames_since_nowrites = frames_since_multisid = 0;
+      frames_since_nowrites = frames_since_multisid = frames_since_fmopl = 0;
+      fmopl_count_estimate = 0;
       base_rate = corrected_rate = calculated_rate = 0;
       arrival_index = arrival_count = 0;
       irq_prev_at = irq_now_at = irq_end_at = 0;
@@ -582,6 +719,27 @@ void set_buffer_rate(uint16_t rate)
 }
 
 
+/**
+ * @brief sets the asid buffer latency target
+ * @note the buffer pre-rolls to this depth before
+ * @note playing and the rate controller holds it there
+ * @note grows the ring if the target does not fit
+ *
+ * @param uint8_t frames ~ latency target in frames
+ */
+void set_buffer_latency(uint8_t frames)
+{
+  if (frames < ASID_LATENCY_MIN) frames = ASID_LATENCY_MIN;
+  if (frames > ASID_LATENCY_MAX) frames = ASID_LATENCY_MAX;
+  target_size = (frames * frame_size);
+  if (asid_ringbuffer.is_allocated) {
+    while ((ring_size < (target_size + (diff_size * 4))) && ring_buffer_grow());
+  }
+  usASID("Latency target set to %u frames (%u bytes)\n", frames, target_size);
+  return;
+}
+
+
 /**
  * Here be ringbuffer shizzle
  */
@@ -592,6 +750,7 @@ void set_buffer_rate(uint16_t rate)
 static void ring_buffer_reset(void)
 {
   asid_ringbuffer.ring_read = asid_ringbuffer.ring_write = 0;
+  prerolled = false;
   return;
 }
 
@@ -607,6 +766,8 @@ static int __not_in_flash_func(ring_diff)(void)
 
 /**
  * @brief Check if buffer would overflow with next write
+ * @note a full frame must leave at least 1 byte free
+ * @note or head and tail would be the same again
  *
  * @return boolean ~ true if there's no room for another frame (112 bytes)
  * @return boolean ~ false if there is
@@ -614,63 +775,35 @@ static int __not_in_flash_func(ring_diff)(void)
 static bool ring_would_overflow(void)
 {
   int headroom = (int)ring_size - ring_diff();
-  return headroom < 112;  /* Need room for at least 1 frame (28 writes * 4 bytes) */
-}
-
-/**
- * @brief put an item into the ringbuffer
- * @note Checks for overflow and drops data if buffer is full
- *
- * @param uint8_t item ~ item to store
- */
-static void ring_put(uint8_t item)
-{
-  /* Check for overflow - if we're about to overwrite unread data, skip this write */
-  uint16_t next_write = (asid_ringbuffer.ring_write + 1) % ring_size;
-  if (next_write == asid_ringbuffer.ring_read) {
-    /* Buffer full - would overflow. Drop this byte to prevent corruption. */
-    usERR("Buffer overflow - dropping data\n");
-    return;
-  }
-
-  asid_ringbuffer.ringbuffer[asid_ringbuffer.ring_write] = item;
-  asid_ringbuffer.ring_write = next_write;
-  return;
-}
-
-/**
- * @brief retrieves an item from the ring buffer
- *
- * @return uint8_t ~ the retrieved ring item
- */
-static uint8_t __not_in_flash_func(ring_get)(void)
-{
-  uint8_t item = asid_ringbuffer.ringbuffer[asid_ringbuffer.ring_read];
-  asid_ringbuffer.ring_read = (asid_ringbuffer.ring_read + 1) % ring_size;
-  return item;
+  return headroom <= frame_size;  /* Need room for at least 1 frame (28 writes * 4 bytes) */
 }
 
 /**
  * @brief intialise the ring buffer
  * @note Allocates maximum size upfront to allow dynamic growth
+ *
+ * @return bool ~ true when the ringbuffer is allocated
  */
-void asid_ring_init(void)
+bool asid_ring_init(void)
 {
   /* Explicitely set sid_count_estimate to 1 at start for potential compiler zeroing issue */
   sid_count_estimate = 1;
 
   if (!asid_ringbuffer.is_allocated) {
-    if (asid_ringbuffer.ringbuffer != NULL) { free(asid_ringbuffer.ringbuffer); }
-    /* Allocate max size upfront - allows growth without reallocation */
-    asid_ringbuffer.ringbuffer = (uint8_t*)calloc(RING_SIZE_MAX, 1);
+    /* Take the max size upfront - allows growth without reallocation */
+    asid_ringbuffer.ringbuffer = (uint8_t*)arena_acquire(ARENA_ASID, RING_SIZE_MAX);
+    if (asid_ringbuffer.ringbuffer == NULL) {
+      usERR("Ringbuffer unavailable, frames will be dropped\n");
+      return false;
+    }
     ring_size_allocated = RING_SIZE_MAX;
-    ring_size = RING_SIZE_DEFAULT;  /* Start with default logical size */
+    ring_size = ring_size_default();  /* Start with default logical size */
     asid_ringbuffer.is_allocated = true;
     ring_buffer_reset();
     usASID("Ringbuffer initialised (allocated=%u, effective=%u)\n",
       ring_size_allocated, ring_size);
   }
-  return;
+  return true;
 }
 
 /**
@@ -680,7 +813,7 @@ void asid_ring_deinit(void)
 {
   if (asid_ringbuffer.is_allocated) {
     ring_buffer_reset();
-    free(asid_ringbuffer.ringbuffer);
+    arena_release(ARENA_ASID);
     asid_ringbuffer.ringbuffer = NULL;
     asid_ringbuffer.is_allocated = false;
   }
@@ -688,18 +821,30 @@ void asid_ring_deinit(void)
 }
 
 /**
- * @brief write data to the ringbuffer
- * @note writes 4 items per call
+ * @brief reserve the next frame in the ringbuffer
+ * @note the frame is filled in place with asid_frame_*()
+ * @note and made available to the irq by asid_ring_frame_commit()
  *
- * @param uint8_t reg ~ SID register
- * @param uint8_t val ~ value
- * @param uint16_t c  ~ delay cycles
+ * @return uint8_t* ~ pointer to 28 entries of 4 bytes, NULL if the frame is dropped
+ */
+uint8_t * asid_ring_frame_reserve(void)
+{
+  if __us_unlikely(!asid_ringbuffer.is_allocated) return NULL;
+  if __us_unlikely(ring_would_overflow()) {
+    /* Buffer full - would overflow. Drop this frame to prevent corruption. */
+    if (stat_overflows < UINT16_MAX) stat_overflows++;
+    usERR("Buffer overflow - dropping frame\n");
+    return NULL;
+  }
+  return &asid_ringbuffer.ringbuffer[asid_ringbuffer.ring_write];
+}
+
+/**
+ * @brief commit the frame reserved with asid_ring_frame_reserve()
  */
-void asid_ring_write(uint8_t reg, uint8_t val, uint16_t c)
+void asid_ring_frame_commit(void)
 {
-  ring_put(reg);
-  ring_put(val);
-  ring_put((uint8_t)((c&0xff00u)>>8));
-  ring_put((uint8_t)(c&0xffu));
+  __compiler_memory_barrier();  /* Frame contents must be stored before the irq can see them */
+  asid_ringbuffer.ring_write = (asid_ringbuffer.ring_write + frame_size) % ring_size;
   return;
 }
@@ -33,19 +33,71 @@
 
 /* Default includes */
 #include <stdint.h>
+#include <stdbool.h>
 
 
+/* ASID ring frame entries
+ * each frame holds 28 entries of 4 bytes: reg, val, c_hi, c_lo
+ * unused entries are skipped (reg 0xff, c 0xffff)
+ * an FMOpl register pair is stored as a single entry:
+ * reg = OPL register, val = OPL data, c_hi = OPL_PAIR_MARKER, c_lo = write spacing */
+#define OPL_PAIR_MARKER 0x80u
+
+static inline uint8_t * asid_frame_write(uint8_t * p, uint8_t reg, uint8_t val, uint16_t c)
+{
+  p[0] = reg;
+  p[1] = val;
+  p[2] = (uint8_t)((c & 0xff00u) >> 8);
+  p[3] = (uint8_t)(c & 0xffu);
+  return (p + 4);
+}
+
+static inline uint8_t * asid_frame_fmopl(uint8_t * p, uint8_t reg, uint8_t val, uint8_t spacing)
+{
+  p[0] = reg;
+  p[1] = val;
+  p[2] = OPL_PAIR_MARKER;
+  p[3] = spacing;
+  return (p + 4);
+}
+
+static inline uint8_t * asid_frame_skip(uint8_t * p)
+{
+  return asid_frame_write(p, 0xffu, 0xffu, 0xffffu);
+}
+
+/* ASID buffer latency target in frames */
+#define ASID_LATENCY_MIN 1
+#define ASID_LATENCY_MAX 64
+
+/* ASID buffer health */
+typedef struct {
+  uint8_t  fill_percent;  /* Ring fill level 0-100 */
+  uint8_t  sid_count;     /* Estimated SIDs in tune */
+  uint8_t  fmopl_count;   /* 1 if FMOpl frames are received */
+  uint16_t underruns;     /* Times the ring ran dry while playing */
+  uint16_t overflows;     /* Frames dropped on overflow */
+  uint16_t grows;         /* Times the ring was grown */
+  uint16_t rate;          /* Current corrected_rate in cycles */
+  uint16_t jitter;        /* Max irq interval deviation in cycles since last report */
+} asid_buffer_stats_t;
+
 /* Functions from asid_buffer.c */
 uint32_t track_asid_arrival(void);
 void     adjust_buffer_rate_dynamic(uint32_t target_rate);
 void     reset_arrival_tracking(void);
 void     ring_buffer_reset_size(void);
 void     set_buffer_rate(uint16_t rate);
+void     set_buffer_latency(uint8_t frames);
 void     update_sid_count(uint8_t sid_num);
+void     update_fmopl_count(void);
 void     init_buffer_pio(void);
 void     stop_buffer_pio(void);
-void     asid_ring_write(uint8_t reg, uint8_t val, uint16_t c);
-void     asid_ring_init(void);
+uint8_t *asid_ring_frame_reserve(void);
+void     asid_ring_frame_commit(void);
+void     get_asid_buffer_stats(asid_buffer_stats_t * stats);
+bool     asid_buffer_telemetry_due(void);
+bool     asid_ring_init(void);
 void     asid_ring_deinit(void);
 
 
@@ -53,22 +53,23 @@ volatile static uint32_t data_word, dir_mask;
 
 
 /**
- * @brief Set the bits going to the PIO databus based on provided address
+ * @brief Build the words going to the PIO databus based on provided address
  *
  * @param uint8_t address
  * @param bool write
+ * @param uint8_t *control, control word out
+ * @param uint32_t *data, data word out
  */
-inline static int __not_in_flash_func(set_bus_bits)(uint8_t address, bool write)
+inline static int __not_in_flash_func(build_bus_words)(uint8_t address, bool write, uint8_t *control, uint32_t *data_out)
 {
-  /* usCFG("[BUS BITS]$%02X:%02X ", address, data); */
-  vu = (vu == 0 ? 100 : vu);  /* NOTICE: Testfix for core1 setting dtype to 0 */
+  uint8_t cw;
+  uint32_t dw = 0, mask;
   if __us_likely(write) {
-    control_word = 0b111000;
-    dir_mask = 0b1111111111111111;  /* Always OUT never IN */
+    cw = 0b111000;
+    mask = 0b1111111111111111;  /* Always OUT never IN */
   } else {
-    data_word = dir_mask = 0;
-    control_word = 0b111001;
-    dir_mask |= 0b1111111100000000;
+    cw = 0b111001;
+    mask = 0b1111111100000000;
   }
   address = (address & 0x7F);
   uint8_t data = (write ? sid_memory[(address & 0x7F)] : 0x0);
@@ -76,29 +77,51 @@ inline static int __not_in_flash_func(set_bus_bits)(uint8_t address, bool write)
   switch (address) {
     case 0x00 ... 0x1F:
       if __us_unlikely(cfg.one == 0b110 || cfg.one == 0b111) return 0;
-      data_word = (cfg.one_mask == 0x3f ? ((address & 0x1F) + 0x20) : (address & 0x1F)) << 8 | data;
-      control_word |= cfg.one;
+      dw = (cfg.one_mask == 0x3f ? ((address & 0x1F) + 0x20) : (address & 0x1F)) << 8 | data;
+      cw |= cfg.one;
       break;
     case 0x20 ... 0x3F:
       if __us_unlikely(cfg.two == 0b110 || cfg.two == 0b111) return 0;
-      data_word = (cfg.two_mask == 0x3f ? ((address & 0x1F) + 0x20) : address & 0x1F) << 8 | data;
-      control_word |= cfg.two;
+      dw = (cfg.two_mask == 0x3f ? ((address & 0x1F) + 0x20) : address & 0x1F) << 8 | data;
+      cw |= cfg.two;
       break;
     case 0x40 ... 0x5F:
       if __us_unlikely(cfg.three == 0b110 || cfg.three == 0b111) return 0;
       /* Workaround for addresses in this range, mask doesn't work properly */
-      data_word = (cfg.three_mask == 0x3f ? ((address & 0x1F) + 0x20) : (address & 0x1F)) << 8 | data;
-      control_word |= cfg.three;
+      dw = (cfg.three_mask == 0x3f ? ((address & 0x1F) + 0x20) : (address & 0x1F)) << 8 | data;
+      cw |= cfg.three;
       break;
     case 0x60 ... 0x7F:
       if __us_unlikely(cfg.four == 0b110 || cfg.four == 0b111) return 0;
-      data_word = (cfg.four_mask == 0x3f ? ((address & 0x1F) + 0x20) : (address & 0x1F)) << 8 | data;
-      control_word |= cfg.four;
+      dw = (cfg.four_mask == 0x3f ? ((address & 0x1F) + 0x20) : (address & 0x1F)) << 8 | data;
+      cw |= cfg.four;
       break;
   }
-  data_word = (dir_mask << 16) | data_word;
-  /* usCFG("$%02X:%02X $%04X 0b%032b $%04X 0b%016b\n",
-    address, data, data_word, data_word, control_word, control_word); */
+  *control = cw;
+  *data_out = ((mask << 16) | dw);
+  return 1;
+}
+
+/**
+ * @brief Set the bits going to the PIO databus based on provided address
+ *
+ * @param uint8_t address
+ * @param bool write
+ */
+inline static int __not_in_flash_func(set_bus_bits)(uint8_t address, bool write)
+{
+  /* usCFG("[BUS BITS]$%02X:%02X ", address, data); */
+  vu = (vu == 0 ? 100 : vu);  /* NOTICE: Testfix for core1 setting dtype to 0 */
+  uint8_t cw;
+  uint32_t dw;
+  if __us_unlikely(build_bus_words(address, write, &cw, &dw) != 1) {
+    return 0;
+  }
+  control_word = cw;
+  data_word = dw;
+  dir_mask = (dw >> 16);
+  /* usCFG("$%02X $%04X 0b%032b $%04X 0b%016b\n",
+    address, data_word, data_word, control_word, control_word); */
   return 1;
 }
 
@@ -410,6 +433,53 @@ void __no_inline_not_in_flash_func(cycled_write_operation)(uint8_t address, uint
   return;
 }
 
+/**
+ * @brief Queue a burst of writes to the bus in one go
+ *        the first write waits `lead` cycles, every write
+ *        after it waits `spacing` cycles
+ *        does not wait for the PIO writes to finish, only
+ *        blocks while the statemachine fifos are full
+ * @note uses PIO0 SM0, SM1, SM2 & SM3
+ * @note writes go out in array order, anything that has to land
+ *       last (e.g. a gate bit) goes at the end
+ * @note on an idle bus the first write lands `lead` cycles
+ *       from now, else `lead` cycles after the queued writes
+ *
+ * @param const uint8_t *address
+ * @param const uint8_t *data
+ * @param uint8_t n, the number of writes
+ * @param uint16_t lead, cycles before the first write
+ * @param uint16_t spacing, cycles between two writes
+ */
+void __no_inline_not_in_flash_func(cycled_write_burst)(const uint8_t *address, const uint8_t *data, uint8_t n, uint16_t lead, uint16_t spacing)
+{
+  uint16_t cycles = lead;
+  vu = (vu == 0 ? 100 : vu);  /* NOTICE: Testfix for core1 setting dtype to 0 */
+  for (uint8_t i = 0; i < n; i++) {
+    uint8_t cw;
+    uint32_t dw;
+    sid_memory[(address[i] & 0x7F)] = data[i];
+    /* Local words, the shared ones belong to the DMA writes (e.g. the ASID buffer IRQ) */
+    if __us_unlikely(build_bus_words(address[i], true, &cw, &dw) != 1) {
+      continue;
+    }
+    /* Each triplet goes in whole, an IRQ write in between would pair
+       its words with ours. A DMA write can still be feeding the fifos,
+       the burst must not overtake it */
+    uint32_t ints = save_and_disable_interrupts();
+    dma_channel_wait_for_finish_blocking(dma_tx_control);
+    dma_channel_wait_for_finish_blocking(dma_tx_data);
+    dma_channel_wait_for_finish_blocking(dma_tx_delay);
+    pio_sm_put_blocking(bus_pio, sm_control, cw);
+    pio_sm_put_blocking(bus_pio, sm_data, dw);
+    pio_sm_put_blocking(bus_pio, sm_delay, cycles);
+    restore_interrupts(ints);
+    cycles = spacing;
+  }
+
+  return;
+}
+
 /**
  * @brief Read data from the bus at address
  *        and then waits for the DMA to finish blocking
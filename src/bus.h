@@ -41,6 +41,7 @@
 uint16_t cycled_delay_operation(uint16_t cycles);
 uint16_t cycled_delayed_write_operation(uint8_t address, uint8_t data, uint16_t cycles);
 void     cycled_write_operation(uint8_t address, uint8_t data, uint16_t cycles);
+void     cycled_write_burst(const uint8_t *address, const uint8_t *data, uint8_t n, uint16_t lead, uint16_t spacing);
 uint8_t  cycled_read_operation(uint8_t address, uint16_t cycles);
 
 /* Functions from bus.c */
@@ -29,6 +29,7 @@
 #include <config.h>
 #include <gpio.h>
 #include <midi.h>
+#include <midi_handler.h>
 #include <sid.h>
 #include <bus.h>
 #include <dma.h>
@@ -40,6 +41,8 @@
 #include <config_bus.h>
 #include <config_socket.h>
 #include <config_logging.h>
+#include <config_store.h>
+#include <asid_buffer.h>
 #include <logging.h>
 
 /* Cynthcart emulator */
@@ -50,6 +53,9 @@
 /* SID player */
 #if defined(ONBOARD_SIDPLAYER)
 #include <usplayer.h>
+#include <sid_upload.h>
+#include <sid_cache.h>
+#include <arena.h>
 static int sidbytes_received = 0;
 static bool receiving_sidfile = 0;
 #endif /* ONBOARD_SIDPLAYER */
@@ -65,8 +71,6 @@ const char __in_flash("us_vars") *pcb_version = PCB_VERSION;
 const char __in_flash("us_vars") *us_product = USBSID_PRODUCT;
 
 /* Declare local variables */
-/* 0x15 (16) max before starting at 0 flash sector erase */
-static uint8_t config_saveid = 0;
 /* 256 Bytes MAX == FLASH_PAGE_SIZE (Max storage size is 4096 bytes == FLASH_SECTOR_SIZE) */
 static uint8_t config_array[FLASH_PAGE_SIZE] = {0};
 /* 12 bytes and counting */
@@ -97,6 +101,28 @@ bool config_unacknowledged(void)
 #endif
 }
 
+/**
+ * @brief Returns true if the config command may run before boot is done
+ * @note only commands that read and don't touch the SID's, the bus or flash
+ *
+ * @param uint8_t command
+ * @return bool
+ */
+bool boot_allows_config(uint8_t command)
+{
+  if __us_likely(boot_ready()) return true;
+  switch (command) {
+    case READ_BOOTSTATE:
+    case READ_CONFIGACK:
+    case USBSID_VERSION:
+    case US_PCB_VERSION:
+    case US_FEATURES:
+      return true;
+    default:
+      return false;
+  }
+}
+
 /**
  * @brief
  *
@@ -212,7 +238,7 @@ void read_config(Config* config)
   config_array[57] = config->stereo_en;
   config_array[58] = config->lock_audio_sw;
 
-  config_array[59] = 0x00; /* Unused */
+  config_array[59] = config->Asid.latency;
 
   config_array[60] = ((int)config->mirrored | ((int)config->flipped << 1) | ((int)config->mixed << 2));
 
@@ -280,9 +306,7 @@ void read_pcb_version(void)
 
 void __no_inline_not_in_flash_func(default_config)(Config* config)
 {
-  config_saveid = config->config_saveid;  /* Preserve config saveid */
   memcpy(config, &usbsid_default_config, sizeof(Config));
-  config->config_saveid = config_saveid;  /* Copy saveid back into the default config */
   return;
 }
 
@@ -291,100 +315,35 @@ void __no_inline_not_in_flash_func(load_config)(Config* config)
   print_cfg_addr();
   usNFO("\n");
   usCFG("Loading configuration from flash\n");
-  uint8_t savelocationid = 0;  /* counter for finding the current save location */
-AGAIN:
-  Config temp_config;
-  usCFG("  Trying flash position '%u'", savelocationid);
-  /* NOTICE: Do not do any logging directly after memcpy without stdio_flush or the Pico will freeze! */
-  memcpy(&temp_config, (void *)(XIP_BASE + (FLASH_CONFIG_OFFSET + (FLASH_PAGE_SIZE * savelocationid))), sizeof(Config));
-  stdio_flush();
-  usNFO(", flash contains config id '%u' (255 == empty slot)\n",
-     temp_config.config_saveid);
-  if ((temp_config.config_saveid >= 0) && (temp_config.config_saveid <= 0xF) /* Max 16 saves */
-    && temp_config.config_saveid == savelocationid) { /* Found previously saved config */
-    savelocationid++;  /* Increase id and try again */
-    goto AGAIN; /* Always tries again if config is found */
-  } else { /* They are not equal, that means this config is an empty save location or corrupted, load the previous config */
-    savelocationid--; /* This will now be the previous config_saveid */
-    usCFG("  Found %s configuration at position %u\n",
-      ((savelocationid == 255) ? "empty" : "latest"), savelocationid);
-    memcpy(config, (void *)(XIP_BASE + (FLASH_CONFIG_OFFSET + (FLASH_PAGE_SIZE * savelocationid))), sizeof(Config));
-    stdio_flush();
+  default_config(config);  /* Anything the stored config doesn't have keeps its default */
+  if (!config_store_load(config)) {
+    usCFG("Using default configuration!\n");
+    default_config(config);
   }
-  /* Do not assign savelocationid here but he actual saveid from the restored config */
-  config_saveid = usbsid_config.config_saveid;  /* copy saveid into global variable (for later saving use etc.) */
-  usCFG("  %s loaded from position %u\n",
-    (usbsid_config.config_saveid == 255 ? "Empty configuration" : "Configuration"),
-    usbsid_config.config_saveid);
 
   usCFG("Copied Configuration:\n");
-  usCFG("  From 0x%x\n",
-    (FLASH_CONFIG_OFFSET + (FLASH_PAGE_SIZE * savelocationid)));
   usCFG("  To 0x%x\n",
     (uint)config);
   usCFG("  Size = %u\n",
      sizeof(Config));
-  usCFG("Copy config addresses:\n");
-  usCFG("  &usbsid_config = 0x%x\n",
-    (uint)&usbsid_config);
-  usCFG("  config = 0x%x\n",
-    (uint)config);
-  usCFG("  &config = 0x%x\n",
-    (uint)&config);
 
-
-  cm_verification = usbsid_config.magic;   /* Store the current magic for later */
-  if (usbsid_config.magic != MAGIC_SMOKE) {  /* Verify the magic */
-      usERR("MAGIC usbsid_config.magic: %u != MAGIC_SMOKE: %u\n", usbsid_config.magic, MAGIC_SMOKE);
-      usCFG("Reset to default configuration!\n");
-      default_config(config);
+  cm_verification = config->magic;   /* Store the loaded magic for later */
+  config->magic = MAGIC_SMOKE;  /* Older builds are migrated, not reset */
+  if (config->Asid.latency < ASID_LATENCY_MIN || config->Asid.latency > ASID_LATENCY_MAX) {
+    config->Asid.latency = USBSID_ASID_LATENCY_DEFAULT;
   }
 
   return;
 }
 
-void __no_inline_not_in_flash_func(write_config_lowlevel)(void* config_data)
-{ /* No logging in this function to avoid errors */
-  uint32_t ints = save_and_disable_interrupts();
-  /* FLASH_SECTOR_SIZE = 4096 Bytes (sector aligend) erase as per SDK manual and
-     only erase if saveid is zero to keep the number of flash erases low */
-  if (config_saveid == 0x0) flash_range_erase(FLASH_CONFIG_OFFSET, FLASH_SECTOR_SIZE);
-  /* FLASH_PAGE_SIZE = 256 Bytes (page aligned) write as per SDK manual */
-  flash_range_program((FLASH_CONFIG_OFFSET + (FLASH_PAGE_SIZE * config_saveid)), (uint8_t*)config_data, FLASH_PAGE_SIZE);
-  restore_interrupts(ints);
-  return;
-}
-
-void __no_inline_not_in_flash_func(write_config)(const Config* config)
-{
-  uint8_t config_data[CONFIG_SIZE] = {0};
-  static_assert(sizeof(Config) < CONFIG_SIZE, "[CONFIG] SAVE ERROR: Config struct doesn't fit inside CONFIG_SIZE");
-  memcpy(config_data, config, sizeof(Config));
-  int err = flash_safe_execute(write_config_lowlevel, config_data, 100);
-  if (err) {
-    usERR("Saving configuration: %d\n", err);
-  }
-  sleep_ms(100);
-  return;
-}
-
 void __no_inline_not_in_flash_func(save_config)(Config* config)
 {
   usNFO("\n");
   usCFG("Saving configuration:\n");
-  /* Verify config saveid and increase */
-  int noerr = (usbsid_config.config_saveid == config_saveid);
-  if (noerr) {
-    /* Only increase id's if both are equal */
-    config_saveid++; /* If it was 255 this means first boot up, will automatically be increased to 0 */
-    config_saveid = usbsid_config.config_saveid = (config_saveid <= 0xF ? config_saveid : 0);
-    usCFG("  Config id = %d, saving to 0x%x (%u)\n", config_saveid,
-      (FLASH_CONFIG_OFFSET + (FLASH_PAGE_SIZE * config_saveid)), (FLASH_CONFIG_OFFSET + (FLASH_PAGE_SIZE * config_saveid)));
-  } else {
-    usERR("Config save id's are not equal %d != %d. Unable to save configuration!!\n", usbsid_config.config_saveid, config_saveid);
+  if (!config_store_save(config)) {
+    usERR("Unable to save configuration!!\n");
     return;
   }
-  write_config(config);
   usCFG("Configuration saved!\n");
   return;
 }
@@ -465,6 +424,20 @@ void handle_config_request(uint8_t * buffer, uint32_t size)
       write_buffer_p[0] = (uint8_t)cfg.fmopl_sid;
       write_back_data(1);
       break;
+    case READ_BOOTSTATE:
+      usCFG("READ_BOOTSTATE: stage %u connect %lums mount %lums ready %lums\n",
+        (uint8_t)boot_stage, boot_connect_ms, boot_mount_ms, boot_ready_ms);
+      memset(write_buffer_p, 0, 64);
+      write_buffer_p[0] = (uint8_t)boot_stage;
+      write_buffer_p[1] = (uint8_t)boot_ready();
+      for (int i = 0; i < 4; i++) {  /* Big endian */
+        int shift = ((3 - i) * 8);
+        write_buffer_p[2 + i] = ((boot_connect_ms >> shift) & 0xFF);
+        write_buffer_p[6 + i] = ((boot_mount_ms >> shift) & 0xFF);
+        write_buffer_p[10 + i] = ((boot_ready_ms >> shift) & 0xFF);
+      }
+      write_back_data(14);
+      break;
     case READ_CONFIGACK:
 #if PCB_VERSION_INT >= 15
       usCFG("READ_CONFIGACK: %d\n", (int)config_unacknowledged());
@@ -483,12 +456,7 @@ void handle_config_request(uint8_t * buffer, uint32_t size)
     case RELOAD_CONFIG:
       usCFG("RELOAD_CONFIG\n");
       load_config(&usbsid_config);
-      apply_config(false); /* Not at boot */
-      for (uint i = 0; i < count_of(clockrates); i++) {
-        if (clockrates[i] == usbsid_config.clock_rate) {
-          apply_clockrate(i, true);
-        }
-      }
+      apply_config(false); /* Not at boot, also retimes the bus if the stored clock rate differs */
       break;
     case SET_CONFIG:
       usCFG("SET_CONFIG\n");
@@ -639,6 +607,12 @@ void handle_config_request(uint8_t * buffer, uint32_t size)
           usbsid_config.Asid.enabled = (bool)buffer[2];
           /* usbsid_config.Asid.buffered = (bool)buffer[3]; */
           break;
+        case BOARD_ASIDLAT:   /* ASID buffer latency */
+          if (buffer[2] >= ASID_LATENCY_MIN && buffer[2] <= ASID_LATENCY_MAX) {
+            usbsid_config.Asid.latency = buffer[2];
+            set_buffer_latency(usbsid_config.Asid.latency);
+          };
+          break;
         case BOARD_MIDI:      /* MIDI */
           usbsid_config.Midi.enabled = (bool)buffer[2];
           break;
@@ -773,9 +747,17 @@ void handle_config_request(uint8_t * buffer, uint32_t size)
       usCFG("TRIPLE_SID SOCKET 2\n");
       apply_preset_wrapper(PRESET_TRIPLE_S2);
       break;
-    case LOAD_MIDI_STATE: /* Unused */
-    case SAVE_MIDI_STATE:
-    case RESET_MIDI_STATE:
+    case LOAD_MIDI_STATE:   /* Recall MIDI patch buffer[1] onto channel buffer[2] */
+      usCFG("LOAD_MIDI_STATE\n");
+      midi_patch_recall((buffer[2] & 0xF), (buffer[1] & 0x7F));
+      break;
+    case SAVE_MIDI_STATE:   /* Save channel buffer[2] as MIDI patch buffer[1] */
+      usCFG("SAVE_MIDI_STATE\n");
+      midi_patch_save((buffer[2] & 0xF), (buffer[1] & 0x7F));
+      break;
+    case RESET_MIDI_STATE:  /* Reset the MIDI handler to defaults, the patch bank is kept */
+      usCFG("RESET_MIDI_STATE\n");
+      midi_processor_init();
       break;
     case SET_CLOCK:         /* Change SID clock frequency by array id */
       usCFG("SET_CLOCK\n");
@@ -790,6 +772,32 @@ void handle_config_request(uint8_t * buffer, uint32_t size)
       write_buffer_p[0] = clk_rate_id;
       write_back_data(1);
       break;
+    case GET_CLOCKINFO:     /* Returns clk_sys, the PIO dividers and the achieved SID clock error and jitter */
+      {
+        SysClockInfo ci;
+        mcu_sysclock_info(usbsid_config.clock_rate, &ci);
+        usCFG("GET_CLOCKINFO: %lu Hz, PHI1 divider %.4f, SID %lu Hz (%ld ppb, %u ps jitter%s)\n",
+          ci.sys_hz, ((float)ci.sid_div / 256), ci.actual_hz, ci.error_ppb, ci.jitter_ps,
+          (ci.tuned ? ", tuned" : ""));
+        memset(write_buffer_p, 0, 64);
+        for (int i = 0; i < 4; i++) {  /* Big endian */
+          int shift = ((3 - i) * 8);
+          write_buffer_p[0 + i] = ((ci.sys_hz >> shift) & 0xFF);
+          write_buffer_p[4 + i] = ((ci.sid_hz >> shift) & 0xFF);
+          write_buffer_p[8 + i] = ((ci.actual_hz >> shift) & 0xFF);
+          write_buffer_p[12 + i] = (((uint32_t)ci.error_ppb >> shift) & 0xFF);
+        }
+        write_buffer_p[16] = ((ci.jitter_ps >> 8) & 0xFF);
+        write_buffer_p[17] = (ci.jitter_ps & 0xFF);
+        for (int i = 0; i < 3; i++) {  /* 16.8 fixed point, integer part first */
+          int shift = ((2 - i) * 8);
+          write_buffer_p[18 + i] = ((ci.sid_div >> shift) & 0xFF);
+          write_buffer_p[21 + i] = ((ci.bus_div >> shift) & 0xFF);
+        }
+        write_buffer_p[24] = (uint8_t)ci.tuned;
+        write_back_data(25);
+      }
+      break;
     case LOCK_CLOCK:        /* Locks the clockrate from being changed, saved in config */
       usCFG("LOCK_CLOCK\n");
       if (buffer[1] == 0 || buffer[1] == 1) { /* Verify correct data */
@@ -1037,9 +1045,8 @@ void handle_config_request(uint8_t * buffer, uint32_t size)
         detect_fmopl(buffer[2]);
       }
       if (buffer[1] == 2) {
-        usCFG("SAVE ID BEFORE: %d (%d)\n", config_saveid, usbsid_config.config_saveid);
-        config_saveid = usbsid_config.config_saveid = 0;  /* reset saveid */
-        usCFG("SAVE ID AFTER: %d (%d)\n", config_saveid, usbsid_config.config_saveid);
+        usCFG("Next config save starts a fresh journal sector\n");
+        config_store_rotate();
       }
       if (buffer[1] == 3)  {
         read_fpgasid_configuration(buffer[2]);
@@ -1182,17 +1189,16 @@ void handle_config_request(uint8_t * buffer, uint32_t size)
       receiving_sidfile = true;
       sidbytes_received = 0;
       is_prg = ((buffer[1] == PRG_FILE) ? true : false);
-      sidfile = (uint8_t*)calloc(1, 0x10000); /* allocate 64KB */
+      sidfile_in_flash = false;
+      sidfile = (uint8_t*)arena_acquire(ARENA_SIDPLAYER, 0x10000); /* 64KB */
       if (sidfile == NULL) {
-        /*
-        * Handle out-of-memory error
-        * NOTE: RP2040 has 264KB RAM; 64KB is ~25% of total.
-        */
+        usERR("SID player arena unavailable\n");
+        receiving_sidfile = false;
       }
       break;
     case UPLOAD_SID_DATA:
       if (sidbytes_received == 0) usCFG("UPLOAD_SID_DATA\n");
-      if (receiving_sidfile) {
+      if (receiving_sidfile && (sidbytes_received + 62) <= ARENA_SIDPLAYER_SIZE) {
         for (int i = 1; i < 63; i++) { /* Max buffer size minus command byte (config init byte is already gone) */
           sidfile[sidbytes_received] = buffer[i];
           sidbytes_received++;
@@ -1212,8 +1218,31 @@ void handle_config_request(uint8_t * buffer, uint32_t size)
       sidfile_size = (buffer[1]<<8|buffer[2]);
       usDBG("Received SID file size: %u\n", sidfile_size);
       break;
+    case UPLOAD_SID_BEGIN:
+      usCFG("UPLOAD_SID_BEGIN\n");
+      sid_upload_begin(buffer);
+      break;
+    case UPLOAD_SID_CHUNK:
+      sid_upload_chunk(buffer);
+      break;
+    case UPLOAD_SID_COMMIT:
+      usCFG("UPLOAD_SID_COMMIT\n");
+      sid_upload_commit(buffer);
+      break;
+    case SID_CACHE_LOOKUP:
+      usCFG("SID_CACHE_LOOKUP\n");
+      sid_cache_request(buffer);
+      break;
+    case SID_CACHE_CLEAR:
+      usCFG("SID_CACHE_CLEAR\n");
+      sid_cache_clear();
+      break;
     case SID_PLAYER_TUNE:
       usCFG("SID_PLAYER_TUNE %d\n", buffer[1]);
+      if (buffer[1] != 0 && !sid_cache_select(buffer[1])) { /* 0 is the uploaded file */
+        usERR("Cache id %d is empty or the player is busy\n", buffer[1]);
+        break;
+      }
       tuneno = buffer[2]; /* Should be 0 if not supplied */
       usCFG("Subtune %d\n", tuneno);
       unmute_sid(); /* Must unmute before play start or some tunes will be silent */
@@ -1294,13 +1323,107 @@ void print_config(void)
   return;
 }
 
-void apply_busclock_settings(bool silent)
+/* What apply_config_changes found different from the running state */
+enum {
+  APPLY_NONE    = 0,
+  APPLY_ROUTING = (1 << 0),  /* RuntimeCFG, read by the bus on every write */
+  APPLY_CLOCK   = (1 << 1),  /* SID clock rate, restarts the PIO clocks */
+  APPLY_AUDIO   = (1 << 2),  /* Mono/stereo switch (v1.3+ boards only) */
+  APPLY_LED     = (1 << 3),  /* RGBLED SID */
+};
+
+/**
+ * @brief Retime the bus and everything derived from the SID clock
+ *        to usbsid_config.clock_rate
+ * @note the only part of a config change that touches DMA and the PIO clocks
+ */
+static void apply_bus_clockrate(void)
 {
-  if (!silent) usCFG("  Applying bus clock settings\n");
+  /* Cycled write buffer vars */
+  sid_hz = usbsid_config.clock_rate;
+  sid_mhz = (sid_hz / 1000 / 1000);
+  sid_us = (1 / sid_mhz);
+  midi_pitch_init(usbsid_config.clock_rate);  /* Retune MIDI notes */
+  usCFG("Clock information:\n");
+  usCFG("  Pico Clock @ %lu Hz, %.0f MHz, %.4f uS\n",
+    clock_get_hz(clk_sys), cpu_mhz, cpu_us);
+  usCFG("  C64 SID Clock @ %.0f Hz, %.6f MHz, %.4f uS\n",
+    sid_hz, sid_mhz, sid_us);
+  /* Start clock set */
+  // ISSUE: EVEN THOUGH THIS IS BETTER IT DOES NOT SOLVE THE CRACKLING/BUS ROT ISSUE!
   stop_dma_channels();
   restart_bus_clocks();
-  sync_pios(false);
   start_dma_channels();
+  sync_pios(false);
+  // ISSUE: WHEN THE BUS IS RESTARTED THE CRACKLING ON CYCLE EXACT TUNES IS IMMENSE!
+  // THIS IS AFTER PAL -> NTSC -> PAL
+  // restart_bus();
+  return;
+}
+
+/**
+ * @brief Swap in a new runtime config and apply only what differs from
+ *        the running state
+ * @note routing lives in RuntimeCFG and the bus reads it on every write,
+ *       so only a changed clock rate restarts the PIO clocks. At boot the
+ *       clock and audio switch are set up by their own init routines
+ *
+ * @param RuntimeCFG *new_cfg
+ * @param bool at_boot
+ * @return uint8_t APPLY_ flags of what was applied
+ */
+static uint8_t apply_config_changes(RuntimeCFG *new_cfg, bool at_boot)
+{
+  static bool applied_stereo = true;
+  static uint8_t applied_rgbsid = 0;
+  uint8_t changes = APPLY_NONE;
+
+  /* FMOpl lands in cfg directly, carry it over so it isn't seen as a change */
+  apply_fmopl_config();
+  new_cfg->fmopl_sid = cfg.fmopl_sid;
+  new_cfg->fmopl_enabled = cfg.fmopl_enabled;
+
+  if (memcmp(&cfg, new_cfg, sizeof(RuntimeCFG)) != 0) changes |= APPLY_ROUTING;
+  if (at_boot) {
+    applied_stereo = usbsid_config.stereo_en;  /* init_audio_switch sets it */
+  } else {
+    if (!usbsid_config.external_clock
+        && busclock_rate != usbsid_config.clock_rate) changes |= APPLY_CLOCK;
+#if PCB_VERSION_INT >= 13
+    if (applied_stereo != usbsid_config.stereo_en) changes |= APPLY_AUDIO;
+#endif
+  }
+  if (RGB_ENABLED
+      && (at_boot
+        || (changes & APPLY_ROUTING)
+        || applied_rgbsid != usbsid_config.RGBLED.sid_to_use)) changes |= APPLY_LED;  /* Follows the routing */
+
+  if (changes & APPLY_ROUTING) {
+    /* Atomically swap runtime config IRQ safe */
+    uint32_t irq = save_and_disable_interrupts();
+    memcpy(&cfg, new_cfg, sizeof(RuntimeCFG));
+    restore_interrupts(irq);
+  }
+  if (changes & APPLY_CLOCK) {
+    usCFG("  C64 SID Clock changed from %lu to %lu\n", busclock_rate, usbsid_config.clock_rate);
+    apply_bus_clockrate();
+  }
+  if (changes & APPLY_AUDIO) {
+    set_audio_switch(usbsid_config.stereo_en);
+    applied_stereo = usbsid_config.stereo_en;
+  }
+  if (changes & APPLY_LED) {
+    usCFG("Applying RGBLED SID\n");
+    apply_rgbled_config();
+    applied_rgbsid = usbsid_config.RGBLED.sid_to_use;
+  }
+  usCFG("  Applied:%s%s%s%s%s\n",
+    ((changes & APPLY_ROUTING) ? " routing" : ""),
+    ((changes & APPLY_CLOCK) ? " clock" : ""),
+    ((changes & APPLY_AUDIO) ? " audio" : ""),
+    ((changes & APPLY_LED) ? " led" : ""),
+    ((changes == APPLY_NONE) ? " nothing changed" : ""));
+  return changes;
 }
 
 ConfigError apply_new_presetconfig(void)
@@ -1317,16 +1440,8 @@ ConfigError apply_new_presetconfig(void)
   RuntimeCFG new_cfg;
   apply_runtime_config(&usbsid_config, &new_cfg);
 
-  /* Find configured FMOpl */
-  apply_fmopl_config();
-
-  /* Atomically swap runtime config IRQ safe */
-  uint32_t irq = save_and_disable_interrupts();
-  memcpy(&cfg, &new_cfg, sizeof(RuntimeCFG));
-  restore_interrupts(irq);
-
-  /* Apply to hardware (unless boot) */
-  apply_busclock_settings(true);
+  /* Apply what changed */
+  apply_config_changes(&new_cfg, false);
 
   return CFG_OK;
 }
@@ -1347,29 +1462,11 @@ ConfigError apply_config(bool at_boot)
   RuntimeCFG new_cfg;
   apply_runtime_config(&usbsid_config, &new_cfg);
 
-  /* Find configured FMOpl */
-  apply_fmopl_config();
-
-  /* Atomically swap runtime config IRQ safe */
-  uint32_t irq = save_and_disable_interrupts();
-  memcpy(&cfg, &new_cfg, sizeof(RuntimeCFG));
-  restore_interrupts(irq);
-
-  /* Apply to hardware (unless boot) */
-  if (!at_boot) {
-    usCFG("  Restarting PIO\n");
-    apply_busclock_settings(false);
-  }
+  /* Apply what changed, the bus only restarts for a new clock rate */
+  apply_config_changes(&new_cfg, at_boot);
 
   usCFG("  Success: %d SIDs active\n", cfg.numsids);
 
-  if (RGB_ENABLED) {
-    usCFG("Applying RGBLED SID\n");
-    apply_rgbled_config();
-  } else {
-    usCFG("  RGBLED not available\n");
-  }
-
   /* Print config at end of apply if requested */
   if (!at_boot) {
     print_config();
@@ -1450,28 +1547,11 @@ void apply_clockrate(int n_clock, bool suspend_sids)
         usbsid_config.clock_rate = clockrates[n_clock];
         usbsid_config.refresh_rate = refreshrates[n_clock]; /* Used by ASID */
         usbsid_config.raster_rate = rasterrates[n_clock]; /* Used by the Vu and the ASID buffer */
-        /* Cycled write buffer vars */
-        sid_hz = usbsid_config.clock_rate;
-        sid_mhz = (sid_hz / 1000 / 1000);
-        sid_us = (1 / sid_mhz);
-        usCFG("Clock information:\n");
-        usCFG("  Pico Clock @ %lu Hz, %.0f MHz, %.4f uS\n",
-          clock_get_hz(clk_sys), cpu_mhz, cpu_us);
-        usCFG("  C64 SID Clock @ %.0f Hz, %.6f MHz, %.4f uS\n",
-          sid_hz, sid_mhz, sid_us);
-        /* Start clock set */
-        // ISSUE: EVEN THOUGH THIS IS BETTER IT DOES NOT SOLVE THE CRACKLING/BUS ROT ISSUE!
-        stop_dma_channels();
-        restart_bus_clocks();
-        start_dma_channels();
-        sync_pios(false);
+        apply_bus_clockrate();
         if (suspend_sids) {
           usCFG("Enable SID's and UnMute\n");
           enable_sid(true);
         }
-        // ISSUE: WHEN THE BUS IS RESTARTED THE CRACKLING ON CYCLE EXACT TUNES IS IMMENSE!
-        // THIS IS AFTER PAL -> NTSC -> PAL
-        // restart_bus();
         return;
       } else {
         usCFG("Requested C64 SID Clock from %d and to %d are equal, skipping SET_CLOCK\n",
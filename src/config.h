@@ -91,6 +91,12 @@ extern uint32_t ADDR_PERSISTENT[];
 #define FLASH_CONFIG_OFFSET (FLASH_PERSISTENT_OFFSET + ((FLASH_PERSISTENT_SIZE / 4) * 3))
 /* Max config size = 256 Bytes == FLASH_PAGE_SIZE (FLASH_SECTOR_SIZE / 16 config saves) */
 #define CONFIG_SIZE (FLASH_SECTOR_SIZE / 16)
+/* MIDI patch bank offset in flash memory, one sector per program (128 * 4KB = 512KB) */
+#define FLASH_MIDI_OFFSET FLASH_PERSISTENT_OFFSET
+#define MIDI_PATCHES 128
+/* SID tune cache offset in flash memory, between the MIDI patch bank and the config (256KB) */
+#define FLASH_SIDCACHE_OFFSET (FLASH_MIDI_OFFSET + (MIDI_PATCHES * FLASH_SECTOR_SIZE))
+#define FLASH_SIDCACHE_SIZE (FLASH_CONFIG_OFFSET - FLASH_SIDCACHE_OFFSET)
 
 
 /* USBSID-Pico config struct */
@@ -108,11 +114,17 @@ typedef struct Socket {
   bool    dualsid : 1;  /* enable / disable dual SID support for this socket (requires clone) */
 } Socket;
 
+/* Layout version of Config in the config journal, bump it when fields move
+ * or change meaning and add a step to migrate() in config_store.c. Fields
+ * appended at the end need neither, they keep their defaults on load.
+ * v0 is the pre-journal layout, Asid had no latency byte yet */
+#define CONFIG_VERSION 1
+
 typedef struct Config { // TODO: Add overrides for detect_default_config and add 5v/9v/12 overrides so they cannot be changed
   /* First three items must stay in the same order! */
   uint32_t magic;                /* Contains firmware build magic */
   int      default_config;       /* Defines if config is default config or not */
-  uint8_t  config_saveid;        /* What the nth position is in flash where this config comes from */
+  uint8_t  config_saveid;        /* Pre-journal save slot, only read when importing an old config */
   /* Don't care from here */
   uint32_t clock_rate;           /* clock speed identifier */
   uint16_t refresh_rate;         /* refresh rate identifier based on clockspeed ~ not configurable */
@@ -137,6 +149,7 @@ typedef struct Config { // TODO: Add overrides for detect_default_config and add
     bool enabled : 1;            /* Cannot be disabled */
   } WebUSB;                      /* 6 */
   struct {
+    uint8_t latency;             /* ASID buffer pre-roll and target depth in frames */
     bool enabled : 1;
     /* bool buffered : 1; */           /* Enable/Disable ASID buffering by default (protocal can enable this) */
   } Asid;                        /* 7 */
@@ -169,6 +182,8 @@ typedef struct Config { // TODO: Add overrides for detect_default_config and add
 #define USBSID_RASTER_RATE_DEFAULT   R_DEFAULT
 #endif
 
+#define USBSID_ASID_LATENCY_DEFAULT  3  /* frames, matches the previous fixed pre-roll */
+
 #define USBSID_DEFAULT_CONFIG_INIT { \
   .magic = MAGIC_SMOKE, \
   .default_config = true, \
@@ -224,6 +239,7 @@ typedef struct Config { // TODO: Add overrides for detect_default_config and add
     .enabled = true \
   }, \
   .Asid = { \
+    .latency = USBSID_ASID_LATENCY_DEFAULT, \
     .enabled = true, \
     /* .buffered = false */ \
   }, \
@@ -309,6 +325,7 @@ enum
   RELOAD_CONFIG    = 0x38,  /* Reload and apply stored config from flash */
   READ_NUMSIDS     = 0x39,  /* Returns the number of SIDs in byte 0 */
   READ_FMOPLSID    = 0x3A,  /* Returns the sidno for FMOpl 1~4, 0 is disable */
+  READ_BOOTSTATE   = 0x3E,  /* Returns boot stage, ready and the connect, mount and ready times in ms since boot */
   READ_CONFIGACK   = 0x3F,  /* Returns 1 if socket power is disabled and read/writes are dropped */
 
   SINGLE_SID       = 0x40,  /* Single SID Socket One */
@@ -337,6 +354,7 @@ enum
   STOP_TESTS       = 0x59,  /* Interrupt any running SID tests */
   DETECT_CLONES    = 0x5A,  /* Detect clone SID types */
   AUTO_DETECT      = 0x5B,  /* Run auto detection routine (fallback/workaround for rp2350 bug) */
+  GET_CLOCKINFO    = 0x5C,  /* Returns clk_sys, the PIO dividers and the achieved SID clock error and jitter */
 
   LOAD_MIDI_STATE  = 0x60,
   SAVE_MIDI_STATE  = 0x61,
@@ -370,9 +388,14 @@ enum
   UPLOAD_SID_END     = 0xD2,  /* End command for USBSID to exit receiving mode */
   UPLOAD_SID_SIZE    = 0xD3,  /* Packet containing the actual file size */
   UPLOAD_SID_LENGTH  = 0xD4,  /* Supply the play with the length of the current trakc played */
+  UPLOAD_SID_BEGIN   = 0xD5,  /* Framed upload: announce filetype, size and CRC32, resumes a matching upload */
+  UPLOAD_SID_CHUNK   = 0xD6,  /* Framed upload: offset, length and CRC32 checked data chunk, not acknowledged */
+  UPLOAD_SID_COMMIT  = 0xD7,  /* Framed upload: verify the file and hand it to the player, optionally cache it in flash */
+  SID_CACHE_LOOKUP   = 0xD8,  /* Look up a tune in the flash cache by size and CRC32, returns its cache id */
+  SID_CACHE_CLEAR    = 0xD9,  /* Erase the flash tune cache index */
 
   /* Internal SID player */
-  SID_PLAYER_TUNE    = 0xE0,  /* Load SID file into SID player memory and initialise internal SID player */
+  SID_PLAYER_TUNE    = 0xE0,  /* Load SID file into SID player memory and initialise internal SID player, cache id in second byte where 0 is the uploaded file */
   SID_PLAYER_START   = 0xE1,  /* Start SID file play */
   SID_PLAYER_STOP    = 0xE2,  /* Stop SID file play */
   SID_PLAYER_PAUSE   = 0xE3,  /* Pause/Unpause SID file play */
@@ -456,6 +479,7 @@ enum {
   BOARD_FLIPPED   = 13,
   BOARD_MIXED     = 14,
   BOARD_SDETECT   = 15, /* Automatic socket change detection v1.4+ */
+  BOARD_ASIDLAT   = 16, /* ASID buffer latency in frames */
 };
 
 /**
@@ -507,9 +531,11 @@ extern const char    *pcb_version;
 
 /* Functions from config.c */
 bool        config_unacknowledged(void);
+bool        boot_allows_config(uint8_t command);
 void        load_config(Config *config);
 void        save_config_ext(void);
 void        handle_config_request(uint8_t *buffer, uint32_t size);
+void        write_back_data(size_t buffersize);
 void        print_config(void);
 ConfigError apply_new_presetconfig(void);
 ConfigError apply_config(bool at_boot);
@@ -203,6 +203,8 @@ void print_config_overview(void)
     switch_str((int)usbsid_config.Midi.enabled));
   usCFG("  ASID feature = %s\n",
     switch_str((int)usbsid_config.Asid.enabled));
+  usCFG("  ASID latency = %u frames\n",
+    usbsid_config.Asid.latency);
 #if PCB_VERSION_INT >= 14
   usCFG("\n");
   usCFG("Verification of socket change detection on boot = %s\n",
@@ -661,8 +661,8 @@ ConfigError detect_socket_change(void)
   reset_sid();
 #endif
 
-  /* Run detection */
-  DetectionResult det = detect_all();
+  /* Run detection, a known socket fingerprint uses the cached result */
+  DetectionResult det = detect_all(true);
 
   /* Verify results */
   ConfigError change_detected = verify_socket_detection_results(&det);
@@ -0,0 +1,386 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * config_store.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stddef.h>
+
+#include <globals.h>
+#include <config.h>
+#include <config_store.h>
+#include <mcu.h>
+#include <logging.h>
+
+
+#define RECORD_ERASED         0xFFFFFFFF
+#define CONFIG_LEGACY_VERSION 0  /* Raw ConfigV0 pages from before the journal */
+#define LEGACY_SLOTS          16
+
+typedef struct __attribute__((packed)) ConfigRecord {
+  uint32_t seq;      /* Increments with every save, 0xFFFFFFFF is an erased slot */
+  uint16_t version;  /* CONFIG_VERSION of the payload layout */
+  uint16_t length;   /* sizeof(Config) of the firmware that wrote it */
+  uint32_t magic;    /* MAGIC_SMOKE of the firmware that wrote it */
+  uint32_t crc;      /* CRC32 of the fields above and length bytes of payload */
+  uint8_t  payload[CONFIG_RECORD_PAYLOAD];
+} ConfigRecord;
+
+/* Config as stored before the journal, Asid had no latency byte yet */
+typedef struct ConfigV0 {
+  uint32_t magic;
+  int      default_config;
+  uint8_t  config_saveid;
+  uint32_t clock_rate;
+  uint16_t refresh_rate;
+  uint16_t raster_rate;
+  uint8_t  last_preset;
+  Socket   socketOne;
+  Socket   socketTwo;
+  struct {
+    bool enabled : 1;
+    bool idle_breathe : 1;
+  } LED;
+  struct {
+    uint8_t brightness;
+    int     sid_to_use;
+    bool    enabled : 1;
+    bool    idle_breathe : 1;
+  } RGBLED;
+  struct {
+    bool enabled : 1;
+  } Cdc;
+  struct {
+    bool enabled : 1;
+  } WebUSB;
+  struct {
+    bool enabled : 1;
+  } Asid;
+  struct {
+    bool enabled : 1;
+  } Midi;
+  struct {
+    int sidno;
+    bool enabled : 1;
+  } FMOpl;
+  bool external_clock : 1;
+  bool lock_clockrate : 1;
+  bool stereo_en : 1;
+  bool lock_audio_sw : 1;
+  bool mirrored : 1;
+  bool flipped : 1;
+  bool mixed : 1;
+  bool need_confirmation : 1;
+  bool disable_changedetect : 1;
+} ConfigV0;
+
+static_assert(CONFIG_SIZE == FLASH_PAGE_SIZE, "[CONFIG] A journal record must be one flash page");
+static_assert(sizeof(ConfigRecord) == CONFIG_SIZE, "[CONFIG] ConfigRecord doesn't match CONFIG_SIZE");
+static_assert(sizeof(Config) <= CONFIG_RECORD_PAYLOAD, "[CONFIG] Config struct doesn't fit in a journal record");
+static_assert(sizeof(ConfigV0) <= CONFIG_RECORD_PAYLOAD, "[CONFIG] ConfigV0 struct doesn't fit in a journal record");
+static_assert(offsetof(ConfigRecord, crc) == (CONFIG_RECORD_HEADER - 4), "[CONFIG] crc must be the last header field");
+
+#define journal_slot(sector, slot) \
+  ((const ConfigRecord *)(XIP_BASE + CONFIG_JOURNAL_OFFSET + ((sector) * FLASH_SECTOR_SIZE) + ((slot) * CONFIG_SIZE)))
+#define legacy_slot(slot) \
+  ((const ConfigV0 *)(XIP_BASE + FLASH_CONFIG_OFFSET + ((slot) * CONFIG_SIZE)))
+
+/* Where the next record goes */
+static struct {
+  uint32_t seq;
+  uint8_t sector;
+  uint8_t slot;
+  bool scanned;
+  bool rotate;  /* Start on the other sector with the next save */
+} journal = {0};
+
+typedef struct {
+  uint32_t offset;
+  const uint8_t *page;
+  bool erase;  /* Erase the sector at offset first */
+} config_write_t;
+
+
+static void __no_inline_not_in_flash_func(write_journal_lowlevel)(void *param)
+{ /* No logging in this function to avoid errors */
+  const config_write_t *w = (const config_write_t *)param;
+  uint32_t ints = save_and_disable_interrupts();
+  if (w->erase) flash_range_erase(w->offset, FLASH_SECTOR_SIZE);
+  flash_range_program(w->offset, w->page, FLASH_PAGE_SIZE);
+  restore_interrupts(ints);
+  return;
+}
+
+static uint32_t record_crc(const ConfigRecord *r)
+{
+  uint32_t crc = crc32_update(0, (const uint8_t *)r, offsetof(ConfigRecord, crc));
+  return crc32_update(crc, r->payload, r->length);
+}
+
+static bool record_valid(const ConfigRecord *r)
+{
+  return (r->seq != RECORD_ERASED
+    && r->length <= CONFIG_RECORD_PAYLOAD
+    && record_crc(r) == r->crc);
+}
+
+static bool slot_erased(const ConfigRecord *r)
+{
+  const uint32_t *w = (const uint32_t *)r;
+  for (uint i = 0; i < (CONFIG_SIZE / sizeof(uint32_t)); i++) {
+    if (w[i] != RECORD_ERASED) return false;
+  }
+  return true;
+}
+
+/* Slots are filled in order, the written ones are a prefix of the sector */
+static uint8_t used_slots(uint8_t sector)
+{
+  uint8_t lo = 0, hi = CONFIG_JOURNAL_SLOTS;
+  while (lo < hi) {
+    uint8_t mid = ((lo + hi) / 2);
+    if (journal_slot(sector, mid)->seq == RECORD_ERASED) {
+      hi = mid;
+    } else {
+      lo = (mid + 1);
+    }
+  }
+  return lo;
+}
+
+/**
+ * @brief Find the newest valid record and the next free slot
+ *
+ * @return const ConfigRecord* in flash or NULL if the journal is empty
+ */
+static const ConfigRecord *journal_scan(void)
+{
+  const ConfigRecord *latest = NULL;
+  journal.sector = 0;
+  journal.slot = used_slots(0);
+
+  for (uint8_t s = 0; s < CONFIG_JOURNAL_SECTORS; s++) {
+    uint8_t used = used_slots(s);
+    for (int slot = (used - 1); slot >= 0; slot--) {
+      const ConfigRecord *r = journal_slot(s, slot);
+      if (!record_valid(r)) {
+        usWRN("  Skipping corrupt config record in sector %u slot %d\n", s, slot);
+        continue;
+      }
+      if (latest == NULL || r->seq > latest->seq) {
+        latest = r;
+        journal.sector = s;
+        journal.slot = used;
+      }
+      break;
+    }
+  }
+  journal.seq = ((latest != NULL) ? (latest->seq + 1) : 0);
+  journal.scanned = true;
+  return latest;
+}
+
+/* Pre-journal slots hold a raw Config, the newest is the last one whose saveid matches its slot */
+static bool legacy_import(ConfigRecord *rec)
+{
+  int last = -1;
+  while ((last + 1) < LEGACY_SLOTS && legacy_slot(last + 1)->config_saveid == (last + 1)) last++;
+  if (last < 0 || legacy_slot(last)->magic == RECORD_ERASED) return false;
+
+  memcpy(rec->payload, legacy_slot(last), sizeof(ConfigV0));
+  stdio_flush();
+  rec->version = CONFIG_LEGACY_VERSION;
+  rec->length = sizeof(ConfigV0);
+  rec->magic = ((const ConfigV0 *)rec->payload)->magic;
+  usCFG("  Importing pre-journal configuration from slot %d\n", last);
+  return true;
+}
+
+/* v0 -> v1: Asid gained the latency byte in front of its flags */
+static void migrate_v0(ConfigRecord *rec, const Config *defaults)
+{
+  ConfigV0 old;
+  Config c = *defaults;
+  memcpy(&old, rec->payload, sizeof(ConfigV0));
+
+  c.magic = old.magic;
+  c.default_config = old.default_config;
+  c.config_saveid = old.config_saveid;
+  c.clock_rate = old.clock_rate;
+  c.refresh_rate = old.refresh_rate;
+  c.raster_rate = old.raster_rate;
+  c.last_preset = old.last_preset;
+  c.socketOne = old.socketOne;
+  c.socketTwo = old.socketTwo;
+  c.LED.enabled = old.LED.enabled;
+  c.LED.idle_breathe = old.LED.idle_breathe;
+  c.RGBLED.brightness = old.RGBLED.brightness;
+  c.RGBLED.sid_to_use = old.RGBLED.sid_to_use;
+  c.RGBLED.enabled = old.RGBLED.enabled;
+  c.RGBLED.idle_breathe = old.RGBLED.idle_breathe;
+  c.Cdc.enabled = old.Cdc.enabled;
+  c.WebUSB.enabled = old.WebUSB.enabled;
+  c.Asid.enabled = old.Asid.enabled;  /* latency keeps its default */
+  c.Midi.enabled = old.Midi.enabled;
+  c.FMOpl.sidno = old.FMOpl.sidno;
+  c.FMOpl.enabled = old.FMOpl.enabled;
+  c.external_clock = old.external_clock;
+  c.lock_clockrate = old.lock_clockrate;
+  c.stereo_en = old.stereo_en;
+  c.lock_audio_sw = old.lock_audio_sw;
+  c.mirrored = old.mirrored;
+  c.flipped = old.flipped;
+  c.mixed = old.mixed;
+  c.need_confirmation = old.need_confirmation;
+  c.disable_changedetect = old.disable_changedetect;
+
+  memset(rec->payload, 0xFF, CONFIG_RECORD_PAYLOAD);
+  memcpy(rec->payload, &c, sizeof(Config));
+  rec->length = sizeof(Config);
+  return;
+}
+
+/**
+ * @brief Bring a record up to the current Config layout
+ * @note each step upgrades one version and falls through to the next,
+ *       fields appended to Config need no step, they keep their defaults
+ *
+ * @param ConfigRecord *rec
+ * @param const Config *defaults for fields the stored layout doesn't have
+ * @return bool false if the record can't be used
+ */
+static bool migrate(ConfigRecord *rec, const Config *defaults)
+{
+  if (rec->version > CONFIG_VERSION) {
+    usWRN("  Config layout v%u is from newer firmware (v%u)\n", rec->version, CONFIG_VERSION);
+    return false;
+  }
+  switch (rec->version) {
+    case CONFIG_LEGACY_VERSION:
+      if (rec->length != sizeof(ConfigV0)) {
+        usWRN("  Config layout v%u has unexpected length %u\n", rec->version, rec->length);
+        return false;
+      }
+      migrate_v0(rec, defaults);
+      usCFG("  Migrated config layout v0 to v1\n");
+      /* fall through */
+    case 1:
+    default:
+      break;
+  }
+  rec->version = CONFIG_VERSION;
+  return true;
+}
+
+/**
+ * @brief Load the newest stored config on top of config
+ * @note config must hold the defaults, anything not stored keeps them
+ *
+ * @param Config *config
+ * @return bool false if nothing usable is stored
+ */
+bool config_store_load(Config *config)
+{
+  ConfigRecord rec;
+  const ConfigRecord *r = journal_scan();
+
+  if (r != NULL) {
+    /* NOTICE: Do not do any logging directly after memcpy without stdio_flush or the Pico will freeze! */
+    memcpy(&rec, r, sizeof(ConfigRecord));
+    stdio_flush();
+    usCFG("  Found config record %u (layout v%u, %u bytes) in sector %u\n",
+      rec.seq, rec.version, rec.length, journal.sector);
+  } else if (!legacy_import(&rec)) {
+    usCFG("  No stored configuration\n");
+    return false;
+  }
+  if (!migrate(&rec, config)) return false;
+
+  memcpy(config, rec.payload, ((rec.length < sizeof(Config)) ? rec.length : sizeof(Config)));
+  if (rec.magic != MAGIC_SMOKE) {
+    usCFG("  Migrated configuration from firmware build %u\n", rec.magic);
+  }
+  return true;
+}
+
+/**
+ * @brief Append config to the journal
+ * @note only erases when switching to the other sector
+ *
+ * @param const Config *config
+ * @return bool false if the record couldn't be written or verified
+ */
+bool config_store_save(const Config *config)
+{
+  if (!journal.scanned) journal_scan();
+
+  ConfigRecord rec;
+  memset(&rec, 0xFF, sizeof(ConfigRecord));
+  memcpy(rec.payload, config, sizeof(Config));
+  rec.version = CONFIG_VERSION;
+  rec.length = sizeof(Config);
+  rec.magic = MAGIC_SMOKE;
+
+  for (int attempt = 0; attempt < 2; attempt++) {  /* A failed verify retries in the next slot */
+    bool erase = false;
+    for (;;) {
+      if (journal.rotate || journal.slot >= CONFIG_JOURNAL_SLOTS) {
+        journal.sector = ((journal.sector + 1) % CONFIG_JOURNAL_SECTORS);
+        journal.slot = 0;
+        journal.rotate = false;
+        erase = true;
+        break;
+      }
+      if (slot_erased(journal_slot(journal.sector, journal.slot))) break;
+      journal.slot++;  /* Torn write or junk, never program over it */
+    }
+
+    rec.seq = journal.seq;
+    rec.crc = record_crc(&rec);
+    uint32_t offset = (CONFIG_JOURNAL_OFFSET + (journal.sector * FLASH_SECTOR_SIZE) + (journal.slot * CONFIG_SIZE));
+    config_write_t w = { .offset = offset, .page = (const uint8_t *)&rec, .erase = erase };
+    int err = flash_safe_execute(write_journal_lowlevel, &w, 100);
+    const ConfigRecord *written = journal_slot(journal.sector, journal.slot);
+    journal.slot++;
+    if (err != PICO_OK) {
+      usERR("  Config write @ 0x%x failed: %d\n", offset, err);
+      return false;
+    }
+    if (record_valid(written) && written->seq == rec.seq) {
+      usCFG("  Config record %u saved to sector %u slot %u%s\n",
+        rec.seq, journal.sector, (journal.slot - 1), (erase ? " after erase" : ""));
+      journal.seq++;
+      return true;
+    }
+    usERR("  Config record %u failed to verify @ 0x%x\n", rec.seq, offset);
+  }
+  return false;
+}
+
+/**
+ * @brief Make the next save start on a freshly erased sector
+ */
+void config_store_rotate(void)
+{
+  journal.rotate = true;
+  return;
+}
@@ -0,0 +1,70 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * config_store.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _USBSID_CONFIG_STORE_H_
+#define _USBSID_CONFIG_STORE_H_
+#pragma once
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+/* Default includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Project includes required for this header */
+#include <config.h>
+
+
+/* Config journal
+ *
+ * Every save appends a record of one flash page to the journal, a sector
+ * is only erased when the other one is full. A record holds a sequence
+ * number, the Config layout version, the payload length, the build magic
+ * and a CRC32 over all of it. Loading binary searches each sector for its
+ * last written slot and walks back past torn or corrupt records.
+ *
+ * Records from older layouts are migrated forward, fields that didn't exist
+ * yet keep their defaults. The first sector of the config area holds the
+ * pre-journal slots, these are imported once when the journal is empty.
+ */
+#define CONFIG_JOURNAL_OFFSET  (FLASH_CONFIG_OFFSET + FLASH_SECTOR_SIZE)
+#define CONFIG_JOURNAL_SECTORS 2
+#define CONFIG_JOURNAL_SLOTS   (FLASH_SECTOR_SIZE / CONFIG_SIZE)  /* Per sector */
+#define CONFIG_RECORD_HEADER   16
+#define CONFIG_RECORD_PAYLOAD  (CONFIG_SIZE - CONFIG_RECORD_HEADER)
+
+/* Functions from config_store.c */
+bool config_store_load(Config *config);
+bool config_store_save(const Config *config);
+void config_store_rotate(void);
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* _USBSID_CONFIG_STORE_H_ */
@@ -28,13 +28,20 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "hardware/watchdog.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
 #include "pico/stdlib.h"
 #include "pico/unique_id.h"
 #include "pico/bootrom.h"
 
 #include "logging.h"
+#include "mcu.h"
+
+
+static uint32_t tuned_sid_hz = 0;  /* SID clock clk_sys was picked for */
 
 
 uint64_t mcu_get_unique_id(void)
@@ -66,3 +73,110 @@ void mcu_jump_to_bootloader(void)
   */
   reset_usb_boot(0x00,0x00);
 }
+
+/**
+ * @brief CRC32 (IEEE 802.3), chainable, start with 0
+ *
+ * @param uint32_t crc, the result of the previous call or 0
+ * @param const uint8_t *data
+ * @param size_t len
+ * @return uint32_t the updated crc
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    for (int b = 0; b < 8; b++) {
+      crc = ((crc >> 1) ^ (0xEDB88320u & -(crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+/**
+ * @brief PIO divider for out_hz state machine cycles, rounded to nearest
+ *
+ * @param uint32_t sys_hz
+ * @param uint32_t out_hz
+ * @return uint32_t divider in 16.8 fixed point like the PIO CLKDIV register
+ */
+uint32_t mcu_clkdiv(uint32_t sys_hz, uint32_t out_hz)
+{
+  return (uint32_t)((((uint64_t)sys_hz << 8) + (out_hz / 2)) / out_hz);
+}
+
+static int32_t clkdiv_error_ppb(uint32_t sys_hz, uint32_t out_hz, uint32_t div)
+{
+  int64_t diff = (((int64_t)sys_hz << 8) - ((int64_t)out_hz * div));
+  return (int32_t)((diff * 1000000000LL) / ((int64_t)out_hz * div));
+}
+
+/**
+ * @brief Retune clk_sys so PHI1 gets an integer divider
+ * @note boot only, peripherals clocked from clk_sys must be set up afterwards
+ *       or have their dividers recalculated by the caller
+ *
+ * @param uint32_t sid_hz
+ * @return bool true if clk_sys was changed
+ */
+bool mcu_tune_sysclock(uint32_t sid_hz)
+{
+  uint32_t best_hz = 0, best_vco = 0;
+  uint best_pd1 = 0, best_pd2 = 0;
+
+  tuned_sid_hz = 0;
+  for (uint fbdiv = 320; fbdiv >= 16; fbdiv--) {
+    uint32_t vco = (XOSC_HZ * fbdiv);
+    if (vco < PICO_PLL_VCO_MIN_FREQ_HZ || vco > PICO_PLL_VCO_MAX_FREQ_HZ) continue;
+    for (uint pd1 = 7; pd1 >= 1; pd1--) {
+      for (uint pd2 = pd1; pd2 >= 1; pd2--) {
+        if ((vco % (pd1 * pd2)) != 0) continue;  /* clock_get_hz would be off */
+        uint32_t sys_hz = (vco / (pd1 * pd2));
+        if (sys_hz < SYSCLK_MIN_HZ || sys_hz > SYSCLK_MAX_HZ || sys_hz <= best_hz) continue;
+        uint32_t div = mcu_clkdiv(sys_hz, (sid_hz * 2));
+        if ((div & 0xFF) != 0) continue;
+        if (abs(clkdiv_error_ppb(sys_hz, (sid_hz * 2), div)) > SYSCLK_MAX_ERROR_PPB) continue;
+        best_hz = sys_hz;
+        best_vco = vco;
+        best_pd1 = pd1;
+        best_pd2 = pd2;
+      }
+    }
+  }
+
+  if (best_hz == 0) {
+    usWRN("[MCU] No integer SID clock divider for %lu Hz, keeping %lu Hz\n",
+      sid_hz, clock_get_hz(clk_sys));
+    return false;
+  }
+  tuned_sid_hz = sid_hz;
+  if (best_hz == clock_get_hz(clk_sys)) return false;
+
+  usNFO("[MCU] System clock %lu Hz -> %lu Hz (VCO %lu Hz / %u / %u) for %lu Hz SID clock\n",
+    clock_get_hz(clk_sys), best_hz, best_vco, best_pd1, best_pd2, sid_hz);
+  stdio_flush();
+  set_sys_clock_pll(best_vco, best_pd1, best_pd2);
+  return true;
+}
+
+/**
+ * @brief Fill info with the PIO dividers and PHI1 accuracy at the current clk_sys
+ *
+ * @param uint32_t sid_hz
+ * @param SysClockInfo *info
+ */
+void mcu_sysclock_info(uint32_t sid_hz, SysClockInfo *info)
+{
+  uint32_t sys_hz = clock_get_hz(clk_sys);
+  info->sys_hz = sys_hz;
+  info->sid_hz = sid_hz;
+  info->sid_div = mcu_clkdiv(sys_hz, (sid_hz * 2));
+  info->bus_div = mcu_clkdiv(sys_hz, (sid_hz * 64));
+  info->actual_hz = (uint32_t)((((uint64_t)sys_hz << 7) + (info->sid_div / 2)) / info->sid_div);
+  info->error_ppb = clkdiv_error_ppb(sys_hz, (sid_hz * 2), info->sid_div);
+  /* The fractional divider spreads a stall cycle over the PHI1 periods */
+  info->jitter_ps = (((info->sid_div & 0xFF) != 0) ? (uint16_t)(1000000000000ULL / sys_hz) : 0);
+  info->tuned = (tuned_sid_hz == sid_hz);
+  return;
+}
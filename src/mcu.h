@@ -33,12 +33,55 @@
 
 /* Default includes */
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
 
 
+/* System clock versus SID clock
+ *
+ * PHI1 is toggled by a two instruction PIO program, a fractional divider
+ * makes its edges wander by a whole clk_sys period. At boot the PLL is
+ * searched for the fastest clk_sys inside the window below that divides
+ * the SID clock to an integer within SYSCLK_MAX_ERROR_PPB.
+ */
+#if PICO_RP2040
+#if ONBOARD_SIDPLAYER
+#define SYSCLK_MIN_HZ 250000000
+#define SYSCLK_MAX_HZ 250000000
+#else
+#define SYSCLK_MIN_HZ 180000000
+#define SYSCLK_MAX_HZ 200000000
+#endif /* ONBOARD_SIDPLAYER */
+#else /* PICO_RP2350 */
+#if ONBOARD_SIDPLAYER
+#define SYSCLK_MIN_HZ 200000000
+#define SYSCLK_MAX_HZ 200000000
+#else
+#define SYSCLK_MIN_HZ 150000000
+#define SYSCLK_MAX_HZ 200000000
+#endif /* ONBOARD_SIDPLAYER */
+#endif /* PICO_RP2040 */
+#define SYSCLK_MAX_ERROR_PPB 50000  /* 50 ppm, a C64 crystal is no better */
+
+typedef struct SysClockInfo {
+  uint32_t sys_hz;     /* clk_sys */
+  uint32_t sid_hz;     /* Requested SID clock */
+  uint32_t sid_div;    /* PHI1 PIO divider, 16.8 fixed point */
+  uint32_t bus_div;    /* Bus PIO divider, 16.8 fixed point */
+  uint32_t actual_hz;  /* Achieved SID clock */
+  int32_t  error_ppb;  /* Achieved versus requested SID clock */
+  uint16_t jitter_ps;  /* Peak PHI1 edge jitter, 0 with an integer divider */
+  bool     tuned;      /* clk_sys was picked for this SID clock */
+} SysClockInfo;
+
 /* Functions from mcu.c */
 uint64_t mcu_get_unique_id(void);
 void     mcu_reset(void);
 void     mcu_jump_to_bootloader(void);
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len);
+uint32_t mcu_clkdiv(uint32_t sys_hz, uint32_t out_hz);
+bool     mcu_tune_sysclock(uint32_t sid_hz);
+void     mcu_sysclock_info(uint32_t sid_hz, SysClockInfo *info);
 
 
 #ifdef __cplusplus
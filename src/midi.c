@@ -37,16 +37,48 @@
 #include <sid.h>
 #include <logging.h>
 #include <midi_handler.h>
+#include <midi_sequencer.h>
 #include <midi_defs.h>
 #include <sysex.h>
 
 #if defined(ONBOARD_EMULATOR)
 #include <usbsid.h> /* emulator variables */
 #include <emudore_emulator.h> /* Cynthcart ~ Emudore */
-queue_t cynthcart_queue;
+queue_t cynthcart_queue;  /* Receive side of the emulated MIDI cart */
+/* Lock free byte ring from USB MIDI (core 0, only writes head) to the
+ * emulator (core 1, only writes tail). Whole messages go in or are
+ * dropped and counted, the USB side never waits on the emulator */
+#define EMU_MIDI_RING_SIZE  256  /* Power of two */
+#define EMU_MIDI_RING_MASK  (EMU_MIDI_RING_SIZE - 1)
+#define EMU_MIDI_QUEUE_SIZE 128
+static uint8_t emu_midi_ring[EMU_MIDI_RING_SIZE];
+volatile uint32_t emu_midi_head = 0;
+volatile uint32_t emu_midi_tail = 0;
+static volatile uint32_t emu_midi_overflows = 0;  /* Dropped messages */
 #endif /* ONBOARD_EMULATOR */
 
 
+/* USB-MIDI event packet Code Index Numbers */
+enum {
+  CIN_MISC         = 0x0,  /* Reserved */
+  CIN_CABLE_EVENT  = 0x1,  /* Reserved */
+  CIN_SYSCOM_2     = 0x2,  /* 2 byte System Common e.g. MTC, Song Select */
+  CIN_SYSCOM_3     = 0x3,  /* 3 byte System Common e.g. Song Position Pointer */
+  CIN_SYSEX        = 0x4,  /* SysEx starts or continues */
+  CIN_SYSEX_END_1  = 0x5,  /* SysEx ends with 1 byte or single byte System Common */
+  CIN_SYSEX_END_2  = 0x6,  /* SysEx ends with 2 bytes */
+  CIN_SYSEX_END_3  = 0x7,  /* SysEx ends with 3 bytes */
+  CIN_NOTE_OFF     = 0x8,
+  CIN_NOTE_ON      = 0x9,
+  CIN_POLY_KEYPRESS= 0xA,
+  CIN_CONTROL      = 0xB,
+  CIN_PROGRAM      = 0xC,
+  CIN_CHANNEL_PRESS= 0xD,
+  CIN_PITCHBEND    = 0xE,
+  CIN_1BYTE        = 0xF,  /* Single byte e.g. Real-Time */
+};
+
+
 /* MIDI state machine (declared extern in midi.h) */
 midi_machine midimachine;
 
@@ -63,16 +95,17 @@ void midi_init(void)
   /* Set initial stream state and index */
   midimachine.bus = FREE;
   midimachine.state = IDLE;
+  midimachine.type = NONE;
   midimachine.index = 0;
   midimachine.midi_bytes = 3;
   midimachine.last_status = 0;
 
   /* Clear stream buffers once */
   memset(midimachine.streambuffer, 0, sizeof midimachine.streambuffer);
-  memset(midimachine.usbstreambuffer, 0, sizeof midimachine.usbstreambuffer);
 
   /* Start the processor of midi buffers */
   midi_processor_init();
+  midi_sequencer_init();
 
   return;
 }
@@ -81,7 +114,9 @@ void midi_init(void)
 void emulator_queue_init(void)
 {
   /* emudore */
-  queue_init(&cynthcart_queue, sizeof(cynthcart_queue_entry_t), 128); /* 128 entries as buffer */
+  emu_midi_head = emu_midi_tail = 0;
+  emu_midi_overflows = 0;
+  queue_init(&cynthcart_queue, sizeof(cynthcart_queue_entry_t), EMU_MIDI_QUEUE_SIZE);
 }
 
 inline void emulator_queue_deinit(void)
@@ -92,15 +127,59 @@ inline void emulator_queue_deinit(void)
   reset_sid_registers();
 }
 
-inline void handle_emulater_data(void)
+static inline void handle_emulater_data(uint8_t *buffer, int size)
+{ /* Never blocks, a message that doesn't fit is dropped */
+  uint32_t head = emu_midi_head;
+  if __us_unlikely((uint32_t)size > (EMU_MIDI_RING_SIZE - (head - emu_midi_tail))) {
+    emu_midi_overflows++;
+    return;
+  }
+  for (int e = 0; e < size; e++) {
+    emu_midi_ring[((head + e) & EMU_MIDI_RING_MASK)] = buffer[e];
+  }
+  __dmb();  /* Data Memory Barrier - message bytes land before the new head */
+  emu_midi_head = (head + size);
+  return;
+}
+
+/**
+ * @brief Read a batch of MIDI bytes for the emulator
+ * @note core 1 only
+ *
+ * @param uint8_t *buffer, destination
+ * @param uint16_t size, max number of bytes to read
+ * @return uint16_t number of bytes read
+ */
+static uint16_t emulator_midi_read(uint8_t *buffer, uint16_t size)
+{
+  uint32_t tail = emu_midi_tail;
+  uint32_t n = (emu_midi_head - tail);
+  if (n == 0) return 0;
+  __dmb();  /* Data Memory Barrier - head read before the message bytes */
+  if (n > size) n = size;
+  for (uint32_t i = 0; i < n; i++) {
+    buffer[i] = emu_midi_ring[((tail + i) & EMU_MIDI_RING_MASK)];
+  }
+  __dmb();  /* Data Memory Barrier - bytes copied before the slots are released */
+  emu_midi_tail = (tail + n);
+  return (uint16_t)n;
+}
+
+/**
+ * @brief Move one batch from the ring into the receive queue of the emulated MIDI cart
+ * @note core 1 only, called once per emulator run loop iteration
+ */
+void emulator_midi_pump(void)
 {
-  for (size_t e = 0; e < midimachine.index; e++) {
-    /* Create queue entry */
-    cynthcart_queue_entry_t cq_entry;
-    /* Add byte to queue */
-    cq_entry.data = midimachine.streambuffer[e];
-    /* Add to queue (blocking wait if queue is full) */
-    queue_add_blocking(&cynthcart_queue, &cq_entry);
+  if __us_likely(emu_midi_head == emu_midi_tail) return;
+  uint16_t space = (uint16_t)(EMU_MIDI_QUEUE_SIZE - queue_get_level(&cynthcart_queue));
+  if (space == 0) return;  /* Cart hasn't caught up yet, bytes wait in the ring */
+
+  uint8_t batch[EMU_MIDI_QUEUE_SIZE];
+  uint16_t n = emulator_midi_read(batch, space);
+  for (uint16_t i = 0; i < n; i++) {
+    cynthcart_queue_entry_t cq_entry = { .data = batch[i] };
+    queue_try_add(&cynthcart_queue, &cq_entry);
   }
   return;
 }
@@ -120,6 +199,9 @@ void emulator_disable(void)
   stopping_emulator = true;
   stop_cynthcart();
   offload_ledrunner = false;
+  if (emu_midi_overflows != 0) {
+    usMIDI("Emulator MIDI feed dropped %u messages\n", emu_midi_overflows);
+  }
   emulator_queue_deinit();
   return;
 }
@@ -130,19 +212,19 @@ inline void emulator_reset(void)
   return;
 }
 
-static const void handle_emulator_cc(void)
+static const void handle_emulator_cc(uint8_t *buffer)
 {
-  if (midimachine.streambuffer[1] == midi_ccvalues_defaults.CC_CEN) { /* control emulator enable 0x55 (85) */
+  if (buffer[1] == midi_ccvalues_defaults.CC_CEN) { /* control emulator enable 0x55 (85) */
     if (!emulator_running) {
       emulator_enable();
     }
   } else
-  if (midimachine.streambuffer[1] == midi_ccvalues_defaults.CC_CDI) { /* control emulator disable 0x56 (86) */
+  if (buffer[1] == midi_ccvalues_defaults.CC_CDI) { /* control emulator disable 0x56 (86) */
     if (emulator_running) {
       emulator_disable();
     }
   } else
-  if (midimachine.streambuffer[1] == midi_ccvalues_defaults.CC_CRE) { /* control emulator reset 0x57 (87) */
+  if (buffer[1] == midi_ccvalues_defaults.CC_CRE) { /* control emulator reset 0x57 (87) */
     if (emulator_running) {
       emulator_reset();
     }
@@ -151,14 +233,59 @@ static const void handle_emulator_cc(void)
 }
 #endif
 
-/* Not yet implemented SysEx call handlers */
-static void handle_midi_clock(void)   { /* count 0xF8 pulses; 24 = 1 quarter note */ }
-static void handle_midi_start(void)   { /* reset beat counter */ }
-static void handle_midi_continue(void){ /* resume beat counter */ }
-static void handle_midi_stop(void)    { /* pause beat counter */ }
+/* Real-Time clock handlers, drive the tempo tracker, arpeggiator & sequencer */
+static void handle_midi_clock(void)   { midi_sequencer_clock(); }     /* 24 pulses = 1 quarter note */
+static void handle_midi_start(void)   { midi_sequencer_start(); }
+static void handle_midi_continue(void){ midi_sequencer_continue(); }
+static void handle_midi_stop(void)    { midi_sequencer_stop(); }
+
+/* Handles a single byte Real-Time message */
+static inline void midi_realtime(uint8_t buffer)
+{
+  usMCMD("[RT] %02x\n",buffer);
+  dtype = sysex; /* Set data type to SysEx */
+  switch (buffer) {
+    case 0xF8: handle_midi_clock();    break; /* System Exclusive Timing clock */
+    case 0xF9: break;                         /* System Exclusive Undefined (Reserved) */
+    case 0xFA: handle_midi_start();    break; /* System Exclusive Start */
+    case 0xFB: handle_midi_continue(); break; /* System Exclusive Continue */
+    case 0xFC: handle_midi_stop();     break; /* System Exclusive Stop */
+    case 0xFD:                                /* System Exclusive Undefined (Reserved) */
+    case 0xFE: break;                         /* System Exclusive Active Sensing - reset watchdog if implemented */
+    case 0xFF: midi_processor_init(); midi_sequencer_init(); break; /* System Exclusive System Reset */
+    default:   break;
+  }
+  return;
+}
+
+/* Dispatches a complete 2 or 3 byte channel message */
+static inline void midi_dispatch(uint8_t *buffer, int size)
+{
+  dtype = midi; /* Set data type to midi */
+
+  /* Do something fancy now */
+  #ifdef ONBOARD_EMULATOR
+  if (((buffer[0] & 0xF0) == 0xB0) /* Control mode change */
+    && (buffer[1] >= midi_ccvalues_defaults.CC_CEN)
+    && (buffer[1] <= midi_ccvalues_defaults.CC_CRE)) {
+      handle_emulator_cc(buffer);
+  } else
+  if (emulator_running) { /* Cynthcart, yeah baby yeah! */
+    handle_emulater_data(buffer, size);
+  } else {
+  #endif
+    if (!midi_sequencer_capture(buffer, size)) {
+      process_midi(buffer, size);
+    }
+  #ifdef ONBOARD_EMULATOR
+  }
+  #endif
+  return;
+}
 
 /* Processes a 1 byte incoming midi buffer
- * Figures out if we're receiving midi or sysex */
+ * Figures out if we're receiving midi or sysex
+ * Used for byte streams without packet framing */
 static inline void midi_buffer_task(uint8_t buffer)
 {
   if (midimachine.index != 0) {
@@ -167,20 +294,7 @@ static inline void midi_buffer_task(uint8_t buffer)
 
   /* Real-Time messages: single byte, never touch running stream state */
   if __us_unlikely(buffer >= 0xF8) {
-    printf("[RT] %02x\n",buffer);
-    dtype = sysex; /* Set data type to SysEx */
-    midimachine.last_status = 0;  /* SysEx cancels running status */
-    switch (buffer) {
-      case 0xF8: handle_midi_clock();    break; /* System Exclusive Timing clock */
-      case 0xF9: break;                         /* System Exclusive Undefined (Reserved) */
-      case 0xFA: handle_midi_start();    break; /* System Exclusive Start */
-      case 0xFB: handle_midi_continue(); break; /* System Exclusive Continue */
-      case 0xFC: handle_midi_stop();     break; /* System Exclusive Stop */
-      case 0xFD:                                /* System Exclusive Undefined (Reserved) */
-      case 0xFE: break;                         /* System Exclusive Active Sensing - reset watchdog if implemented */
-      case 0xFF: midi_processor_init();  break; /* System Exclusive System Reset */
-      default:   break;
-    }
+    midi_realtime(buffer);
     return; /* return and do not fall into state machine below */
   }
 
@@ -203,9 +317,11 @@ static inline void midi_buffer_task(uint8_t buffer)
         midimachine.last_status = 0;  /* SysEx cancels running status */
         if (midimachine.bus == CLAIMED && midimachine.type == SYSEX) {
           dtype = sysex; /* Set data type to SysEx */
-          midimachine.streambuffer[midimachine.index] = buffer;
-          midimachine.index++;
-          process_sysex(midimachine.streambuffer, midimachine.index);
+          if (midimachine.state == RECEIVING && midimachine.index < count_of(midimachine.streambuffer)) {
+            midimachine.streambuffer[midimachine.index] = buffer;
+            midimachine.index++;
+            process_sysex(midimachine.streambuffer, midimachine.index);
+          }
           midimachine.bus = FREE;
           midimachine.type = NONE;
           midimachine.state = IDLE;
@@ -267,23 +383,7 @@ static inline void midi_buffer_task(uint8_t buffer)
           /* if (midimachine.streambuffer[0] >= 0x80 || midimachine.streambuffer[0] <= 0xEF) { */
             if (midimachine.index == midimachine.midi_bytes) {
               usMCMD("\n");
-              dtype = midi; /* Set data type to midi */
-
-              /* Do something fancy now */
-              #ifdef ONBOARD_EMULATOR
-              if (((midimachine.streambuffer[0] & 0xF0) == 0xB0) /* Control mode change */
-                && (midimachine.streambuffer[1] >= midi_ccvalues_defaults.CC_CEN)
-                && (midimachine.streambuffer[1] <= midi_ccvalues_defaults.CC_CRE)) {
-                  handle_emulator_cc();
-              } else
-              if (emulator_running) { /* Cynthcart, yeah baby yeah! */
-                handle_emulater_data();
-              } else {
-              #endif
-                process_midi(midimachine.streambuffer, midimachine.index);
-              #ifdef ONBOARD_EMULATOR
-              }
-              #endif
+              midi_dispatch(midimachine.streambuffer, midimachine.index);
 
               midimachine.index = 0;
               midimachine.state = IDLE;
@@ -299,7 +399,9 @@ static inline void midi_buffer_task(uint8_t buffer)
     } else if (midimachine.state == IDLE && midimachine.last_status != 0) {
       /* Running status: re-enter as if last_status arrived fresh */
       midi_buffer_task(midimachine.last_status);  /* synthetic status byte */
-      midi_buffer_task(buffer);                   /* then this data byte */
+      if (midimachine.state == RECEIVING) {       /* bus may be taken, drop the byte then */
+        midi_buffer_task(buffer);                 /* then this data byte */
+      }
       return;
     } else if (midimachine.state == WAITING_FOR_END) {
       /* Consuming SysEx messages, nothing else to do */
@@ -308,6 +410,96 @@ static inline void midi_buffer_task(uint8_t buffer)
   }
 }
 
+/* Appends a SysEx chunk of 1 to 3 bytes from an event packet
+ * and processes the message when the chunk ends it */
+static inline void sysex_packet(uint8_t *data, uint8_t n, bool end)
+{
+  dtype = sysex; /* Set data type to SysEx */
+  if (data[0] == 0xF0) {  /* System Exclusive Start */
+    midimachine.last_status = 0;  /* SysEx cancels running status */
+    midimachine.type = SYSEX;
+    midimachine.state = RECEIVING;
+    midimachine.index = 0;
+  }
+  if (midimachine.type != SYSEX) return;  /* No start received, drop */
+
+  if (midimachine.state == RECEIVING) {
+    if ((midimachine.index + n) <= count_of(midimachine.streambuffer)) {
+      memcpy(&midimachine.streambuffer[midimachine.index], data, n);
+      midimachine.index += n;
+    } else {
+      /* Buffer is full, receiving to much data too handle, wait for message to end */
+      midimachine.state = WAITING_FOR_END;
+      usMCMD("[EXCESS][IDX]%02d\n", midimachine.index);
+    }
+  }
+
+  if (end) {
+    if (midimachine.state == RECEIVING) {
+      process_sysex(midimachine.streambuffer, midimachine.index);
+    }
+    midimachine.index = 0;
+    midimachine.bus = FREE;
+    midimachine.type = NONE;
+    midimachine.state = IDLE;
+  }
+  return;
+}
+
+/* Processes a single 4 byte USB-MIDI event packet
+ * Byte 0 ~ cable number (high nibble) and Code Index Number (low nibble)
+ * Byte 1-3 ~ midi data, size is defined by the Code Index Number */
+void process_packet(uint8_t *packet)
+{
+  if __us_unlikely((packet[0] >> 4) != MIDI_CABLE) return;
+
+  uint8_t cin = (packet[0] & 0x0F);
+  switch (cin) {
+    case CIN_SYSEX:
+      sysex_packet(&packet[1], 3, false);
+      break;
+    case CIN_SYSEX_END_1:
+      if (packet[1] == 0xF7) {
+        sysex_packet(&packet[1], 1, true);
+      } else {  /* Single byte System Common e.g. Tune request */
+        dtype = sysex; /* Set data type to SysEx */
+      }
+      break;
+    case CIN_SYSEX_END_2:
+      sysex_packet(&packet[1], 2, true);
+      break;
+    case CIN_SYSEX_END_3:
+      sysex_packet(&packet[1], 3, true);
+      break;
+    case CIN_PROGRAM:
+    case CIN_CHANNEL_PRESS:
+      usMCMD("[M]$%02x $%02x\n", packet[1], packet[2]);
+      midi_dispatch(&packet[1], 2);
+      break;
+    case CIN_NOTE_OFF:
+    case CIN_NOTE_ON:
+    case CIN_POLY_KEYPRESS:
+    case CIN_CONTROL:
+    case CIN_PITCHBEND:
+      usMCMD("[M]$%02x $%02x $%02x\n", packet[1], packet[2], packet[3]);
+      midi_dispatch(&packet[1], 3);
+      break;
+    case CIN_1BYTE:
+      if (packet[1] >= 0xF8) midi_realtime(packet[1]);
+      break;
+    case CIN_SYSCOM_2:
+    case CIN_SYSCOM_3:
+      dtype = sysex; /* Set data type to SysEx */
+      break;
+    case CIN_MISC:
+    case CIN_CABLE_EVENT:
+    default:
+      break;
+  }
+  return;
+}
+
+/* Processes a flat midi byte stream e.g. from a serial port */
 void process_stream(uint8_t *buffer, size_t size)
 { /* ISSUE: Processing the stream byte by byte makes it more prone to latency */
   size_t n = 0;
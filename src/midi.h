@@ -78,7 +78,6 @@ typedef struct {
   int fmopl;
   int midi_bytes;
   uint8_t index;
-  uint8_t usbstreambuffer[64];  /* Normal speed max buffer size for TinyUSB */
   uint8_t streambuffer[64];     /* Normal speed max buffer size for TinyUSB */
   uint8_t last_status;          /* running status cache */
 } midi_machine;
@@ -96,7 +95,19 @@ extern const midi_ccvalues midi_ccvalues_defaults;
 
 /* Functions from midi.c */
 void midi_init(void);
+void process_packet(uint8_t *packet);
 void process_stream(uint8_t *buffer, size_t size);
+#ifdef ONBOARD_EMULATOR
+void emulator_midi_pump(void);
+
+/* Emulator MIDI ring indexes (defined in midi.c) */
+extern volatile uint32_t emu_midi_head, emu_midi_tail;
+/* MIDI bytes waiting for the emulator */
+static inline bool emulator_midi_pending(void)
+{
+  return (emu_midi_head != emu_midi_tail);
+}
+#endif /* ONBOARD_EMULATOR */
 
 
 #ifdef __cplusplus
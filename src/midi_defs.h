@@ -82,6 +82,24 @@ typedef struct midi_ccvalues {
   uint8_t CC_LVCE;  /* Link/Unlink voice */
   uint8_t CC_LSID;  /* Link/Unlink SID */
   uint8_t CC_VELM;  /* Velocity Mode */
+  /* Modulation */
+  uint8_t CC_VIBR;  /* Vibrato LFO rate */
+  uint8_t CC_VIBD;  /* Vibrato LFO depth */
+  uint8_t CC_PWMR;  /* Pulse width LFO rate */
+  uint8_t CC_PWMD;  /* Pulse width LFO depth */
+  uint8_t CC_FLTR;  /* Cutoff LFO rate */
+  uint8_t CC_FLTD;  /* Cutoff LFO depth */
+  uint8_t CC_MENA;  /* Modulation envelope attack */
+  uint8_t CC_MEND;  /* Modulation envelope decay */
+  uint8_t CC_MENV;  /* Modulation envelope amount on cutoff */
+  /* Arpeggiator & step sequencer */
+  uint8_t CC_ARP;   /* Arpeggiator on/off */
+  uint8_t CC_ARPM;  /* Arpeggiator mode */
+  uint8_t CC_ARPD;  /* Arpeggiator note division */
+  uint8_t CC_ARPO;  /* Arpeggiator octave range */
+  uint8_t CC_SEQR;  /* Step sequencer record */
+  uint8_t CC_SEQP;  /* Step sequencer play */
+  uint8_t CC_SEQD;  /* Step sequencer note division */
   /* Fixed CC values ~ Cynthcart related */
   uint8_t CC_CEN;   /* Enable  Cynthcart */
   uint8_t CC_CDI;   /* Disable Cynthcart */
@@ -143,6 +161,25 @@ typedef struct midi_ccvalues {
   .CC_LVCE =  0x28,  /*  40 ~ Link/Unlink voice */ \
   .CC_LSID =  0x38,  /*  56 ~ Link/Unlink SID */ \
   .CC_VELM =  0x48,  /*  72 ~ Velocity Mode */ \
+  /* Default values ~ Modulation */ \
+  .CC_VIBR =  0x4C,  /*  76 ~ Vibrato rate */ \
+  .CC_VIBD =  0x4D,  /*  77 ~ Vibrato depth */ \
+  .CC_PWMR =  0x4E,  /*  78 ~ Pulse width LFO rate */ \
+  .CC_PWMD =  0x4F,  /*  79 ~ Pulse width LFO depth */ \
+  .CC_FLTR =  0x50,  /*  80 ~ Cutoff LFO rate */ \
+  .CC_FLTD =  0x51,  /*  81 ~ Cutoff LFO depth */ \
+  .CC_MENA =  0x52,  /*  82 ~ Modulation envelope attack */ \
+  .CC_MEND =  0x53,  /*  83 ~ Modulation envelope decay */ \
+  .CC_MENV =  0x54,  /*  84 ~ Modulation envelope amount, 64 is none */ \
+  /* Default values ~ Arpeggiator & step sequencer, synced to MIDI clock */ \
+  /* Undefined CCs only, hosts send 88~95 (effects sends) on reset */ \
+  .CC_ARP  =  0x70,  /* 112 ~ Arpeggiator on the channel it is sent on */ \
+  .CC_ARPM =  0x71,  /* 113 ~ Arpeggiator mode: up, down, up/down, random */ \
+  .CC_ARPD =  0x72,  /* 114 ~ Arpeggiator division: 1/4, 1/8, 1/16, 1/32 */ \
+  .CC_ARPO =  0x73,  /* 115 ~ Arpeggiator octaves: 1 ~ 4 */ \
+  .CC_SEQR =  0x74,  /* 116 ~ Step sequencer record notes on this channel */ \
+  .CC_SEQP =  0x75,  /* 117 ~ Step sequencer play */ \
+  .CC_SEQD =  0x76,  /* 118 ~ Step sequencer division: 1/4, 1/8, 1/16, 1/32 */ \
   /* Cynthcart related _FIXED_ CC values */ \
   .CC_CEN  =  0x55,  /*  85 ~ Enable Cynthcart */ \
   .CC_CDI  =  0x56,  /*  86 ~ Disable Cynthcart */ \
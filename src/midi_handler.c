@@ -45,7 +45,7 @@
 #include <midi_handler.h>
 
 
-#define SELECTED_CH   (msid.channel[current_channel])
+#define SELECTED_CH   (*ch)
 #define ACTIVE_SID    (SELECTED_CH.active_sid)
 #define SELECTED_SID  (SELECTED_CH.sid[ACTIVE_SID])
 #define ACTIVE_VOICE  (SELECTED_SID.active_voice)
@@ -55,31 +55,42 @@
 
 
 /* Initialise variables */
+/* NOTE: All MIDI state below is owned by core 0, it is only touched from
+ * the USB MIDI callback and never from an interrupt or core 1, so none of
+ * it is volatile. The only data shared with core 1 is sid_memory, which is
+ * written through bus.c */
 typedef enum { AT_FILTER = 0, AT_VOLUME, AT_VIBRATO } AftertouchTarget;
+typedef enum {  /* Modulation settings per channel SID, CC value 0 ~ 127 */
+  MOD_VIB_RATE = 0, MOD_VIB_DEPTH,   /* LFO on frequency */
+  MOD_PWM_RATE, MOD_PWM_DEPTH,       /* LFO on pulse width */
+  MOD_FLT_RATE, MOD_FLT_DEPTH,       /* LFO on filter cutoff */
+  MOD_ENV_ATTACK, MOD_ENV_DECAY,     /* Envelope times in ticks */
+  MOD_ENV_AMOUNT,                    /* Envelope on filter cutoff, 64 is none */
+  MOD_PARAMS
+} ModParam;
 typedef struct Voice_m {
    uint8_t note_index;
-   int16_t keyno; /* int16 to prevent silent overflow */
-   bool poly_on;
 } Voice_m;
-typedef struct SID_m {
-  Voice_m v[3];
+typedef struct SID_m {  /* Hot fields first */
   uint8_t active_voice;
-  uint8_t previous_voice;
   bool polyfonic;
-  bool auto_gate; /* Set to true on midi processor init */
-  AftertouchTarget at_target;  /* Aftertouch target */
+  bool auto_gate;       /* Set to true on midi processor init */
   /* Polyfonic templates - kept in sync with CC changes */
   uint8_t tmpl_contr;   /* control register (waveform bits, excl. gate) */
   uint8_t tmpl_attdec;
   uint8_t tmpl_susrel;
   uint8_t tmpl_pwmlo;
   uint8_t tmpl_pwmhi;
+  Voice_m v[3];
+  uint8_t previous_voice;
+  uint8_t at_target;    /* AftertouchTarget */
+  uint8_t mod[MOD_PARAMS];
 } SID_m;
 typedef struct Instr_m {
   SID_m sid[4];
-  int keys_pressed;
   uint8_t active_sid;
   uint8_t previous_sid;
+  int16_t keys_pressed;
   bool velocity_mode;   /* false = no scaling (default) */
   bool copy_voice;
   bool copy_sid;
@@ -92,8 +103,104 @@ typedef struct Midi_m {
   bool poly_mode;
 } Midi_m;
 
-volatile static int current_channel = 0; /* NOTE: This will probably not work in the long run */
-volatile static Midi_m msid = {0};
+static uint8_t current_channel = 0;
+static Midi_m msid = {0};
+static Instr_m *ch = &msid.channel[0];  /* Channel of the message being processed */
+
+/* Polyfonic voice pool, spans the voices of all configured SIDs */
+#define POOL_VOICES (MAX_SIDS * MAX_VOICES)
+#define POOL_NONE   0xFF
+typedef struct PolyVoice_m {
+  uint8_t sid;         /* SID index, 0 ~ cfg.numsids - 1 */
+  uint8_t voice;       /* Voice on that SID, 0 ~ 2 */
+  uint8_t channel;     /* Owning midi channel */
+  uint8_t note_index;
+  uint8_t velocity;
+  uint8_t older;       /* Age ordered list of sounding voices */
+  uint8_t newer;
+} PolyVoice_m;
+typedef struct PolyPool_m {
+  PolyVoice_m slot[POOL_VOICES];
+  uint8_t free_fifo[POOL_VOICES];  /* Released voices, longest released first */
+  uint8_t free_head;
+  uint8_t free_count;
+  uint8_t oldest;      /* Sounding voice to steal first */
+  uint8_t newest;
+  uint8_t size;        /* Voices in the pool, cfg.numsids * MAX_VOICES */
+  uint8_t note_slot[MAX_CHANNELS][SCALE_MAX + 1];  /* Sounding slot per channel & note */
+} PolyPool_m;
+static PolyPool_m pool;
+
+/* Oscillator values for the active SID clock rate, PITCH_STEPS per semitone
+ * so note on is pitch_table[note * PITCH_STEPS] and bends add steps */
+#define PITCH_STEPS   32
+#define PITCH_NOTES   (SCALE_MAX + 1)
+#define PITCH_TOP     (SCALE_MAX * PITCH_STEPS)
+#define BEND_CENTRE   0x2000  /* 14 bit pitch bend centre */
+#define BEND_SHIFT    4       /* 8192 / (PITCH_MAX * PITCH_STEPS) */
+static uint16_t pitch_table[PITCH_NOTES * PITCH_STEPS];
+static uint32_t pitch_clock = 0;
+
+/* Register writes staged per MIDI event, submitted to the bus in one go */
+#define BURST_MAX     128     /* Fits a patch recall of four SIDs */
+#define BURST_SPACING 6       /* Cycles between writes, LDA 2 and STA 4 */
+typedef struct midi_burst_t {
+  uint8_t n;
+  uint16_t lead;        /* Cycles before the first write, used once */
+  uint8_t reg[BURST_MAX];
+  uint8_t val[BURST_MAX];
+} midi_burst_t;
+static midi_burst_t event = { .n = 0 };  /* Flushed at the end of process_midi */
+
+/* Modulation state per physical SID voice, stepped at raster rate */
+#define MOD_RELEASE_TICKS 100  /* Keep modulating ~2 seconds after note off */
+typedef struct ModVoice_m {
+  SID_m *src;          /* Channel SID the settings come from, NULL is idle */
+  int16_t pitch;       /* Unmodulated pitch table position */
+  uint16_t pwm;        /* Unmodulated pulse width */
+  uint16_t vib_phase;
+  uint16_t pwm_phase;
+  uint16_t env;        /* Envelope level 0 ~ 0xFFFF */
+  bool env_attack;
+  bool held;
+  uint8_t release;     /* Ticks left after note off */
+} ModVoice_m;
+typedef struct ModSID_m {
+  SID_m *src;          /* Settings of the last triggered voice */
+  uint8_t last_voice;  /* Voice whose envelope drives the cutoff */
+  uint16_t cutoff;     /* Unmodulated cutoff */
+  uint16_t flt_phase;
+} ModSID_m;
+static ModVoice_m mod_voice[MAX_SIDS][MAX_VOICES];
+static ModSID_m mod_sid[MAX_SIDS];
+static uint32_t mod_last_tick = 0;
+
+/* Patch bank in flash, one sector per program so a save never has to
+ * read back and rewrite its neighbours */
+#define MIDI_PATCH_MAGIC 0x50415443  /* "PATC" */
+#define MIDI_PATCH_OFFSET(p) (FLASH_MIDI_OFFSET + ((p) * FLASH_SECTOR_SIZE))
+typedef struct MidiPatchSID_m {
+  uint8_t regs[MAX_REGS];  /* Register template of this SID */
+  bool polyfonic;
+  bool auto_gate;
+  uint8_t tmpl_contr;
+  uint8_t tmpl_attdec;
+  uint8_t tmpl_susrel;
+  uint8_t tmpl_pwmlo;
+  uint8_t tmpl_pwmhi;
+  uint8_t at_target;
+  uint8_t mod[MOD_PARAMS];
+} MidiPatchSID_m;
+typedef struct MidiPatch_m {
+  uint32_t magic;          /* Erased flash reads 0xFFFFFFFF */
+  uint16_t size;           /* sizeof(MidiPatch_m), rejects patches from another layout */
+  bool velocity_mode;
+  MidiPatchSID_m sid[MAX_SIDS];
+} MidiPatch_m;
+typedef struct midi_patch_write_t {
+  uint32_t offset;
+  const uint8_t *data;
+} midi_patch_write_t;
 
 static midi_ccvalues CC;
 static void (*cc_func_ptr_array[128])(uint8_t a, uint8_t b);
@@ -103,17 +210,92 @@ static void (*cc_func_ptr_array[128])(uint8_t a, uint8_t b);
 static void all_notes_off(uint8_t cc, uint8_t value);
 
 /* Internal helper functions */
-static void midi_bus_operation_(uint8_t a, uint8_t b)
+/**
+ * @brief Submit all staged registers to the bus as one burst
+ * @note returns as soon as the writes are queued in the bus fifos
+ *
+ * @param midi_burst_t *b, the burst to flush
+ */
+static void burst_flush(midi_burst_t *b)
 {
-  cycled_write_operation(a, b, 6);  /* 6 cycles constant for LDA 2 and STA 4 */
+  if (b->n == 0) return;
+  cycled_write_burst(b->reg, b->val, b->n, b->lead, BURST_SPACING);
+  b->n = 0;
+  b->lead = 0;
   return;
 }
-static void midi_bus_operation(uint8_t a, uint8_t b)
+
+/**
+ * @brief Stage a register write in a burst
+ * @note sid_memory is updated immediately
+ * @note a full burst is flushed first, order is preserved
+ *
+ * @param midi_burst_t *b, the burst to add to
+ * @param uint8_t reg, the absolute register address
+ * @param uint8_t val, the value to write
+ */
+static inline void burst_add(midi_burst_t *b, uint8_t reg, uint8_t val)
+{
+  if __us_unlikely(b->n == BURST_MAX) burst_flush(b);
+  sid_memory[reg] = val;
+  b->reg[b->n] = reg;
+  b->val[b->n] = val;
+  b->n++;
+  return;
+}
+
+/**
+ * @brief Stage the current sid_memory value of a register in the event burst
+ *
+ * @param uint8_t reg, the absolute register address
+ */
+static inline void event_write(uint8_t reg)
 {
-  cycled_write_operation(a, b, 0);  /* 0 cycles constant for fast writing */
+  burst_add(&event, reg, sid_memory[reg]);
   return;
 }
 
+/**
+ * @brief Stage a register write only if the value changes
+ */
+static inline void burst_change(midi_burst_t *b, uint8_t reg, uint8_t val)
+{
+  if (sid_memory[reg] != val) burst_add(b, reg, val);
+  return;
+}
+
+/**
+ * @brief Generate the pitch table for a SID clock rate
+ * @note index 0 is C0 at 16.35Hz, index 57 is A4 at 440Hz
+ * @note the oscillator value is Fout * 2^24 / clock
+ *
+ * @param uint32_t clock_rate, the SID clock in Hz
+ */
+void midi_pitch_init(uint32_t clock_rate)
+{
+  if (clock_rate == 0 || clock_rate == pitch_clock) return;
+  usNFO("[MIDI] Pitch table for %u Hz\n", clock_rate);
+  const double step = pow(2.0, 1.0 / (12 * PITCH_STEPS));
+  double fn = ((440.0 * pow(2.0, -57.0 / 12.0)) * 16777216.0 / clock_rate);
+  for (int i = 0; i < (PITCH_NOTES * PITCH_STEPS); i++) {
+    pitch_table[i] = (fn >= 65535.0 ? 0xFFFF : (uint16_t)(fn + 0.5));
+    fn *= step;
+  }
+  pitch_clock = clock_rate;
+  return;
+}
+
+/**
+ * @brief Oscillator value for a note on the active clock rate
+ *
+ * @param uint8_t note_index, 0 ~ SCALE_MAX
+ * @return uint16_t the frequency register value
+ */
+static inline uint16_t note_frequency(uint8_t note_index)
+{
+  return pitch_table[(note_index * PITCH_STEPS)];
+}
+
 /**
  * @brief Retrieve the base address of the active sid
  *
@@ -121,7 +303,7 @@ static void midi_bus_operation(uint8_t a, uint8_t b)
  */
 static uint8_t sidbase(void)
 {
-  return cfg.sidaddr[cfg.ids[msid.channel[current_channel].active_sid]];
+  return cfg.sidaddr[cfg.ids[ACTIVE_SID]];
 }
 
 /**
@@ -131,7 +313,7 @@ static uint8_t sidbase(void)
  */
 static uint8_t voicebase(void)
 {
-  return (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice*7);
+  return (ACTIVE_VOICE*7);
 }
 
 /**
@@ -212,11 +394,10 @@ static inline void set_nibble(uint8_t reg, uint8_t val, int nibble)
 static void copy_sid_to_sid(void)
 {
   uint8_t sid_base = sidbase();
-  uint8_t prev_sid_base = cfg.sidaddr[cfg.ids[msid.channel[current_channel].previous_sid]];
+  uint8_t prev_sid_base = cfg.sidaddr[cfg.ids[SELECTED_CH.previous_sid]];
   for (uint8_t i = MIN_VAL; i < MAX_REGS; i++) {
     uint8_t reg = (sid_base+i);
-    uint8_t val = sid_memory[(prev_sid_base+i)];
-    midi_bus_operation(reg,val);
+    burst_add(&event, reg, sid_memory[(prev_sid_base+i)]);
   }
   return;
 }
@@ -224,22 +405,21 @@ static void copy_sid_to_sid(void)
 static void copy_voice_to_voice(void)
 {
   uint8_t voice_base = (sidbase()+voicebase());
-  uint8_t prev_voice_base = (sidbase()+msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].previous_voice*7);
+  uint8_t prev_voice_base = (sidbase()+SELECTED_SID.previous_voice*7);
   for (uint8_t i = MIN_VAL; i < VOICE_REGS; i++) {
     uint8_t reg = (voice_base+i);
-    uint8_t val = sid_memory[(prev_voice_base+i)];
-    midi_bus_operation(reg,val);
+    burst_add(&event, reg, sid_memory[(prev_voice_base+i)]);
   }
   return;
 }
 
 static void copy_voice_poly(void)
 {
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].previous_voice = 0;
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = 1;
+  SELECTED_SID.previous_voice = 0;
+  ACTIVE_VOICE = 1;
   copy_voice_to_voice();
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].previous_voice = 1;
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = 2;
+  SELECTED_SID.previous_voice = 1;
+  ACTIVE_VOICE = 2;
   copy_voice_to_voice();
   return;
 }
@@ -247,143 +427,143 @@ static void copy_voice_poly(void)
 static void select_sid(uint8_t cc, uint8_t onoff)
 {
   (void)onoff;
-  msid.channel[current_channel].previous_sid = msid.channel[current_channel].active_sid;
+  SELECTED_CH.previous_sid = ACTIVE_SID;
   if (cc == CC.CC_SID1) {
-    msid.channel[current_channel].active_sid = 0;
+    ACTIVE_SID = 0;
   }
   if (cc == CC.CC_SID2) {
-    msid.channel[current_channel].active_sid = 1;
+    ACTIVE_SID = 1;
   }
   if (cc == CC.CC_SID3) {
-    msid.channel[current_channel].active_sid = 2;
+    ACTIVE_SID = 2;
   }
   if (cc == CC.CC_SID4) {
-    msid.channel[current_channel].active_sid = 3;
+    ACTIVE_SID = 3;
   }
-  if (msid.channel[current_channel].active_sid > cfg.numsids) {
-    msid.channel[current_channel].active_sid = cfg.numsids; /* Fallback to max sid */
+  if (ACTIVE_SID >= cfg.numsids) {
+    ACTIVE_SID = (cfg.numsids > 0 ? cfg.numsids - 1 : 0); /* Fallback to max sid */
   }
 
-  if (msid.channel[current_channel].copy_sid) {
+  if (SELECTED_CH.copy_sid) {
     copy_sid_to_sid();
-    msid.channel[current_channel].copy_sid = false;
+    SELECTED_CH.copy_sid = false;
   }
 
-  usMVCE("SID SELECT: %d [%d]\n", msid.channel[current_channel].active_sid, cc);
+  usMVCE("SID SELECT: %d [%d]\n", ACTIVE_SID, cc);
   return;
 }
 
 static void select_voice(uint8_t cc, uint8_t onoff)
 {
   (void)onoff;
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].previous_voice = msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice;
+  SELECTED_SID.previous_voice = ACTIVE_VOICE;
   if (cc == CC.CC_VCE1) {
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = 0;
+    ACTIVE_VOICE = 0;
   }
   else
   if (cc == CC.CC_VCE2) {
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = 1;
+    ACTIVE_VOICE = 1;
   }
   else
   if (cc == CC.CC_VCE3) {
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = 2;
+    ACTIVE_VOICE = 2;
   }
 
-  if (msid.channel[current_channel].copy_voice) {
+  if (SELECTED_CH.copy_voice) {
     copy_voice_to_voice();
-    msid.channel[current_channel].copy_voice = false;
+    SELECTED_CH.copy_voice = false;
   }
 
-  usMVCE("VOICE SELECT: %d [%d]\n", msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice, cc);
+  usMVCE("VOICE SELECT: %d [%d]\n", ACTIVE_VOICE, cc);
   return;
 }
 
 static void set_handler(uint8_t cc, uint8_t value)
 {
   if (cc == CC.CC_GTEN) {
-    usNFO("[CC_GTEN] SID%d From %d ", msid.channel[current_channel].active_sid, msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate);
+    usNFO("[CC_GTEN] SID%d From %d ", ACTIVE_SID, SELECTED_SID.auto_gate);
     if (value == 127) /* On */
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate = true;
+      SELECTED_SID.auto_gate = true;
     else if (value == 0) /* Off */
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate = false;
+      SELECTED_SID.auto_gate = false;
     else /* Toggle */
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate = !msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate;
-    usNFO("To %d\n", msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate);
+      SELECTED_SID.auto_gate = !SELECTED_SID.auto_gate;
+    usNFO("To %d\n", SELECTED_SID.auto_gate);
     return;
   }
   else
   if (cc == CC.CC_SPLY) {
-    usNFO("[CC_SPLY] From %d ", msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic);
+    usNFO("[CC_SPLY] From %d ", SELECTED_SID.polyfonic);
     if (value == 127) /* On */
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic = true;
+      SELECTED_SID.polyfonic = true;
     else if (value == 0) /* Off */
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic = false;
+      SELECTED_SID.polyfonic = false;
     else /* Toggle */
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic = !msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic;
-    usNFO("To %d\n", msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic);
-    if __us_unlikely (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic) {
+      SELECTED_SID.polyfonic = !SELECTED_SID.polyfonic;
+    usNFO("To %d\n", SELECTED_SID.polyfonic);
+    if __us_unlikely (SELECTED_SID.polyfonic) {
       copy_voice_poly();
     }
     return;
   }
   else
   if (cc == CC.CC_CVCE) {
-    usNFO("[CC_CVCE] From %d ", msid.channel[current_channel].copy_voice);
+    usNFO("[CC_CVCE] From %d ", SELECTED_CH.copy_voice);
     if (value == 127) /* On */
-      msid.channel[current_channel].copy_voice = true;
+      SELECTED_CH.copy_voice = true;
     else if (value == 0) /* Off */
-      msid.channel[current_channel].copy_voice = false;
+      SELECTED_CH.copy_voice = false;
     else /* Toggle */
-      msid.channel[current_channel].copy_voice = !msid.channel[current_channel].copy_voice;
-    usNFO("To %d\n", msid.channel[current_channel].copy_voice);
+      SELECTED_CH.copy_voice = !SELECTED_CH.copy_voice;
+    usNFO("To %d\n", SELECTED_CH.copy_voice);
     return;
   }
   else
   if (cc == CC.CC_CSID) {
-    usNFO("[CC_CSID] From %d ", msid.channel[current_channel].copy_sid);
+    usNFO("[CC_CSID] From %d ", SELECTED_CH.copy_sid);
     if (value == 127) /* On */
-      msid.channel[current_channel].copy_sid = true;
+      SELECTED_CH.copy_sid = true;
     else if (value == 0) /* Off */
-      msid.channel[current_channel].copy_sid = false;
+      SELECTED_CH.copy_sid = false;
     else /* Toggle */
-      msid.channel[current_channel].copy_sid = !msid.channel[current_channel].copy_sid;
-    usNFO("To %d\n", msid.channel[current_channel].copy_sid);
+      SELECTED_CH.copy_sid = !SELECTED_CH.copy_sid;
+    usNFO("To %d\n", SELECTED_CH.copy_sid);
     return;
   }
   else
   if (cc == CC.CC_LVCE) {
-    usNFO("[CC_LVCE] From %d ", msid.channel[current_channel].link_voice);
+    usNFO("[CC_LVCE] From %d ", SELECTED_CH.link_voice);
     if (value == 127) /* On */
-      msid.channel[current_channel].link_voice = true;
+      SELECTED_CH.link_voice = true;
     else if (value == 0) /* Off */
-      msid.channel[current_channel].link_voice = false;
+      SELECTED_CH.link_voice = false;
     else /* Toggle */
-      msid.channel[current_channel].link_voice = !msid.channel[current_channel].link_voice;
-    usNFO("To %d\n", msid.channel[current_channel].link_voice);
+      SELECTED_CH.link_voice = !SELECTED_CH.link_voice;
+    usNFO("To %d\n", SELECTED_CH.link_voice);
     return;
   }
   else
   if (cc == CC.CC_LSID) {
-    usNFO("[CC_LSID] From %d ", msid.channel[current_channel].link_sid);
+    usNFO("[CC_LSID] From %d ", SELECTED_CH.link_sid);
     if (value == 127) /* On */
-      msid.channel[current_channel].link_sid = true;
+      SELECTED_CH.link_sid = true;
     else if (value == 0) /* Off */
-      msid.channel[current_channel].link_sid = false;
+      SELECTED_CH.link_sid = false;
     else /* Toggle */
-      msid.channel[current_channel].link_sid = !msid.channel[current_channel].link_sid;
-    usNFO("To %d\n", msid.channel[current_channel].link_sid);
+      SELECTED_CH.link_sid = !SELECTED_CH.link_sid;
+    usNFO("To %d\n", SELECTED_CH.link_sid);
     return;
   }
   else
   if (cc == CC.CC_VELM) {
-    usNFO("[CC_VELM] From %d ", msid.channel[current_channel].velocity_mode);
+    usNFO("[CC_VELM] From %d ", SELECTED_CH.velocity_mode);
     if (value == 127) /* On */
-      msid.channel[current_channel].velocity_mode = true;
+      SELECTED_CH.velocity_mode = true;
     else if (value == 0) /* Off */
-      msid.channel[current_channel].velocity_mode = false;
+      SELECTED_CH.velocity_mode = false;
     else /* Toggle */
-      msid.channel[current_channel].velocity_mode = !msid.channel[current_channel].velocity_mode;
-    usNFO("To %d\n", msid.channel[current_channel].velocity_mode);
+      SELECTED_CH.velocity_mode = !SELECTED_CH.velocity_mode;
+    usNFO("To %d\n", SELECTED_CH.velocity_mode);
     return;
   }
   else
@@ -422,10 +602,9 @@ static void set_filtercutoff(uint8_t cc, uint8_t value)
   uint8_t Clo = (uint8_t)(cutoff & F_MASK_LO);
   uint8_t Chi = (uint8_t)((cutoff & F_MASK_HI) >> SHIFT_3);
 
-  sid_memory[(sidbase()+FC_HI)] = Chi;
-  midi_bus_operation((sidbase()+FC_HI),sid_memory[(sidbase()+FC_HI)]);
-  sid_memory[(sidbase()+FC_LO)] = Clo;
-  midi_bus_operation((sidbase()+FC_LO),sid_memory[(sidbase()+FC_LO)]);
+  burst_add(&event, (sidbase()+FC_HI), Chi);
+  burst_add(&event, (sidbase()+FC_LO), Clo);
+  mod_sid[ACTIVE_SID].cutoff = cutoff;  /* Modulation base */
 
   return;
 }
@@ -448,7 +627,7 @@ static void set_resfilter(uint8_t cc, uint8_t value)
   else if (cc == CC.CC_FLT3) {
     handle_bit(RESFLT,BIT_2,value);
   }
-  midi_bus_operation((sidbase()+RESFLT),sid_memory[(sidbase()+RESFLT)]);
+  event_write(sidbase()+RESFLT);
 
   return;
 }
@@ -472,7 +651,7 @@ static void set_modevolume(uint8_t cc, uint8_t value)
   else if (cc == CC.CC_LPF) {
     handle_bit(MODVOL,BIT_4,value);
   }
-  midi_bus_operation((sidbase()+MODVOL),sid_memory[(sidbase()+MODVOL)]);
+  event_write(sidbase()+MODVOL);
   /* usMVCE("MODVOL: %02x AFTER\n",sid_memory[(sidbase()+MODVOL)]); */
 
   return;
@@ -506,26 +685,21 @@ static void set_controlreg(uint8_t cc, uint8_t value)
     handle_bit((voicebase()+CONTR),BIT_0,value);
   }
 
-  midi_bus_operation((sidbase()+(voicebase()+CONTR)),sid_memory[(sidbase()+(voicebase()+CONTR))]);
+  event_write(sidbase()+(voicebase()+CONTR));
   usMVCE("(voicebase()+CONTR): %02x AFTER\n",sid_memory[(sidbase()+(voicebase()+CONTR))]);
 
-  if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic) {
+  SID_m *s = &SELECTED_SID;
+  if (s->polyfonic) {
+    uint8_t sid_base = sidbase();
     /* Preserve control register in template without gate bit */
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_contr =
-      sid_memory[(sidbase()+(voicebase()+CONTR))] & ~BIT_0;
+    s->tmpl_contr = sid_memory[(sid_base+(voicebase()+CONTR))] & ~BIT_0;
     /* Copy settings to other voices immediately */
-    uint8_t cur = msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice;
     for (uint8_t i = 0; i < MAX_VOICES; i++) {
-      if (i == cur) continue;
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = i;
+      if (i == s->active_voice) continue;
+      uint8_t reg = (sid_base+(i*VOICE_REGS)+CONTR);
       /* Preserve per-voice gate state */
-      uint8_t gate = sid_memory[(sidbase()+(voicebase()+CONTR))] & BIT_0;
-      sid_memory[(sidbase()+(voicebase()+CONTR))] =
-        (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_contr | gate);
-      midi_bus_operation((sidbase()+(voicebase()+CONTR)),
-                         sid_memory[(sidbase()+(voicebase()+CONTR))]);
+      burst_add(&event, reg, (s->tmpl_contr | (sid_memory[reg] & BIT_0)));
     }
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = cur;
   }
 }
 
@@ -535,28 +709,20 @@ static void set_adsr(uint8_t cc, uint8_t value)
   uint8_t mapped_val = MAP(value, MIN_VAL, MIDI_CC_MAX, MIN_VAL, NIBBLE_MAX);
   uint8_t reg = (((cc == CC.CC_ATT) || (cc == CC.CC_DEC)) ? ATTDEC : SUSREL);
   set_nibble((voicebase()+reg),mapped_val,nib);
-  midi_bus_operation((sidbase()+(voicebase()+reg)),sid_memory[(sidbase()+(voicebase()+reg))]);
+  event_write(sidbase()+(voicebase()+reg));
 
-  if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic) {
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_attdec =
-      sid_memory[(sidbase()+(voicebase()+ATTDEC))];
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_susrel =
-      sid_memory[(sidbase()+(voicebase()+SUSREL))];
+  SID_m *s = &SELECTED_SID;
+  if (s->polyfonic) {
+    uint8_t sid_base = sidbase();
+    s->tmpl_attdec = sid_memory[(sid_base+(voicebase()+ATTDEC))];
+    s->tmpl_susrel = sid_memory[(sid_base+(voicebase()+SUSREL))];
     /* Copy settings to other voices immediately */
-    uint8_t cur = msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice;
     for (uint8_t i = 0; i < MAX_VOICES; i++) {
-      if (i == cur) continue;
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = i;
-      sid_memory[(sidbase()+(voicebase()+ATTDEC))] =
-        msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_attdec;
-      sid_memory[(sidbase()+(voicebase()+SUSREL))] =
-        msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_susrel;
-      midi_bus_operation((sidbase()+(voicebase()+ATTDEC)),
-                         sid_memory[(sidbase()+(voicebase()+ATTDEC))]);
-      midi_bus_operation((sidbase()+(voicebase()+SUSREL)),
-                         sid_memory[(sidbase()+(voicebase()+SUSREL))]);
+      if (i == s->active_voice) continue;
+      uint8_t base = (sid_base+(i*VOICE_REGS));
+      burst_add(&event, (base+ATTDEC), s->tmpl_attdec);
+      burst_add(&event, (base+SUSREL), s->tmpl_susrel);
     }
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = cur;
   }
 
   return;
@@ -569,31 +735,23 @@ static void set_voicepwm(uint8_t cc, uint8_t value)
   uint8_t Phi  = (uint8_t)((pwm & NIBBLE_3) >> SHIFT_8);
   /* usNFO("[PWM] %04x %02x %02x\n", pwm, Phi, Plo); */
 
-  sid_memory[(sidbase()+(voicebase()+PWMLO))] = Plo;
-  midi_bus_operation((sidbase()+(voicebase()+PWMLO)),sid_memory[(sidbase()+(voicebase()+PWMLO))]);
-  sid_memory[(sidbase()+(voicebase()+PWMHI))] = Phi;
-  midi_bus_operation((sidbase()+(voicebase()+PWMHI)),sid_memory[(sidbase()+(voicebase()+PWMHI))]);
+  burst_add(&event, (sidbase()+(voicebase()+PWMLO)), Plo);
+  burst_add(&event, (sidbase()+(voicebase()+PWMHI)), Phi);
 
-  if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].polyfonic) {
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_pwmlo =
-      sid_memory[(sidbase()+(voicebase()+PWMLO))];
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_pwmhi =
-      sid_memory[(sidbase()+(voicebase()+PWMHI))];
+  SID_m *s = &SELECTED_SID;
+  mod_voice[ACTIVE_SID][s->active_voice].pwm = pwm;  /* Modulation base */
+  if (s->polyfonic) {
+    uint8_t sid_base = sidbase();
+    s->tmpl_pwmlo = Plo;
+    s->tmpl_pwmhi = Phi;
     /* Copy to other voices immediately */
-    uint8_t cur = msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice;
     for (uint8_t i = 0; i < MAX_VOICES; i++) {
-      if (i == cur) continue;
-      msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = i;
-      sid_memory[(sidbase()+(voicebase()+PWMLO))] =
-        msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_pwmlo;
-      sid_memory[(sidbase()+(voicebase()+PWMHI))] =
-        msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].tmpl_pwmhi;
-      midi_bus_operation((sidbase()+(voicebase()+PWMLO)),
-                         sid_memory[(sidbase()+(voicebase()+PWMLO))]);
-      midi_bus_operation((sidbase()+(voicebase()+PWMHI)),
-                         sid_memory[(sidbase()+(voicebase()+PWMHI))]);
+      if (i == s->active_voice) continue;
+      uint8_t base = (sid_base+(i*VOICE_REGS));
+      burst_add(&event, (base+PWMLO), Plo);
+      burst_add(&event, (base+PWMHI), Phi);
+      mod_voice[ACTIVE_SID][i].pwm = pwm;
     }
-    msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = cur;
   }
 
   return;
@@ -601,241 +759,418 @@ static void set_voicepwm(uint8_t cc, uint8_t value)
 
 static void set_notefrequency(uint8_t cc, uint8_t value)
 {
-  uint16_t frequency = MAP(value, MIN_VAL, MIDI_CC_MAX, musical_scale_values[MIN_VAL], musical_scale_values[SCALE_MAX]);
+  uint16_t frequency = MAP(value, MIN_VAL, MIDI_CC_MAX, note_frequency(MIN_VAL), note_frequency(SCALE_MAX));
   uint8_t Flo = (uint8_t)(frequency & VOICE_FREQLO);
-  uint8_t Fhi = (uint8_t)((frequency >> SHIFT_8) >= VOICE_FREQHI ? VOICE_FREQHI : (frequency >> SHIFT_8));
+  uint8_t Fhi = (uint8_t)(frequency >> SHIFT_8);
 
-  sid_memory[(sidbase()+(voicebase()+NOTEHI))] = Fhi;
-  midi_bus_operation((sidbase()+(voicebase()+NOTEHI)),sid_memory[(sidbase()+(voicebase()+NOTEHI))]);
-  sid_memory[(sidbase()+(voicebase()+NOTELO))] = Flo;
-  midi_bus_operation((sidbase()+(voicebase()+NOTELO)),sid_memory[(sidbase()+(voicebase()+NOTELO))]);
+  burst_add(&event, (sidbase()+(voicebase()+NOTEHI)), Fhi);
+  burst_add(&event, (sidbase()+(voicebase()+NOTELO)), Flo);
   return;
 }
 
 static void pitch_notefrequency(uint8_t lo, uint8_t hi)
 {
-  uint16_t pitch_raw = (uint16_t)((hi << SHIFT_8) | lo);  /* 0x0000..0x7F7F */
-
-  /* Derive base note index for current voice */
-  uint8_t base_index = msid.channel[current_channel]
-                        .sid[msid.channel[current_channel].active_sid]
-                        .v[msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice]
-                        .note_index;
-
-  /* Map 14-bit value to ±PITCH_MAX semitones (centre = MIDI_HALF = 0x3FC0) */
-  int16_t bend_semitones;
-  uint8_t frac;  /* 0..255 fractional semitone position */
-
-  if (pitch_raw <= (uint16_t)MIDI_HALF) {
-    uint16_t span = MIDI_HALF;
-    uint16_t delta = MIDI_HALF - pitch_raw;
-    bend_semitones = -(int16_t)((delta * PITCH_MAX) / span);
-    frac = (uint8_t)(255 - ((delta * 255) / span) % 256);
-  } else {
-    uint16_t span = MIDI_MAX - MIDI_HALF;
-    uint16_t delta = pitch_raw - MIDI_HALF;
-    bend_semitones = (int16_t)((delta * PITCH_MAX) / span);
-    frac = (uint8_t)(((delta * 255) / span) % 256);
+  /* 14 bit bend to ±PITCH_MAX semitones in pitch table steps */
+  int16_t bend = (int16_t)(((hi & 0x7F) << SHIFT_7) | (lo & 0x7F)) - BEND_CENTRE;
+  int16_t pos = (SELECTED_SID.v[ACTIVE_VOICE].note_index * PITCH_STEPS) + (bend >> BEND_SHIFT);
+  pos = (pos < 0 ? 0 : pos > PITCH_TOP ? PITCH_TOP : pos);
+  uint16_t frequency = pitch_table[pos];
+  mod_voice[ACTIVE_SID][ACTIVE_VOICE].pitch = pos;  /* Modulation base */
+
+  uint8_t Flo = (uint8_t)(frequency & VOICE_FREQLO);
+  uint8_t Fhi = (uint8_t)((frequency >> SHIFT_8) & 0xFF);
+
+  burst_add(&event, (sidbase()+(voicebase()+NOTEHI)), Fhi);
+  burst_add(&event, (sidbase()+(voicebase()+NOTELO)), Flo);
+  return;
+}
+
+/**
+ * @brief Start modulating a voice on note on
+ * @note call after the note registers are written
+ *
+ * @param uint8_t sid, SID index
+ * @param uint8_t voice, voice on that SID
+ * @param SID_m *src, the channel SID holding the modulation settings
+ * @param uint8_t note_index, the note played
+ */
+static void mod_note_on(uint8_t sid, uint8_t voice, SID_m *src, uint8_t note_index)
+{
+  uint8_t sid_base = cfg.sidaddr[cfg.ids[sid]];
+  uint8_t base = (sid_base + voice * VOICE_REGS);
+  ModVoice_m *mv = &mod_voice[sid][voice];
+  mv->src = src;
+  mv->pitch = (note_index * PITCH_STEPS);
+  mv->pwm = (((sid_memory[(base + PWMHI)] & NIBBLE_MAX) << SHIFT_8) | sid_memory[(base + PWMLO)]);
+  mv->env = 0;
+  mv->env_attack = true;
+  mv->held = true;
+  mv->release = 0;
+  ModSID_m *ms = &mod_sid[sid];
+  if (ms->src == NULL) {  /* Take the current cutoff as base */
+    ms->cutoff = ((sid_memory[(sid_base + FC_HI)] << SHIFT_3) | (sid_memory[(sid_base + FC_LO)] & F_MASK_LO));
   }
+  ms->src = src;
+  ms->last_voice = voice;
+  return;
+}
 
-  int16_t new_index = (int16_t)base_index + bend_semitones;
-  new_index = (new_index < 0 ? 0 : new_index >= SCALE_MAX ? SCALE_MAX - 1 : new_index);
+/**
+ * @brief Let a voice modulate through its release
+ *
+ * @param uint8_t sid, SID index
+ * @param uint8_t voice, voice on that SID
+ */
+static void mod_note_off(uint8_t sid, uint8_t voice)
+{
+  mod_voice[sid][voice].held = false;
+  mod_voice[sid][voice].release = MOD_RELEASE_TICKS;
+  return;
+}
 
-  /* Interpolate between adjacent scale entries */
-  uint32_t f_lo = musical_scale_values[new_index];
-  uint32_t f_hi = musical_scale_values[new_index + 1];
-  uint16_t frequency = (uint16_t)(f_lo + ((f_hi - f_lo) * frac) / 256);
+/**
+ * @brief LFO phase increment per tick, ~0.1Hz to ~12Hz at 50Hz
+ */
+static inline uint16_t lfo_rate(uint8_t value)
+{
+  return (128 + value * value);
+}
 
-  uint8_t Flo = (uint8_t)(frequency & VOICE_FREQLO);
-  uint8_t Fhi = (uint8_t)((frequency >> SHIFT_8) & 0xFF);
+/**
+ * @brief Triangle LFO
+ *
+ * @param uint16_t phase
+ * @return int32_t -32768 ~ 32766
+ */
+static inline int32_t lfo_triangle(uint16_t phase)
+{
+  return ((phase < 0x8000 ? (int32_t)phase : (int32_t)(0xFFFF - phase)) * 2) - 32768;
+}
 
-  sid_memory[(sidbase()+(voicebase()+NOTEHI))] = Fhi;
-  midi_bus_operation((sidbase()+(voicebase()+NOTEHI)),sid_memory[(sidbase()+(voicebase()+NOTEHI))]);
-  sid_memory[(sidbase()+(voicebase()+NOTELO))] = Flo;
-  midi_bus_operation((sidbase()+(voicebase()+NOTELO)),sid_memory[(sidbase()+(voicebase()+NOTELO))]);
+/**
+ * @brief Step the modulation of one voice and stage its register changes
+ *
+ * @param midi_burst_t *b, the burst of this SID
+ * @param ModVoice_m *mv, the voice
+ * @param uint8_t base, the voice base address
+ */
+static void mod_voice_tick(midi_burst_t *b, ModVoice_m *mv, uint8_t base)
+{
+  const uint8_t *mod = mv->src->mod;
+  if (mv->env_attack) {
+    uint32_t level = (mv->env + (0xFFFF / (mod[MOD_ENV_ATTACK] + 1)));
+    mv->env_attack = (level < 0xFFFF);
+    mv->env = (level < 0xFFFF ? level : 0xFFFF);
+  } else {
+    uint16_t step = (0xFFFF / (mod[MOD_ENV_DECAY] + 1));
+    mv->env = (mv->env > step ? (mv->env - step) : 0);
+  }
+  if (mod[MOD_VIB_DEPTH] != 0) {  /* Up to ±2 semitones */
+    mv->vib_phase += lfo_rate(mod[MOD_VIB_RATE]);
+    int32_t pos = (mv->pitch + ((lfo_triangle(mv->vib_phase) * mod[MOD_VIB_DEPTH]) >> 16));
+    uint16_t frequency = pitch_table[(pos < 0 ? 0 : pos > PITCH_TOP ? PITCH_TOP : pos)];
+    burst_change(b, (base + NOTEHI), (uint8_t)(frequency >> SHIFT_8));
+    burst_change(b, (base + NOTELO), (uint8_t)(frequency & VOICE_FREQLO));
+  }
+  if (mod[MOD_PWM_DEPTH] != 0) {  /* Up to ±half the pulse width range */
+    mv->pwm_phase += lfo_rate(mod[MOD_PWM_RATE]);
+    int32_t pwm = (mv->pwm + ((lfo_triangle(mv->pwm_phase) * mod[MOD_PWM_DEPTH]) >> 11));
+    pwm = (pwm < 0 ? 0 : pwm > TRIPLE_NIBBLE ? TRIPLE_NIBBLE : pwm);
+    burst_change(b, (base + PWMLO), (uint8_t)(pwm & BYTE));
+    burst_change(b, (base + PWMHI), (uint8_t)(pwm >> SHIFT_8));
+  }
+  return;
+}
+
+/**
+ * @brief Step the device side modulation once per raster frame
+ * @note writes one burst per SID, nothing is written while
+ * @note no voice has modulation settings or MIDI isn't the active input
+ */
+void midi_modulation_task(void)
+{
+  if (dtype != midi) return;  /* Other inputs own the registers */
+#if defined(ONBOARD_SIDPLAYER)
+  if (sidplayer_playing) return;
+#endif
+  /* raster_rate is in SID cycles */
+  uint32_t period_us = (uint32_t)(((uint64_t)usbsid_config.raster_rate * 1000000) / usbsid_config.clock_rate);
+  uint32_t now = time_us_32();
+  if ((now - mod_last_tick) < period_us) return;
+  mod_last_tick = now;
+
+  uint8_t numsids = (cfg.numsids > MAX_SIDS ? MAX_SIDS : cfg.numsids);
+  for (uint8_t sid = 0; sid < numsids; sid++) {
+    ModSID_m *ms = &mod_sid[sid];
+    if (ms->src == NULL) continue;  /* Nothing played on this SID */
+    uint8_t sid_base = cfg.sidaddr[cfg.ids[sid]];
+    midi_burst_t burst = { .n = 0 };
+    uint8_t active = 0;
+    for (uint8_t voice = 0; voice < MAX_VOICES; voice++) {
+      ModVoice_m *mv = &mod_voice[sid][voice];
+      if (mv->src == NULL) continue;
+      if (!mv->held && (--mv->release == 0)) {
+        mv->src = NULL;
+        continue;
+      }
+      mod_voice_tick(&burst, mv, (sid_base + voice * VOICE_REGS));
+      active++;
+    }
+    if (active == 0) {  /* Last voice released, leave the filter alone */
+      ms->src = NULL;
+      continue;
+    }
+    const uint8_t *mod = ms->src->mod;
+    if ((mod[MOD_FLT_DEPTH] != 0) || (mod[MOD_ENV_AMOUNT] != 64)) {
+      int32_t cutoff = ms->cutoff;
+      if (mod[MOD_FLT_DEPTH] != 0) {  /* Up to ±half the cutoff range */
+        ms->flt_phase += lfo_rate(mod[MOD_FLT_RATE]);
+        cutoff += ((lfo_triangle(ms->flt_phase) * mod[MOD_FLT_DEPTH]) >> 12);
+      }
+      cutoff += ((mod_voice[sid][ms->last_voice].env * (((int32_t)mod[MOD_ENV_AMOUNT] - 64) * 32)) >> 16);
+      cutoff = (cutoff < 0 ? 0 : cutoff > CUTOFF_MAX ? CUTOFF_MAX : cutoff);
+      burst_change(&burst, (sid_base + FC_LO), (uint8_t)(cutoff & F_MASK_LO));
+      burst_change(&burst, (sid_base + FC_HI), (uint8_t)((cutoff & F_MASK_HI) >> SHIFT_3));
+    }
+    burst_flush(&burst);
+  }
+  return;
+}
+
+static void set_modulation(uint8_t cc, uint8_t value)
+{
+  ModParam p;
+  if (cc == CC.CC_VIBR) p = MOD_VIB_RATE;
+  else if (cc == CC.CC_VIBD) p = MOD_VIB_DEPTH;
+  else if (cc == CC.CC_PWMR) p = MOD_PWM_RATE;
+  else if (cc == CC.CC_PWMD) p = MOD_PWM_DEPTH;
+  else if (cc == CC.CC_FLTR) p = MOD_FLT_RATE;
+  else if (cc == CC.CC_FLTD) p = MOD_FLT_DEPTH;
+  else if (cc == CC.CC_MENA) p = MOD_ENV_ATTACK;
+  else if (cc == CC.CC_MEND) p = MOD_ENV_DECAY;
+  else if (cc == CC.CC_MENV) p = MOD_ENV_AMOUNT;
+  else return;
+  SELECTED_SID.mod[p] = value;
+  usMVCE("MOD SID%d [%d] %d\n", ACTIVE_SID, p, value);
   return;
 }
 
 static void handle_velocity(uint8_t velocity)
 {
   if (velocity > 0) {
-    if (msid.channel[current_channel].velocity_mode) {
+    if (SELECTED_CH.velocity_mode) {
       /* High velocity = short decay (punchy); low velocity = long decay (soft) */
       uint8_t vel_dec = MAP(velocity, 1, 127, 14, 0); /* invert: high vel → low nibble (fast decay) */
       int nib = R_NIBBLE; /* preserve attack nibble */
       uint8_t reg = (voicebase() + ATTDEC);
       set_nibble(reg, vel_dec, nib);
-      midi_bus_operation((sidbase()+reg), sid_memory[(sidbase()+reg)]);
+      event_write(sidbase()+reg);
     } else {
       /* Velocity → volume */
       uint8_t vel_vol = MAP(velocity, 1, 127, 0, 15);
       set_nibble(MODVOL, vel_vol, L_NIBBLE);
-      midi_bus_operation((sidbase()+MODVOL), sid_memory[(sidbase()+MODVOL)]);
+      event_write(sidbase()+MODVOL);
     }
   }
 }
 
 static void handle_aftertouch(uint8_t pressure)
 {
-  AftertouchTarget t = msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].at_target;
+  AftertouchTarget t = SELECTED_SID.at_target;
   switch (t) {
     case AT_FILTER:  set_filtercutoff(CC.CC_FFC, pressure); break; /* expressive performance tool */
     case AT_VOLUME:  set_modevolume(CC.CC_VOL, pressure);   break; /* tremolo */
-    case AT_VIBRATO: /* future: set LFO depth */            break;
+    case AT_VIBRATO: SELECTED_SID.mod[MOD_VIB_DEPTH] = pressure; break; /* LFO depth */
   }
   return;
 }
 
-static uint8_t lowest_key_pressed(void)
+/**
+ * @brief (Re)build the polyfonic voice pool from the configured SIDs
+ * @note all pool voices are free afterwards, gates are left untouched
+ */
+static void poly_pool_build(void)
 {
-  int lowest = 255;
-  int key = 0;
-  for (int v = 0; v < 3; v++) {
-    if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[v].poly_on
-      && msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[v].keyno != 0
-      && msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[v].keyno < lowest) {
-      lowest = msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[v].keyno;
-      key = v;
-    }
+  uint8_t numsids = (cfg.numsids > MAX_SIDS ? MAX_SIDS : cfg.numsids);
+  pool.size = (numsids * MAX_VOICES);
+  pool.free_head = 0;
+  pool.free_count = pool.size;
+  pool.oldest = pool.newest = POOL_NONE;
+  for (uint8_t i = 0; i < pool.size; i++) {  /* SID by SID, a single SID behaves as before */
+    pool.slot[i].sid = (i / MAX_VOICES);
+    pool.slot[i].voice = (i % MAX_VOICES);
+    pool.slot[i].channel = 0;
+    pool.slot[i].note_index = 0;
+    pool.slot[i].velocity = 0;
+    pool.slot[i].older = pool.slot[i].newer = POOL_NONE;
+    pool.free_fifo[i] = i;
   }
-  if (lowest == 255) key = 0;
-  return key;
+  memset(pool.note_slot, POOL_NONE, sizeof(pool.note_slot));
+  return;
 }
 
-static uint8_t find_free_poly_voice(void) // TODO: If all taken, then lowest keyno must be used!!
+/**
+ * @brief Unlink a sounding voice from the age list
+ *
+ * @param uint8_t i, the pool slot
+ */
+static void poly_pool_unlink(uint8_t i)
 {
-  for (uint8_t i = MIN_VAL; i < MAX_VOICES; i++) {
-    if (!msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[i].poly_on) {
-      return i;
-    }
-  }
-  /* Else return lowest key pressed */
-  return lowest_key_pressed();
+  PolyVoice_m *pv = &pool.slot[i];
+  if (pv->older != POOL_NONE) pool.slot[pv->older].newer = pv->newer;
+  else pool.oldest = pv->newer;
+  if (pv->newer != POOL_NONE) pool.slot[pv->newer].older = pv->older;
+  else pool.newest = pv->older;
+  pv->older = pv->newer = POOL_NONE;
+  pool.note_slot[pv->channel][pv->note_index] = POOL_NONE;
+  return;
 }
 
-static uint8_t find_prev_poly_voice(uint8_t note_index)
+/**
+ * @brief Get a voice from the pool for a new note
+ * @note takes the longest released voice so recent releases can ring out,
+ * @note if none is free the oldest sounding voice is stolen unless the
+ * @note next oldest was played softer
+ *
+ * @return uint8_t the pool slot
+ */
+static uint8_t poly_pool_acquire(void)
 {
-  /* Match by note_index (primary, normally works) */
-  for (uint8_t i = MIN_VAL; i < MAX_VOICES; i++) {
-    if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[i].poly_on &&
-        msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[i].note_index == note_index) {
-        return i;
-    }
+  uint8_t i;
+  if (pool.free_count > 0) {
+    i = pool.free_fifo[pool.free_head];
+    pool.free_head = ((pool.free_head + 1) % POOL_VOICES);
+    pool.free_count--;
+    return i;
   }
-  /* Fallback: highest keyno among active voices (most recently pressed) */
-  int8_t max_keyno = -1;
-  uint8_t candidate = 0;
-  for (uint8_t i = 0; i < MAX_VOICES; i++) {
-    if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[i].poly_on &&
-        msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[i].keyno > max_keyno) {
-      max_keyno = msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[i].keyno;
-      candidate = i;
-    }
+  i = pool.oldest;
+  uint8_t next = pool.slot[i].newer;
+  if (next != POOL_NONE && pool.slot[next].velocity < pool.slot[i].velocity) {
+    i = next;
   }
-  return candidate;
+  usMVCE("[POLY] Steal SID%d voice %d note %d\n", pool.slot[i].sid, pool.slot[i].voice, pool.slot[i].note_index);
+  poly_pool_unlink(i);
+  return i;
+}
+
+/**
+ * @brief Return a released voice to the pool
+ *
+ * @param uint8_t i, the pool slot
+ */
+static void poly_pool_release(uint8_t i)
+{
+  poly_pool_unlink(i);
+  pool.free_fifo[((pool.free_head + pool.free_count) % POOL_VOICES)] = i;
+  pool.free_count++;
+  return;
 }
 
-// ISSUE: 4th key should replace the 1st key but mutes the 1st key
 static void note_on_poly(uint8_t note_index, uint8_t velocity)
 {
   SELECTED_CH.keys_pressed++;
-  handle_velocity(velocity);
 
-  /* Select target voice BEFORE writing anything */
-  ACTIVE_VOICE = find_free_poly_voice();
+  if __us_unlikely(pool.size != (cfg.numsids * MAX_VOICES)) poly_pool_build();  /* SID count changed */
+  if __us_unlikely(pool.size == 0) return;
+
+  /* Retrigger the same note on its own voice, else take one from the pool */
+  uint8_t i = pool.note_slot[current_channel][note_index];
+  if (i != POOL_NONE) poly_pool_unlink(i);
+  else i = poly_pool_acquire();
+
+  PolyVoice_m *pv = &pool.slot[i];
+  pv->channel = current_channel;
+  pv->note_index = note_index;
+  pv->velocity = velocity;
+  pv->older = pool.newest;
+  pv->newer = POOL_NONE;
+  if (pool.newest != POOL_NONE) pool.slot[pool.newest].newer = i;
+  else pool.oldest = i;
+  pool.newest = i;
+  pool.note_slot[current_channel][note_index] = i;
 
   /* Track note on this voice */
-  // msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice].note_index = note_index;
-  SELECTED_SID.v[ACTIVE_VOICE].note_index = note_index;
+  SELECTED_CH.sid[pv->sid].active_voice = pv->voice;
+  SELECTED_CH.sid[pv->sid].v[pv->voice].note_index = note_index;
 
-  /* Write frequency */
-  uint16_t frequency = musical_scale_values[note_index];
-  uint8_t Flo = (uint8_t)(frequency & VOICE_FREQLO);
-  uint8_t Fhi = (uint8_t)(frequency >> SHIFT_8);
-  sid_memory[SB+VB+NOTEHI] = Fhi; midi_bus_operation(SB+VB+NOTEHI, Fhi);
-  sid_memory[SB+VB+NOTELO] = Flo; midi_bus_operation(SB+VB+NOTELO, Flo);
-
-  /* Stamp current timbre template onto this voice */
-  volatile SID_m *s = &msid.channel[current_channel].sid[msid.channel[current_channel].active_sid];
-  sid_memory[(sidbase()+(voicebase()+CONTR))]  = s->tmpl_contr & ~BIT_0; /* gate off initially */
-  midi_bus_operation((sidbase()+(voicebase()+CONTR)), sid_memory[(sidbase()+(voicebase()+CONTR))]);
-  sid_memory[(sidbase()+(voicebase()+ATTDEC))] = s->tmpl_attdec;
-  midi_bus_operation((sidbase()+(voicebase()+ATTDEC)), sid_memory[(sidbase()+(voicebase()+ATTDEC))]);
-  sid_memory[(sidbase()+(voicebase()+SUSREL))] = s->tmpl_susrel;
-  midi_bus_operation((sidbase()+(voicebase()+SUSREL)), sid_memory[(sidbase()+(voicebase()+SUSREL))]);
-  sid_memory[(sidbase()+(voicebase()+PWMLO))]  = s->tmpl_pwmlo;
-  midi_bus_operation((sidbase()+(voicebase()+PWMLO)), sid_memory[(sidbase()+(voicebase()+PWMLO))]);
-  sid_memory[(sidbase()+(voicebase()+PWMHI))]  = s->tmpl_pwmhi;
-  midi_bus_operation((sidbase()+(voicebase()+PWMHI)), sid_memory[(sidbase()+(voicebase()+PWMHI))]);
-
-  if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate) {
-    set_bit((voicebase()+CONTR), BIT_0);
-    midi_bus_operation((sidbase()+(voicebase()+CONTR)), sid_memory[(sidbase()+(voicebase()+CONTR))]);
-  }
-
-  SELECTED_SID.v[ACTIVE_VOICE].poly_on = true;
-  SELECTED_SID.v[ACTIVE_VOICE].keyno   = SELECTED_CH.keys_pressed;
-  // msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice].poly_on = true;
-  // msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice].keyno   = msid.channel[current_channel].keys_pressed;
-  /* Do NOT advance active_voice here - next note_on calls find_free_poly_voice() */
+  /* Stamp frequency & the timbre template of the active SID onto this voice */
+  SID_m *s = &SELECTED_SID;
+  uint8_t sid_base = cfg.sidaddr[cfg.ids[pv->sid]];
+  uint8_t base = (sid_base + pv->voice * VOICE_REGS);
+  uint16_t frequency = note_frequency(note_index);
+  uint8_t attdec = s->tmpl_attdec;
+
+  if (velocity > 0) {
+    if (SELECTED_CH.velocity_mode) {
+      /* High velocity = short decay (punchy); low velocity = long decay (soft) */
+      attdec = ((attdec & L_NIBBLE) | MAP(velocity, 1, 127, 14, 0));
+    } else {
+      /* Velocity → volume of the SID this voice is on */
+      uint8_t vel_vol = MAP(velocity, 1, 127, 0, 15);
+      burst_add(&event, (sid_base + MODVOL), ((sid_memory[(sid_base + MODVOL)] & L_NIBBLE) | vel_vol));
+    }
+  }
+  burst_add(&event, (base + NOTEHI), (uint8_t)(frequency >> SHIFT_8));
+  burst_add(&event, (base + NOTELO), (uint8_t)(frequency & VOICE_FREQLO));
+  burst_add(&event, (base + CONTR), (s->tmpl_contr & ~BIT_0));  /* gate off initially */
+  burst_add(&event, (base + ATTDEC), attdec);
+  burst_add(&event, (base + SUSREL), s->tmpl_susrel);
+  burst_add(&event, (base + PWMLO), s->tmpl_pwmlo);
+  burst_add(&event, (base + PWMHI), s->tmpl_pwmhi);
+  if (SELECTED_CH.sid[pv->sid].auto_gate) {  /* Gate follows the SID the voice is on */
+    burst_add(&event, (base + CONTR), (s->tmpl_contr | BIT_0));
+  }
+  mod_note_on(pv->sid, pv->voice, s, note_index);
+  return;
 }
 
 static void note_off_poly(uint8_t note_index, uint8_t velocity)
 {
-  // (void)velocity;
-  // if (note_index > SCALE_MAX) note_index = SCALE_MAX; /* Clamp note_index to max if too high note requested */
-  if (msid.channel[current_channel].keys_pressed > 0) msid.channel[current_channel].keys_pressed--;
+  if (SELECTED_CH.keys_pressed > 0) SELECTED_CH.keys_pressed--;
   handle_velocity(velocity);
 
-  uint8_t v = find_prev_poly_voice(note_index);
+  uint8_t i = pool.note_slot[current_channel][note_index];
+  if (i == POOL_NONE) return;  /* Stolen or never played */
 
-  /* Gate off the specific voice without permanently changing active_voice */
-  uint8_t saved = msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice;
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = v;
-  if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate) {
-    unset_bit((voicebase()+CONTR), BIT_0);
-    midi_bus_operation((sidbase()+(voicebase()+CONTR)), sid_memory[(sidbase()+(voicebase()+CONTR))]);
+  /* Gate off the voice and free its slot */
+  PolyVoice_m *pv = &pool.slot[i];
+  if (SELECTED_CH.sid[pv->sid].auto_gate) {  /* Same SID as the gate on */
+    uint8_t contr = (cfg.sidaddr[cfg.ids[pv->sid]] + pv->voice * VOICE_REGS + CONTR);
+    burst_add(&event, contr, (sid_memory[contr] & ~BIT_0));
   }
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice = saved;
-
-  /* Free the voice slot */
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[v].poly_on    = false;
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[v].keyno       = -1;
-  msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[v].note_index  = 0;
-  /* active_voice is restored - next note_on will find a free slot */
+  mod_note_off(pv->sid, pv->voice);
+  poly_pool_release(i);
+  return;
 }
 
 static void note_on(uint8_t note_index, uint8_t velocity)
 {
   SELECTED_CH.keys_pressed++;
   handle_velocity(velocity);
-  /* usNFO("[KEYS] ON  %d\n",msid.channel[current_channel].keys_pressed); */
+  /* usNFO("[KEYS] ON  %d\n",SELECTED_CH.keys_pressed); */
 
   /* Write frequency */
   SELECTED_SID.v[ACTIVE_VOICE].note_index = note_index;
-  // msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].v[msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].active_voice].note_index = note_index;
-  uint16_t frequency = musical_scale_values[note_index]; // ISSUE: Possible issue here with indexes that are out of range!?
+  uint16_t frequency = note_frequency(note_index);
   uint8_t Flo = (frequency & VOICE_FREQLO);
   // uint8_t Fhi = ((frequency >> SHIFT_8) >= VOICE_FREQHI ? VOICE_FREQHI : (frequency >> SHIFT_8));
   uint8_t Fhi = (uint8_t)(frequency >> SHIFT_8);
-  // sid_memory[(sidbase()+(voicebase()+NOTEHI))] = Fhi;
-  // midi_bus_operation((sidbase()+(voicebase()+NOTEHI)),sid_memory[(sidbase()+(voicebase()+NOTEHI))]);
-  // sid_memory[(sidbase()+(voicebase()+NOTELO))] = Flo;
-  // midi_bus_operation((sidbase()+(voicebase()+NOTELO)),sid_memory[(sidbase()+(voicebase()+NOTELO))]);
-  sid_memory[SB+VB+NOTEHI] = Fhi; midi_bus_operation(SB+VB+NOTEHI, Fhi);
-  sid_memory[SB+VB+NOTELO] = Flo; midi_bus_operation(SB+VB+NOTELO, Flo);
+  uint8_t base = (SB+VB);
+  burst_add(&event, (base+NOTEHI), Fhi);
+  burst_add(&event, (base+NOTELO), Flo);
 
   /* Write voice settings before gate from memory to this voice */
-  midi_bus_operation((sidbase()+(voicebase()+CONTR)),  sid_memory[(sidbase()+(voicebase()+CONTR))]);
-  midi_bus_operation((sidbase()+(voicebase()+ATTDEC)), sid_memory[(sidbase()+(voicebase()+ATTDEC))]);
-  midi_bus_operation((sidbase()+(voicebase()+SUSREL)), sid_memory[(sidbase()+(voicebase()+SUSREL))]);
-  midi_bus_operation((sidbase()+(voicebase()+PWMLO)),  sid_memory[(sidbase()+(voicebase()+PWMLO))]);
-  midi_bus_operation((sidbase()+(voicebase()+PWMHI)),  sid_memory[(sidbase()+(voicebase()+PWMHI))]);
+  event_write(base+CONTR);
+  event_write(base+ATTDEC);
+  event_write(base+SUSREL);
+  event_write(base+PWMLO);
+  event_write(base+PWMHI);
 
-  if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate) {
+  if (SELECTED_SID.auto_gate) {  /* Gate goes last in the burst */
     set_bit((voicebase()+CONTR),BIT_0); /* Set get bit on */
-    midi_bus_operation((sidbase()+(voicebase()+CONTR)),sid_memory[(sidbase()+(voicebase()+CONTR))]);
+    event_write(base+CONTR);
   }
+  mod_note_on(ACTIVE_SID, ACTIVE_VOICE, &SELECTED_SID, note_index);
 
   return;
 }
@@ -845,14 +1180,15 @@ static void note_off(uint8_t note_index, uint8_t velocity)
   // (void)velocity; /* TODO: Implement into ADSR`? */
   // if (note_index > SCALE_MAX) note_index = SCALE_MAX; /* Clamp note_index to max if too high note requested */
 
-  if (msid.channel[current_channel].keys_pressed > 0) msid.channel[current_channel].keys_pressed--;
+  if (SELECTED_CH.keys_pressed > 0) SELECTED_CH.keys_pressed--;
   handle_velocity(velocity);
-  /* usNFO("[KEYS] OFF %d\n",msid.channel[current_channel].keys_pressed); */
+  /* usNFO("[KEYS] OFF %d\n",SELECTED_CH.keys_pressed); */
 
-  if (msid.channel[current_channel].sid[msid.channel[current_channel].active_sid].auto_gate) {// && (msid.channel[current_channel].keys_pressed == 0)) { /* NOTE: KEY_PRESSED wait till 0 breaks polyfonic */
+  if (SELECTED_SID.auto_gate) {// && (SELECTED_CH.keys_pressed == 0)) { /* NOTE: KEY_PRESSED wait till 0 breaks polyfonic */
     unset_bit((voicebase()+CONTR),BIT_0); /* Set get bit on */
-    midi_bus_operation((sidbase()+(voicebase()+CONTR)),sid_memory[(sidbase()+(voicebase()+CONTR))]);
+    event_write(sidbase()+(voicebase()+CONTR));
   }
+  mod_note_off(ACTIVE_SID, ACTIVE_VOICE);
 
   return;
 }
@@ -863,14 +1199,132 @@ static void all_notes_off(uint8_t cc, uint8_t value)
   for (uint8_t s = 0; s < 4; s++) {
     for (uint8_t v = 0; v < MAX_VOICES; v++) {
       /* clear gate */
-      msid.channel[current_channel].sid[s].v[v].poly_on = false;
-      msid.channel[current_channel].sid[s].v[v].keyno   = -1;
       uint8_t base = cfg.sidaddr[cfg.ids[s]] + v*7;
-      sid_memory[base + CONTR] &= ~BIT_0;
-      midi_bus_operation(base + CONTR, sid_memory[base + CONTR]);
+      burst_add(&event, (base + CONTR), (sid_memory[base + CONTR] & ~BIT_0));
+    }
+  }
+  SELECTED_CH.keys_pressed = 0;
+  poly_pool_build();
+  memset(mod_voice, 0, sizeof(mod_voice));
+  memset(mod_sid, 0, sizeof(mod_sid));
+}
+
+/**
+ * @brief Recall a patch from the flash bank onto a channel
+ * @note all registers of the configured SIDs go out in one burst,
+ *       gate bits of sounding voices are left as they are
+ *
+ * @param uint8_t channel, the MIDI channel 0 ~ 15
+ * @param uint8_t program, the patch number 0 ~ 127
+ * @return bool true if the patch was recalled, false if the slot is empty
+ */
+bool midi_patch_recall(uint8_t channel, uint8_t program)
+{
+  MidiPatch_m p;
+  memcpy(&p, (void *)(XIP_BASE + MIDI_PATCH_OFFSET(program % MIDI_PATCHES)), sizeof(MidiPatch_m));
+  if (p.magic != MIDI_PATCH_MAGIC || p.size != sizeof(MidiPatch_m)) {
+    usMIDI("[PATCH] %u is empty\n", program);
+    return false;
+  }
+
+  Instr_m *in = &msid.channel[channel & 0xF];
+  in->velocity_mode = p.velocity_mode;
+  for (uint8_t s = 0; s < MAX_SIDS; s++) {
+    const MidiPatchSID_m *ps = &p.sid[s];
+    SID_m *d = &in->sid[s];
+    d->polyfonic   = ps->polyfonic;
+    d->auto_gate   = ps->auto_gate;
+    d->tmpl_contr  = ps->tmpl_contr;
+    d->tmpl_attdec = ps->tmpl_attdec;
+    d->tmpl_susrel = ps->tmpl_susrel;
+    d->tmpl_pwmlo  = ps->tmpl_pwmlo;
+    d->tmpl_pwmhi  = ps->tmpl_pwmhi;
+    d->at_target   = ps->at_target;
+    memcpy(d->mod, ps->mod, MOD_PARAMS);
+    if (s >= cfg.numsids) continue;  /* Settings only, no SID to write to */
+
+    uint8_t sid_base = cfg.sidaddr[cfg.ids[s]];
+    for (uint8_t r = 0; r < MAX_REGS; r++) {
+      uint8_t val = ps->regs[r];
+      if ((r < (MAX_VOICES * VOICE_REGS)) && ((r % VOICE_REGS) == CONTR)) {
+        val = ((val & ~BIT_0) | (sid_memory[(sid_base + r)] & BIT_0));  /* Keep the gate */
+      }
+      burst_add(&event, (sid_base + r), val);
+    }
+    /* New modulation bases */
+    mod_sid[s].cutoff = ((ps->regs[FC_HI] << SHIFT_3) | (ps->regs[FC_LO] & F_MASK_LO));
+    for (uint8_t v = 0; v < MAX_VOICES; v++) {
+      uint8_t base = (v * VOICE_REGS);
+      mod_voice[s][v].pwm = (((ps->regs[(base + PWMHI)] & NIBBLE_MAX) << SHIFT_8) | ps->regs[(base + PWMLO)]);
+    }
+  }
+  burst_flush(&event);
+  usMIDI("[PATCH] %u recalled on channel %u\n", program, (channel & 0xF));
+
+  return true;
+}
+
+static void __no_inline_not_in_flash_func(write_patch_lowlevel)(void *param)
+{ /* No logging in this function to avoid errors */
+  const midi_patch_write_t *w = (const midi_patch_write_t *)param;
+  uint32_t ints = save_and_disable_interrupts();
+  flash_range_erase(w->offset, FLASH_SECTOR_SIZE);
+  flash_range_program(w->offset, w->data, FLASH_PAGE_SIZE);
+  restore_interrupts(ints);
+  return;
+}
+
+/**
+ * @brief Save the settings and SID registers of a channel to the flash bank
+ * @note erases and programs flash, never call this from the MIDI path
+ *
+ * @param uint8_t channel, the MIDI channel 0 ~ 15
+ * @param uint8_t program, the patch number 0 ~ 127
+ */
+void midi_patch_save(uint8_t channel, uint8_t program)
+{
+  static_assert(sizeof(MidiPatch_m) <= FLASH_PAGE_SIZE, "[MIDI] SAVE ERROR: MidiPatch_m doesn't fit inside FLASH_PAGE_SIZE");
+  union {
+    MidiPatch_m p;
+    uint8_t page[FLASH_PAGE_SIZE];
+  } buf;
+  memset(buf.page, 0xFF, FLASH_PAGE_SIZE);
+
+  const Instr_m *in = &msid.channel[channel & 0xF];
+  buf.p.magic = MIDI_PATCH_MAGIC;
+  buf.p.size = sizeof(MidiPatch_m);
+  buf.p.velocity_mode = in->velocity_mode;
+  for (uint8_t s = 0; s < MAX_SIDS; s++) {
+    MidiPatchSID_m *ps = &buf.p.sid[s];
+    const SID_m *src = &in->sid[s];
+    ps->polyfonic   = src->polyfonic;
+    ps->auto_gate   = src->auto_gate;
+    ps->tmpl_contr  = src->tmpl_contr;
+    ps->tmpl_attdec = src->tmpl_attdec;
+    ps->tmpl_susrel = src->tmpl_susrel;
+    ps->tmpl_pwmlo  = src->tmpl_pwmlo;
+    ps->tmpl_pwmhi  = src->tmpl_pwmhi;
+    ps->at_target   = src->at_target;
+    memcpy(ps->mod, src->mod, MOD_PARAMS);
+    if (s < cfg.numsids) {
+      memcpy(ps->regs, &sid_memory[cfg.sidaddr[cfg.ids[s]]], MAX_REGS);
+    } else {
+      memset(ps->regs, 0, MAX_REGS);  /* No SID configured */
     }
   }
-  msid.channel[current_channel].keys_pressed = 0;
+
+  midi_patch_write_t w = {
+    .offset = MIDI_PATCH_OFFSET(program % MIDI_PATCHES),
+    .data = buf.page,
+  };
+  int err = flash_safe_execute(write_patch_lowlevel, &w, 100);
+  if (err) {
+    usERR("Saving MIDI patch %u: %d\n", program, err);
+    return;
+  }
+  usMIDI("[PATCH] channel %u saved as %u\n", (channel & 0xF), program);
+
+  return;
 }
 
 static inline void assign_func_ptr(uint8_t cc, void* f_ptr)
@@ -935,6 +1389,17 @@ void midi_cc_init(void)
   assign_func_ptr(CC.CC_LPF, set_modevolume);
   assign_func_ptr(CC.CC_VOL, set_modevolume);
 
+  /* Modulation settings */
+  assign_func_ptr(CC.CC_VIBR, set_modulation);
+  assign_func_ptr(CC.CC_VIBD, set_modulation);
+  assign_func_ptr(CC.CC_PWMR, set_modulation);
+  assign_func_ptr(CC.CC_PWMD, set_modulation);
+  assign_func_ptr(CC.CC_FLTR, set_modulation);
+  assign_func_ptr(CC.CC_FLTD, set_modulation);
+  assign_func_ptr(CC.CC_MENA, set_modulation);
+  assign_func_ptr(CC.CC_MEND, set_modulation);
+  assign_func_ptr(CC.CC_MENV, set_modulation);
+
   /* Fixed Midi actions */
   assign_func_ptr(CC.CC_ASOF, all_notes_off);
   assign_func_ptr(CC.CC_RACT, all_notes_off);
@@ -969,9 +1434,9 @@ static void init_channel(int c)
     msid.channel[c].sid[s].tmpl_susrel    = sid_memory[(cfg.sidaddr[cfg.ids[s]] + 6)];
     msid.channel[c].sid[s].tmpl_pwmlo     = 0x00;
     msid.channel[c].sid[s].tmpl_pwmhi     = 0x00;
+    memset(msid.channel[c].sid[s].mod, 0, MOD_PARAMS);
+    msid.channel[c].sid[s].mod[MOD_ENV_AMOUNT] = 64;  /* No envelope on cutoff */
     for (int v = 0; v < MAX_VOICES; v++) {
-      msid.channel[c].sid[s].v[v].poly_on    = false;
-      msid.channel[c].sid[s].v[v].keyno      = -1;
       msid.channel[c].sid[s].v[v].note_index = 0;
     }
   }
@@ -992,6 +1457,8 @@ void midi_processor_init(void)
   for (int c = 0; c < MAX_CHANNELS; c++) {
     init_channel(c);
   }
+  poly_pool_build();
+  midi_pitch_init(usbsid_config.clock_rate);
   midi_cc_init();
 
   return;
@@ -1014,6 +1481,7 @@ void process_midi(uint8_t *buffer, int size)
   usMDAT("\n");
 
   current_channel = (buffer[0] & 0xF);
+  ch = &msid.channel[current_channel];
 
 
   int16_t ni = 0;
@@ -1044,7 +1512,8 @@ void process_midi(uint8_t *buffer, int size)
     case 0xE0 ... 0xEF:  /* Pitch Bend Change ~ 3-bytes */
       pitch_notefrequency(buffer[1],buffer[2]);
       break;
-    case 0xC0 ... 0xCF:  /* Program change */
+    case 0xC0 ... 0xCF:  /* Program change ~ 2-bytes, recall patch from flash */
+      midi_patch_recall(current_channel, buffer[1]);
       break;
     case 0xD0 ... 0xDF:  /* Pressure (Aftertouch) ~ 2-bytes, buffer[1]=note */
       handle_aftertouch(buffer[1]);
@@ -1055,6 +1524,24 @@ void process_midi(uint8_t *buffer, int size)
     default:
       break;
   }
+  burst_flush(&event);  /* All writes of this event in one burst */
 
   return;
 }
+
+/**
+ * @brief Process a channel message whose writes start after a delay
+ * @note the bus holds the first write for `lead` cycles, this lets
+ *       generated notes land on an exact cycle
+ *
+ * @param uint8_t *buffer, a complete channel message
+ * @param int size, the message size
+ * @param uint16_t lead, cycles before the first write
+ */
+void process_midi_timed(uint8_t *buffer, int size, uint16_t lead)
+{
+  event.lead = lead;
+  process_midi(buffer, size);
+  event.lead = 0;  /* Nothing was written */
+  return;
+}
@@ -34,7 +34,12 @@
 
 /* Functions from midi_handler.c */
 void midi_processor_init(void);
+void midi_pitch_init(uint32_t clock_rate);
+void midi_modulation_task(void);
 void process_midi(uint8_t *buffer, int size);
+void process_midi_timed(uint8_t *buffer, int size, uint16_t lead);
+bool midi_patch_recall(uint8_t channel, uint8_t program);
+void midi_patch_save(uint8_t channel, uint8_t program);
 
 
 #ifdef __cplusplus
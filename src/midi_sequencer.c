@@ -0,0 +1,494 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * midi_sequencer.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <globals.h>
+#include <usbsid.h>
+#include <config.h>
+#include <bus.h>
+#include <logging.h>
+#include <midi.h>
+#include <midi_defs.h>
+#include <midi_handler.h>
+#include <midi_sequencer.h>
+
+
+/* MIDI clock runs at 24 pulses per quarter note, the arpeggiator and step
+ * sequencer step on the 0xF8 pulses. Tick intervals are measured in SID
+ * clock cycles and every pulse pulls a predicted pulse phase 1/8 of the way
+ * towards its arrival, so host and USB jitter average out. Each pulse
+ * schedules the steps of the next one at its predicted cycle, note offs half
+ * a step later. The main loop hands events to the bus once they are less
+ * than SEQ_LOOKAHEAD cycles away, the bus holds the first write until the
+ * due cycle */
+#define CLOCKS_PER_QUARTER 24
+#define ARP_MAX_NOTES      16
+#define SEQ_MAX_STEPS      16
+#define SEQ_EVENTS         16
+#define SEQ_LOOKAHEAD      2000  /* ~2ms, must cover one main loop pass, max 65535 */
+
+typedef enum { ARP_UP = 0, ARP_DOWN, ARP_UPDOWN, ARP_RANDOM } ArpMode;
+
+/* Note divisions in clocks: 1/4, 1/8, 1/16, 1/32 */
+static const uint8_t divisions[4] = { 24, 12, 6, 3 };
+
+typedef struct Tempo_m {
+  uint32_t last_tick;   /* clockcycles() of the last 0xF8 */
+  uint32_t next;        /* Predicted clockcycles() of the next 0xF8 */
+  uint32_t interval;    /* Smoothed cycles per clock pulse, Q4 */
+  uint32_t ticks;       /* Clock pulses since start */
+  uint16_t bpm;         /* Smoothed tempo in 1/10 BPM */
+  bool running;
+  bool seen;            /* A previous pulse was timestamped */
+  bool locked;          /* Interval is measured */
+  bool ahead;           /* Steps of this pulse were scheduled by the previous one */
+} Tempo_m;
+
+typedef struct Arp_m {
+  bool enabled;
+  uint8_t channel;
+  uint8_t mode;         /* ArpMode */
+  uint8_t division;     /* Clocks per step */
+  uint8_t octaves;
+  uint8_t count;        /* Held notes, sorted low to high */
+  uint8_t note[ARP_MAX_NOTES];
+  uint8_t velocity[ARP_MAX_NOTES];
+  uint8_t position;
+  int8_t direction;
+} Arp_m;
+
+typedef struct Seq_m {
+  bool recording;
+  bool playing;
+  uint8_t channel;
+  uint8_t division;     /* Clocks per step */
+  uint8_t length;
+  uint8_t note[SEQ_MAX_STEPS];
+  uint8_t velocity[SEQ_MAX_STEPS];
+  uint8_t position;
+} Seq_m;
+
+typedef struct SeqEvent_m {
+  uint32_t due;         /* clockcycles() to send at */
+  uint8_t msg[3];
+  bool used;
+} SeqEvent_m;
+
+static Tempo_m tempo;
+static Arp_m arp;
+static Seq_m seq;
+static SeqEvent_m events[SEQ_EVENTS];
+static uint8_t pending = 0;
+static uint32_t arp_random = 0x1234567;
+
+
+/**
+ * @brief Send a generated channel message straight to the MIDI processor
+ */
+static void seq_send(uint8_t status, uint8_t note, uint8_t velocity)
+{
+  uint8_t msg[3] = { status, note, velocity };
+  process_midi(msg, 3);
+  return;
+}
+
+/**
+ * @brief Schedule a channel message for a SID clock cycle
+ * @note sends immediately if no event slot is free
+ */
+static void seq_schedule(uint32_t due, uint8_t status, uint8_t note, uint8_t velocity)
+{
+  for (int i = 0; i < SEQ_EVENTS; i++) {
+    if (!events[i].used) {
+      events[i].due = due;
+      events[i].msg[0] = status;
+      events[i].msg[1] = note;
+      events[i].msg[2] = velocity;
+      events[i].used = true;
+      pending++;
+      return;
+    }
+  }
+  seq_send(status, note, velocity);
+  return;
+}
+
+/**
+ * @brief Send all scheduled note offs now
+ * @note scheduled note ons that did not play yet are dropped
+ */
+static void seq_flush(void)
+{
+  for (int i = 0; i < SEQ_EVENTS && pending > 0; i++) {
+    if (events[i].used) {
+      events[i].used = false;
+      pending--;
+      if ((events[i].msg[0] & 0xF0) == 0x80) process_midi(events[i].msg, 3);
+    }
+  }
+  return;
+}
+
+/**
+ * @brief Play a note at a cycle and release it after a gate time
+ * @note plays right away if the cycle is not predicted
+ */
+static void seq_note(uint32_t at, bool timed, uint8_t channel, uint8_t note, uint8_t velocity, uint32_t gate)
+{
+  if (timed) {
+    seq_schedule(at, (0x90 | channel), note, velocity);
+  } else {
+    seq_send((0x90 | channel), note, velocity);
+  }
+  seq_schedule((at + gate), (0x80 | channel), note, 0);
+  return;
+}
+
+/**
+ * @brief Cycles until half a step from now, used as gate length
+ */
+static uint32_t gate_cycles(uint8_t division)
+{
+  return (((tempo.interval >> 4) * division) >> 1);
+}
+
+/**
+ * @brief Play the next arpeggio note
+ *
+ * @param uint32_t at, clockcycles() the note starts at
+ * @param bool timed, at is a prediction that lies ahead
+ */
+static void arp_step(uint32_t at, bool timed)
+{
+  if (arp.count == 0) return;
+  uint8_t steps = (arp.count * arp.octaves);
+  uint8_t pos;
+  switch (arp.mode) {
+    case ARP_DOWN:
+      pos = (steps - 1 - (arp.position % steps));
+      arp.position++;
+      break;
+    case ARP_UPDOWN:
+      if (arp.position >= steps) arp.position = (steps - 1);
+      pos = arp.position;
+      if (steps > 1) {
+        if ((arp.direction > 0 && pos == (steps - 1)) || (arp.direction < 0 && pos == 0)) {
+          arp.direction = -arp.direction;
+        }
+        arp.position += arp.direction;
+      }
+      break;
+    case ARP_RANDOM:
+      arp_random = (arp_random * 1103515245 + 12345);
+      pos = ((arp_random >> 16) % steps);
+      break;
+    case ARP_UP:
+    default:
+      pos = (arp.position % steps);
+      arp.position++;
+      break;
+  }
+  uint8_t idx = (pos % arp.count);
+  int note = (arp.note[idx] + (12 * (pos / arp.count)));
+  if (note > 127) note = arp.note[idx];
+  seq_note(at, timed, arp.channel, note, arp.velocity[idx], gate_cycles(arp.division));
+  return;
+}
+
+/**
+ * @brief Play the next recorded step
+ *
+ * @param uint32_t at, clockcycles() the note starts at
+ * @param bool timed, at is a prediction that lies ahead
+ */
+static void seq_step(uint32_t at, bool timed)
+{
+  if (seq.length == 0) return;
+  if (seq.position >= seq.length) seq.position = 0;
+  seq_note(at, timed, seq.channel, seq.note[seq.position], seq.velocity[seq.position], gate_cycles(seq.division));
+  seq.position++;
+  return;
+}
+
+/**
+ * @brief Run the steps that fall on a clock pulse
+ */
+static void clock_steps(uint32_t tick, uint32_t at, bool timed)
+{
+  if (arp.enabled && (tick % arp.division) == 0) arp_step(at, timed);
+  if (seq.playing && (tick % seq.division) == 0) seq_step(at, timed);
+  return;
+}
+
+/**
+ * @brief Handle a MIDI clock pulse, measures the tempo and steps
+ * @note called for every 0xF8 Real-Time message
+ */
+void midi_sequencer_clock(void)
+{
+  uint32_t now = clockcycles();
+  uint32_t delta = (now - tempo.last_tick);
+  tempo.last_tick = now;
+  if (!tempo.seen) {
+    tempo.seen = true;
+  } else if (!tempo.locked) {
+    if (delta < (1u << 27)) {  /* Fits Q4, ~2 minutes per pulse */
+      tempo.interval = (delta << 4);
+      tempo.locked = true;
+    }
+  } else if (delta < ((tempo.interval >> 4) * 4)) {  /* Ignore gaps, e.g. after a pause */
+    tempo.interval += ((int32_t)((delta << 4) - tempo.interval) >> 3);
+  }
+  if (tempo.locked && tempo.interval != 0) {
+    tempo.bpm = (uint16_t)((600ull * usbsid_config.clock_rate * 16) / ((uint64_t)CLOCKS_PER_QUARTER * tempo.interval));
+  }
+
+  /* Phase of this pulse, the prediction pulled towards the arrival.
+   * A pulse further off than a whole interval resyncs, e.g. after a pause */
+  uint32_t at = now;
+  if (tempo.locked) {
+    int32_t period = (int32_t)(tempo.interval >> 4);
+    int32_t error = (int32_t)(now - tempo.next);
+    if (error > -period && error < period) at = (tempo.next + (error / 8));
+    tempo.next = (at + period);
+  }
+  if (!tempo.running) {
+    tempo.ticks++;
+    return;
+  }
+
+  if (!tempo.ahead) clock_steps(tempo.ticks, now, false);  /* Nothing scheduled this pulse */
+  tempo.ahead = tempo.locked;
+  if (tempo.ahead) clock_steps((tempo.ticks + 1), tempo.next, true);
+  tempo.ticks++;
+  return;
+}
+
+/**
+ * @brief Handle 0xFA, restart from the first step
+ */
+void midi_sequencer_start(void)
+{
+  usMIDI("Clock start\n");
+  seq_flush();  /* Release what is sounding */
+  tempo.ticks = 0;
+  tempo.running = true;
+  tempo.ahead = false;
+  arp.position = 0;
+  arp.direction = 1;
+  seq.position = 0;
+  return;
+}
+
+/**
+ * @brief Handle 0xFB, resume at the current position
+ */
+void midi_sequencer_continue(void)
+{
+  usMIDI("Clock continue\n");
+  tempo.running = true;
+  tempo.ahead = false;  /* Stop dropped what was scheduled */
+  return;
+}
+
+/**
+ * @brief Handle 0xFC, pause and release the sounding notes
+ */
+void midi_sequencer_stop(void)
+{
+  usMIDI("Clock stop at %u.%u BPM\n", (tempo.bpm / 10), (tempo.bpm % 10));
+  tempo.running = false;
+  tempo.ahead = false;
+  seq_flush();  /* Release what is sounding */
+  return;
+}
+
+/**
+ * @brief Hand scheduled events to the bus as their cycle comes near
+ * @note runs from the core 0 main loop
+ * @note events go out in due order, each one waits on the bus
+ *       for the cycles between its due and the one before it
+ *       the writes of an event itself are not accounted for
+ */
+void midi_sequencer_task(void)
+{
+  if __us_likely(pending == 0) return;
+  uint32_t now = clockcycles();
+  uint32_t bus_at = now;  /* Cycle the bus reaches with the queued leads */
+  while (pending > 0) {
+    int next = -1;
+    for (int i = 0; i < SEQ_EVENTS; i++) {
+      if (events[i].used && (next < 0 || (int32_t)(events[i].due - events[next].due) < 0)) next = i;
+    }
+    if ((int32_t)(events[next].due - now) > SEQ_LOOKAHEAD) break;  /* Not yet */
+    int32_t lead = (int32_t)(events[next].due - bus_at);
+    if (lead < 0) lead = 0;  /* Late, play now */
+    bus_at += lead;
+    events[next].used = false;
+    pending--;
+    process_midi_timed(events[next].msg, 3, (uint16_t)lead);
+  }
+  return;
+}
+
+static void arp_hold(uint8_t note, uint8_t velocity)
+{
+  for (uint8_t i = 0; i < arp.count; i++) {
+    if (arp.note[i] == note) {  /* Already held */
+      arp.velocity[i] = velocity;
+      return;
+    }
+  }
+  if (arp.count >= ARP_MAX_NOTES) return;
+  uint8_t i = arp.count;
+  while (i > 0 && arp.note[i - 1] > note) {  /* Keep sorted */
+    arp.note[i] = arp.note[i - 1];
+    arp.velocity[i] = arp.velocity[i - 1];
+    i--;
+  }
+  arp.note[i] = note;
+  arp.velocity[i] = velocity;
+  arp.count++;
+  return;
+}
+
+static bool arp_release(uint8_t note)
+{
+  for (uint8_t i = 0; i < arp.count; i++) {
+    if (arp.note[i] == note) {
+      for (; i < (arp.count - 1); i++) {
+        arp.note[i] = arp.note[i + 1];
+        arp.velocity[i] = arp.velocity[i + 1];
+      }
+      arp.count--;
+      return true;
+    }
+  }
+  return false;  /* Held before the arpeggiator, not ours */
+}
+
+/**
+ * @brief Apply a CC value in the 127 on, 0 off, else toggle convention
+ */
+static inline bool cc_switch(bool state, uint8_t value)
+{
+  return (value == 127 ? true : value == 0 ? false : !state);
+}
+
+static bool handle_sequencer_cc(uint8_t channel, uint8_t cc, uint8_t value)
+{
+  if (cc == midi_ccvalues_defaults.CC_ARP) {
+    arp.enabled = cc_switch(arp.enabled, value);
+    arp.channel = channel;
+    arp.count = 0;
+    arp.position = 0;
+    arp.direction = 1;
+    seq_flush();  /* Release what is sounding */
+    usMIDI("Arpeggiator %s on channel %d\n", (arp.enabled ? "on" : "off"), channel);
+  } else
+  if (cc == midi_ccvalues_defaults.CC_ARPM) {
+    arp.mode = (value >> 5);
+  } else
+  if (cc == midi_ccvalues_defaults.CC_ARPD) {
+    arp.division = divisions[(value >> 5)];
+  } else
+  if (cc == midi_ccvalues_defaults.CC_ARPO) {
+    arp.octaves = (1 + (value >> 5));
+  } else
+  if (cc == midi_ccvalues_defaults.CC_SEQR) {
+    seq.recording = cc_switch(seq.recording, value);
+    if (seq.recording) {  /* Start a new pattern */
+      seq.playing = false;
+      seq.channel = channel;
+      seq.length = 0;
+      seq.position = 0;
+    }
+    usMIDI("Sequencer record %s, %d steps\n", (seq.recording ? "on" : "off"), seq.length);
+  } else
+  if (cc == midi_ccvalues_defaults.CC_SEQP) {
+    seq.playing = cc_switch(seq.playing, value);
+    if (seq.playing) seq.recording = false;
+    seq.position = 0;
+    seq_flush();  /* Release what is sounding */
+  } else
+  if (cc == midi_ccvalues_defaults.CC_SEQD) {
+    seq.division = divisions[(value >> 5)];
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Take the messages meant for the arpeggiator or sequencer
+ *
+ * @param uint8_t *buffer, a complete channel message
+ * @param int size, the message size
+ * @return true if the message is consumed
+ */
+bool midi_sequencer_capture(uint8_t *buffer, int size)
+{
+  if (size < 3) return false;
+  uint8_t status = (buffer[0] & 0xF0);
+  uint8_t channel = (buffer[0] & 0x0F);
+  if (status == 0x90 && buffer[2] == 0) status = 0x80;  /* Note on with velocity 0 */
+
+  switch (status) {
+    case 0xB0:
+      return handle_sequencer_cc(channel, buffer[1], buffer[2]);
+    case 0x90:
+      if (arp.enabled && channel == arp.channel) {
+        arp_hold(buffer[1], buffer[2]);
+        return true;
+      }
+      if (seq.recording && channel == seq.channel && seq.length < SEQ_MAX_STEPS) {
+        seq.note[seq.length] = buffer[1];
+        seq.velocity[seq.length] = buffer[2];
+        seq.length++;
+      }
+      return false;  /* Still play it while recording */
+    case 0x80:
+      if (arp.enabled && channel == arp.channel) {
+        return arp_release(buffer[1]);
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+void midi_sequencer_init(void)
+{
+  usMIDI("Sequencer init\n");
+  memset(&tempo, 0, sizeof(tempo));
+  memset(&arp, 0, sizeof(arp));
+  memset(&seq, 0, sizeof(seq));
+  memset(events, 0, sizeof(events));
+  pending = 0;
+  arp.division = divisions[2];  /* 1/16 */
+  arp.octaves = 1;
+  arp.direction = 1;
+  seq.division = divisions[2];
+  return;
+}
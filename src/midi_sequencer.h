@@ -0,0 +1,53 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * midi_sequencer.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _MIDI_SEQUENCER_H_
+#define _MIDI_SEQUENCER_H_
+#pragma once
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+/* Default includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* Functions from midi_sequencer.c */
+void     midi_sequencer_init(void);
+void     midi_sequencer_clock(void);
+void     midi_sequencer_start(void);
+void     midi_sequencer_continue(void);
+void     midi_sequencer_stop(void);
+bool     midi_sequencer_capture(uint8_t *buffer, int size);
+void     midi_sequencer_task(void);
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* _MIDI_SEQUENCER_H_ */
@@ -32,6 +32,7 @@
 #include <pio.h>
 #include <bus.h>
 #include <sid.h>
+#include <mcu.h>
 
 
 /* locals */
@@ -43,6 +44,7 @@ volatile uint sm_clock = 0, offset_clock = 0;     /* pio0 */
 volatile uint sm_delay = 0, offset_delay = 0;     /* pio0 */
 volatile uint sm_clkcnt = 0, offset_clkcnt = 0;   /* pio1 */
 volatile float sidclock_frequency = 0.0, busclock_frequency = 0.0;
+volatile uint32_t busclock_rate = 0;  /* C64 clock rate the bus dividers are set for */
 
 /* Shiny things */
 #if defined(PICO_DEFAULT_LED_PIN)
@@ -108,7 +110,8 @@ void setup_vu(void)
 void setup_piobus(void)
 {
   uint32_t pico_hz = clock_get_hz(clk_sys);
-  busclock_frequency = (float)pico_hz / (usbsid_config.clock_rate * 32) / 2;  /* Clock frequency is 8 times the SID clock */
+  busclock_frequency = ((float)mcu_clkdiv(pico_hz, (usbsid_config.clock_rate * 64)) / 256);  /* Clock frequency is 8 times the SID clock */
+  busclock_rate = usbsid_config.clock_rate;
 
   usNFO("\n");
   usDBG("BUS Clock initialisation\n");
@@ -234,8 +237,9 @@ void restart_bus_clocks(void)
   usNFO("\n");
   usDBG("Re-initialise clocks\n");
   uint32_t pico_hz = clock_get_hz(clk_sys);
-  busclock_frequency = (float)pico_hz / (usbsid_config.clock_rate * 32) / 2;  /* Clock frequency is 8 times the SID clock */
-  sidclock_frequency = (float)pico_hz / usbsid_config.clock_rate / 2;
+  busclock_frequency = ((float)mcu_clkdiv(pico_hz, (usbsid_config.clock_rate * 64)) / 256);  /* Clock frequency is 8 times the SID clock */
+  busclock_rate = usbsid_config.clock_rate;
+  sidclock_frequency = ((float)mcu_clkdiv(pico_hz, (usbsid_config.clock_rate * 2)) / 256);  /* Exact 16.8 value, see mcu_tune_sysclock */
   pio_sm_set_clkdiv(bus_pio, sm_clock, sidclock_frequency);
   pio_sm_set_clkdiv(bus_pio, sm_control, busclock_frequency);
   pio_sm_set_clkdiv(bus_pio, sm_data, busclock_frequency);
@@ -282,7 +286,7 @@ void stop_pios(void)
 void init_sidclock(void)
 {
   uint32_t pico_hz = clock_get_hz(clk_sys);
-  sidclock_frequency = (float)pico_hz / usbsid_config.clock_rate / 2;
+  sidclock_frequency = ((float)mcu_clkdiv(pico_hz, (usbsid_config.clock_rate * 2)) / 256);  /* Exact 16.8 value, see mcu_tune_sysclock */
 
   usNFO("\n");
   usDBG("SID Clock initialisation\n");
@@ -96,6 +96,7 @@ extern const PIO clkcnt_pio;
 extern volatile uint sm_control, sm_data, sm_clock, sm_delay, sm_clkcnt;
 extern volatile uint offset_control, offset_data, offset_clock, offset_delay, offset_clkcnt;
 extern volatile float sidclock_frequency, busclock_frequency;
+extern volatile uint32_t busclock_rate;
 
 /* LED PIO (non-WiFi boards only) */
 #if defined(PICO_DEFAULT_LED_PIN)
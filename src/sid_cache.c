@@ -0,0 +1,230 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sid_cache.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if defined(ONBOARD_SIDPLAYER)
+
+#include <globals.h>
+#include <usbsid.h>
+#include <config.h>
+#include <logging.h>
+#include <sid_cache.h>
+#include <arena.h>
+
+
+#define SIDCACHE_SECTORS  (FLASH_SIDCACHE_SIZE / FLASH_SECTOR_SIZE)
+#define SIDCACHE_SECTOR(n) (FLASH_SIDCACHE_OFFSET + ((n) * FLASH_SECTOR_SIZE))
+#define SIDCACHE_EMPTY    0xFFFFFFFF
+#define sid_cache_index   ((const SIDCacheEntry *)(XIP_BASE + SIDCACHE_SECTOR(0)))
+
+/* PSID/RSID header fields, big endian */
+#define PSID_SONGS        0x0E
+#define PSID_STARTSONG    0x10
+
+typedef struct {
+  uint32_t offset;
+  const uint8_t *data;
+  uint32_t len;  /* Multiple of FLASH_PAGE_SIZE, may be 0 */
+  bool erase;    /* Erase the sector at offset first */
+} sid_cache_write_t;
+
+
+static void __no_inline_not_in_flash_func(write_cache_lowlevel)(void *param)
+{ /* No logging in this function to avoid errors */
+  const sid_cache_write_t *w = (const sid_cache_write_t *)param;
+  uint32_t ints = save_and_disable_interrupts();
+  if (w->erase) flash_range_erase(w->offset, FLASH_SECTOR_SIZE);
+  if (w->len) flash_range_program(w->offset, w->data, w->len);
+  restore_interrupts(ints);
+  return;
+}
+
+static bool write_cache(uint32_t offset, const uint8_t *data, uint32_t len, bool erase)
+{
+  sid_cache_write_t w = { .offset = offset, .data = data, .len = len, .erase = erase };
+  int err = flash_safe_execute(write_cache_lowlevel, &w, 100);
+  if (err != PICO_OK) {
+    usERR("[CACHE] Flash write @ 0x%x failed: %d\n", offset, err);
+    return false;
+  }
+  return true;
+}
+
+static inline bool entry_valid(const SIDCacheEntry *e)
+{
+  return (e->crc != SIDCACHE_EMPTY || e->size != SIDCACHE_EMPTY);
+}
+
+static inline uint16_t entry_sectors(uint32_t size)
+{
+  return ((size + (FLASH_SECTOR_SIZE - 1)) / FLASH_SECTOR_SIZE);
+}
+
+/**
+ * @brief Find a tune in the cache
+ *
+ * @param uint32_t crc, CRC32 of the whole file
+ * @param uint32_t size
+ * @return uint8_t cache id or 0 if not cached
+ */
+uint8_t sid_cache_lookup(uint32_t crc, uint32_t size)
+{
+  for (uint8_t slot = 0; slot < SID_CACHE_ENTRIES; slot++) {
+    const SIDCacheEntry *e = &sid_cache_index[slot];
+    if (!entry_valid(e)) break;  /* Entries are appended, first empty slot ends the index */
+    if (e->crc == crc && e->size == size) return (slot + 1);
+  }
+  return 0;
+}
+
+/**
+ * @brief Erase the cache index, the data sectors are erased when reused
+ */
+void sid_cache_clear(void)
+{
+  usCFG("[CACHE] Clearing tune cache\n");
+  write_cache(SIDCACHE_SECTOR(0), NULL, 0, true);
+  return;
+}
+
+/**
+ * @brief Store a verified file image in the cache
+ * @note erases and programs flash, core 1 is locked out while writing
+ *
+ * @param const uint8_t *image, file image in RAM
+ * @param uint32_t size
+ * @param uint32_t crc, CRC32 of the whole file
+ * @param uint8_t filetype, SID_FILE or PRG_FILE
+ * @return uint8_t cache id or 0 if the tune wasn't stored
+ */
+uint8_t sid_cache_store(const uint8_t *image, uint32_t size, uint32_t crc, uint8_t filetype)
+{
+  uint8_t id = sid_cache_lookup(crc, size);
+  if (id != 0) return id;
+
+  uint16_t sectors = entry_sectors(size);
+  if (sectors > (SIDCACHE_SECTORS - 1)) return 0;
+
+  /* Next free slot and data sector */
+  uint8_t slot = 0;
+  uint16_t next = 1;
+  for (; slot < SID_CACHE_ENTRIES; slot++) {
+    const SIDCacheEntry *e = &sid_cache_index[slot];
+    if (!entry_valid(e)) break;
+    next = (e->sector + entry_sectors(e->size));
+  }
+  if (slot == SID_CACHE_ENTRIES || (next + sectors) > SIDCACHE_SECTORS) {
+    usCFG("[CACHE] Full, starting over\n");
+    sid_cache_clear();
+    slot = 0;
+    next = 1;
+  }
+
+  uint8_t page[FLASH_PAGE_SIZE];
+  for (uint16_t s = 0; s < sectors; s++) {
+    uint32_t pos = (s * FLASH_SECTOR_SIZE);
+    uint32_t len = (((size - pos) < FLASH_SECTOR_SIZE) ? (size - pos) : FLASH_SECTOR_SIZE);
+    uint32_t full = (len & ~(FLASH_PAGE_SIZE - 1));
+    uint32_t offset = SIDCACHE_SECTOR(next + s);
+    if (!write_cache(offset, &image[pos], full, true)) return 0;
+    if (len != full) {  /* Pad the last page */
+      memset(page, 0xFF, FLASH_PAGE_SIZE);
+      memcpy(page, &image[(pos + full)], (len - full));
+      if (!write_cache((offset + full), page, FLASH_PAGE_SIZE, false)) return 0;
+    }
+  }
+
+  /* Append the index entry last so an interrupted store leaves no entry */
+  SIDCacheEntry entry = {
+    .crc = crc, .size = size, .sector = next,
+    .songs = 1, .startsong = 1, .filetype = filetype,
+    .reserved = { 0xFF, 0xFF },
+  };
+  if (filetype != PRG_FILE) {
+    entry.songs = ((image[PSID_SONGS] << 8) | image[(PSID_SONGS + 1)]);
+    entry.startsong = image[(PSID_STARTSONG + 1)];
+  }
+  uint32_t at = (slot * sizeof(SIDCacheEntry));
+  uint32_t page_at = (at & ~(FLASH_PAGE_SIZE - 1));
+  memcpy(page, (const uint8_t *)sid_cache_index + page_at, FLASH_PAGE_SIZE);
+  memcpy(&page[(at - page_at)], &entry, sizeof(SIDCacheEntry));
+  if (!write_cache((SIDCACHE_SECTOR(0) + page_at), page, FLASH_PAGE_SIZE, false)) return 0;
+
+  usCFG("[CACHE] Stored %u bytes as id %u @ sector %u\n", size, (slot + 1), next);
+  return (slot + 1);
+}
+
+/**
+ * @brief Point the player at a cached tune, no copy to RAM
+ *
+ * @param uint8_t id, cache id
+ * @return bool false if the id is empty or the player is busy
+ */
+bool sid_cache_select(uint8_t id)
+{
+  if (id == 0 || id > SID_CACHE_ENTRIES) return false;
+  const SIDCacheEntry *e = &sid_cache_index[(id - 1)];
+  if (!entry_valid(e)) return false;
+
+  bool pending = sidplayer_init;
+  __dmb();  /* Core 1 sets sidfile_loading before it clears sidplayer_init */
+  if (pending || sidfile_loading) {  /* Core 1 still uses sidfile and the arena */
+    usERR("[CACHE] Player busy loading, id %u not selected\n", id);
+    return false;
+  }
+
+  if (sidfile != NULL && !sidfile_in_flash) arena_release(ARENA_SIDPLAYER);
+  sidfile = (uint8_t *)(XIP_BASE + SIDCACHE_SECTOR(e->sector));
+  sidfile_size = e->size;
+  is_prg = (e->filetype == PRG_FILE);
+  sidfile_in_flash = true;
+  usCFG("[CACHE] Selected id %u, %u bytes\n", id, e->size);
+  return true;
+}
+
+/**
+ * @brief Handle SID_CACHE_LOOKUP
+ *
+ * @param uint8_t *buffer, { CMD, SIZE(3), CRC32(4) }
+ */
+void sid_cache_request(uint8_t *buffer)
+{
+  uint32_t size = ((uint32_t)buffer[1] << 16 | (uint32_t)buffer[2] << 8 | buffer[3]);
+  uint32_t crc = ((uint32_t)buffer[4] << 24 | (uint32_t)buffer[5] << 16 | (uint32_t)buffer[6] << 8 | buffer[7]);
+  uint8_t id = sid_cache_lookup(crc, size);
+
+  memset(write_buffer_p, 0, 64);
+  write_buffer_p[0] = id;
+  if (id != 0) {
+    const SIDCacheEntry *e = &sid_cache_index[(id - 1)];
+    write_buffer_p[1] = (e->songs >> 8);
+    write_buffer_p[2] = (e->songs & 0xFF);
+    write_buffer_p[3] = e->startsong;
+  }
+  write_back_data(4);
+  return;
+}
+
+
+#endif /* ONBOARD_SIDPLAYER */
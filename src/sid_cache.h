@@ -0,0 +1,76 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sid_cache.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _USBSID_SID_CACHE_H_
+#define _USBSID_SID_CACHE_H_
+#pragma once
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+/* Default includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/* Flash tune cache
+ *
+ * Sector 0 of the cache area holds the index, the remaining sectors hold
+ * the tunes back to back, each starting on a sector boundary. Index entries
+ * are appended by programming erased flash, the data is written by whole
+ * sectors. When a tune doesn't fit anymore the cache starts over.
+ *
+ * Cache ids are slot + 1, id 0 is the file uploaded into RAM
+ *
+ * SID_CACHE_LOOKUP { CMD, SIZE(3), CRC32(4) } big endian
+ *   replies { ID, SONGS(2), STARTSONG }, ID 0 is a miss
+ */
+#define SID_CACHE_ENTRIES 63  /* One data sector minimum per tune */
+
+typedef struct __attribute__((packed)) SIDCacheEntry {
+  uint32_t crc;        /* CRC32 of the whole file, 0xFFFFFFFF is an empty slot */
+  uint32_t size;
+  uint16_t sector;     /* First data sector, relative to the cache area */
+  uint16_t songs;      /* From the PSID header, 1 for PRG */
+  uint8_t  startsong;
+  uint8_t  filetype;
+  uint8_t  reserved[2];
+} SIDCacheEntry;
+
+/* Functions from sid_cache.c */
+uint8_t sid_cache_lookup(uint32_t crc, uint32_t size);
+uint8_t sid_cache_store(const uint8_t *image, uint32_t size, uint32_t crc, uint8_t filetype);
+bool    sid_cache_select(uint8_t id);
+void    sid_cache_clear(void);
+void    sid_cache_request(uint8_t *buffer);
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* _USBSID_SID_CACHE_H_ */
@@ -42,7 +42,7 @@
 
 /* Init local variables */
 static volatile bool read_config = false;
-static uint8_t * chip_config = NULL;
+static uint8_t chip_config[MAX_BUFFER_SIZE];
 static uint8_t skpico_config[64] = {0xff};
 static uint8_t skpico_version_result[32] = {0xff};
 static char skpico_version[32] = {0};
@@ -615,7 +615,6 @@ bool read_chip_configuration(uint8_t base_address, int command, uint8_t * chip_c
 { /* TODO: Finish */
 
   read_config = true;
-  chip_config = (uint8_t*)calloc(1, MAX_BUFFER_SIZE);
   memset(chip_config, 0, MAX_BUFFER_SIZE);
 
   chip_config[0] = command;
@@ -638,7 +637,6 @@ bool read_chip_configuration(uint8_t base_address, int command, uint8_t * chip_c
 
   memcpy(chip_config_r, chip_config, 64);
 
-  free(chip_config);
   read_config = false;
   return true;
 }
@@ -274,6 +274,8 @@ static const uint8_t attack_decayrelease[16] =
  * Osc Fn (Hex), No, Musical Note, Freq (Hz), Osc Fn (Decimal)
  * Note index is exactly off by one octave (12 semitones) when
  * compared to the standard midi note
+ * Reference values at 1MHz, the MIDI handler generates its
+ * own table for the active clock rate in midi_pitch_init
  */
 static const uint32_t musical_scale_values[96] =
 {
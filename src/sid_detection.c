@@ -36,6 +36,8 @@
 #include <sid_pdsid.h>
 #include <sid_backsid.h>
 #include <sid_sidemu.h>
+#include <sid_detection_cache.h>
+#include <mcu.h>
 #if PCB_VERSION_INT >= 15
 #include <gpio.h>
 #endif
@@ -759,13 +761,111 @@ static void update_probe_config_from_detection(DetectionResult result, Config *
   return;
 }
 
+/**
+ * @brief Cheap per address probe for the detection cache
+ * @note the id reads of the ARMSID, FPGASID and SIDKick-pico detectors
+ *       followed by one pass of the detect_sid_model oscillator test, no
+ *       retries. Clones answer their id registers, real chips don't, and
+ *       the oscillator test tells an empty socket, a 6581 and an 8580
+ *       apart. A noisy probe only costs a full detection, never a wrong
+ *       result
+ *
+ * @param uint8_t base_address
+ * @param uint8_t *fp FINGERPRINT_BYTES bytes
+ */
+#define FINGERPRINT_BYTES 10
+static void fingerprint_address(uint8_t base_address, uint8_t *fp)
+{
+  /* ARMSID & ARM2SID, see detect_armsid */
+  clear_sid_registers_at_addr(base_address);
+  cycled_write_operation((ARMSID_W1 + base_address), 0x00, 6);
+  cycled_write_operation((ARMSID_W1 + base_address), 0x00, 6);
+  cycled_write_operation((ARMSID_W1 + base_address), 0x00, 6);
+  cycled_write_operation((ARMSID_W1 + base_address), ARMSID_S, 6);
+  cycled_write_operation((ARMSID_W2 + base_address), ARMSID_I, 6);
+  cycled_write_operation((ARMSID_W3 + base_address), ARMSID_D, 6);
+  sleep_ms(10);
+  fp[0] = cycled_read_operation((ARMSID_R1 + base_address), 4);
+  fp[1] = cycled_read_operation((ARMSID_R2 + base_address), 4);
+  cycled_write_operation((ARMSID_W1 + base_address), 0x00, 6);
+  cycled_write_operation((ARMSID_W1 + base_address), 0x00, 6);
+  cycled_write_operation((ARMSID_W1 + base_address), 0x00, 6);
+
+  /* FPGASID, see detect_fpgasid */
+  clear_sid_registers_at_addr(base_address);
+  cycled_write_operation((0x19 + base_address), 0x80, 6);
+  cycled_write_operation((0x1A + base_address), 0x65, 6);
+  cycled_write_operation((0x1E + base_address), (1 << 7), 6);
+  fp[2] = cycled_read_operation((0x19 + base_address), 4);
+  fp[3] = cycled_read_operation((0x1A + base_address), 4);
+  cycled_write_operation((0x19 + base_address), 0x0, 6);
+  cycled_write_operation((0x1A + base_address), 0x0, 6);
+
+  /* SIDKick-pico, the "pico" part of the version string, see detect_skpico */
+  clear_sid_registers_at_addr(base_address);
+  cycled_write_operation((0x1F + base_address), 0xFF, 0);
+  cycled_write_operation((0x1D + base_address), 0xFA, 0);
+  for (int i = 0; i < 4; i++) {
+    cycled_write_operation((0x1E + base_address), (0xE2 + i), 0);
+    fp[4 + i] = cycled_read_operation((0x1D + base_address), 0);
+  }
+  cycled_write_operation((0x1D + base_address), 0xFB, 0);
+
+  /* Chip model, see detect_sid_model */
+  clear_sid_registers_at_addr(base_address);
+  cycled_write_operation((base_address + 0x12), 0x48, 5);
+  cycled_write_operation((base_address + 0x0F), 0x48, 3);
+  cycled_write_operation((base_address + 0x12), 0x24, 5);
+  fp[8] = cycled_read_operation((base_address + 0x1B), 3);  /* OSC3 */
+  fp[9] = cycled_read_operation((base_address + 0x1B), 7);  /* OSC3, should read 3 on a real SID */
+  clear_sid_registers_at_addr(base_address);
+  return;
+}
+
+/**
+ * @brief Fingerprint of the sockets and regulators for the detection cache
+ * @note probes all four addresses with both sockets set to dual, the sid2
+ *       address of a single chip mirrors its sid1 address, a dual clone
+ *       answers with its second SID. Leaves cfg on the dual probe config
+ *
+ * @param Config * probe, the single SID probe config
+ * @return uint32_t
+ */
+static uint32_t detection_fingerprint(const Config * probe)
+{
+  Config dual = *probe;
+  dual.socketOne.dualsid = dual.socketTwo.dualsid = true;
+  dual.socketOne.sid1 = (SIDChip){ .id = 0, .addr = 0x00, .type = SID_UNKNOWN };
+  dual.socketOne.sid2 = (SIDChip){ .id = 1, .addr = 0x20, .type = SID_UNKNOWN };
+  dual.socketTwo.sid1 = (SIDChip){ .id = 2, .addr = 0x40, .type = SID_UNKNOWN };
+  dual.socketTwo.sid2 = (SIDChip){ .id = 3, .addr = 0x60, .type = SID_UNKNOWN };
+  RuntimeCFG dual_rt;
+  apply_runtime_config(&dual, &dual_rt);
+  uint32_t irq = save_and_disable_interrupts();
+  memcpy(&cfg, &dual_rt, sizeof(RuntimeCFG));
+  restore_interrupts(irq);
+
+  uint8_t fp[((4 * FINGERPRINT_BYTES) + 1)] = {0};
+  fingerprint_address(dual.socketOne.sid1.addr, &fp[(0 * FINGERPRINT_BYTES)]);
+  fingerprint_address(dual.socketOne.sid2.addr, &fp[(1 * FINGERPRINT_BYTES)]);
+  fingerprint_address(dual.socketTwo.sid1.addr, &fp[(2 * FINGERPRINT_BYTES)]);
+  fingerprint_address(dual.socketTwo.sid2.addr, &fp[(3 * FINGERPRINT_BYTES)]);
+#if PCB_VERSION_INT >= 15
+  fp[(4 * FINGERPRINT_BYTES)] = get_pin_states();  /* Regulators and HV selection */
+#endif
+  return crc32_update(0, fp, sizeof(fp));
+}
+
 /**
  * @brief Runs a Chip and SID detection routine
  *        for all sockets and possible addresses
+ * @note with use_cache a stored result for the same socket fingerprint
+ *       is returned instead of running the clone and SID type detection
  *
+ * @param bool use_cache
  * @return DetectionResult
  */
-DetectionResult detect_all(void)
+DetectionResult detect_all(bool use_cache)
 {
   /* result including sockets */
   DetectionResult result = { .success = false, .error = CFG_OK };
@@ -793,6 +893,18 @@ DetectionResult detect_all(void)
   /* Give clones time to finish whatever it's doing */
   sleep_ms(500);
 
+  /* Known sockets? Then skip the detection */
+  uint32_t fingerprint = detection_fingerprint(&probe);
+  bool cached = (use_cache && detection_cache_lookup(fingerprint, &result));
+  if (cached) {
+    if(detection_logging) usSID("Socket fingerprint %08x found in detection cache\n", fingerprint);
+    goto restore;
+  }
+  /* Back to the single SID probe config */
+  irq = save_and_disable_interrupts();
+  memcpy(&cfg, &probe_rt, sizeof(RuntimeCFG));
+  restore_interrupts(irq);
+
   /* Detect SocketOne Chip */
   result = detect_socket_chip(result, &probe, SOCK_ONE);
   /* Update probe config (for dual or single sid detection) */
@@ -829,12 +941,14 @@ DetectionResult detect_all(void)
   /* Verify SocketTwo results */
   result = verify_socket_chip(result, SOCK_TWO);
 
+restore:;
   /* Restore original runtime config */
   irq = save_and_disable_interrupts();
   memcpy(&cfg, &saved_cfg, sizeof(RuntimeCFG));
   restore_interrupts(irq);
 
   result.success = true;
+  if (!cached) detection_cache_store(fingerprint, &result);
 
   set_busconfig_logging(false);
   if(detection_logging) {
@@ -864,8 +978,8 @@ ConfigError sid_auto_detect(bool at_boot)
     usSID("Starting auto detect routine\n");
   }
 
-  /* Run detection */
-  DetectionResult det = detect_all();
+  /* Run detection, requested detections always run in full */
+  DetectionResult det = detect_all(at_boot);
 
   /* Realign the bus pipeline, also covers the error returns below */
   bus_drain();
@@ -919,7 +1033,7 @@ ConfigError sid_auto_detect_silent(void)
   set_base_voltages(500);
 #endif
   /* Run detection */
-  DetectionResult det = detect_all();
+  DetectionResult det = detect_all(false);
 
   /* Realign the bus pipeline, also covers the error returns below */
   bus_drain();
@@ -45,7 +45,7 @@ ConfigError     sid_auto_detect(bool at_boot);
 ConfigError     sid_auto_detect_silent(void);
 ChipType        detect_chiptype_at(uint8_t base_address);
 SIDType         detect_sidtype_at(uint8_t base_address, uint8_t chiptype);
-DetectionResult detect_all(void);
+DetectionResult detect_all(bool use_cache);
 bool            detect_fmopl(uint8_t base_address);
 void            auto_detect_routine(void);
 uint8_t         detect_sid_model(uint8_t start_addr);
@@ -0,0 +1,152 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sid_detection_cache.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stddef.h>
+
+#include <globals.h>
+#include <config.h>
+#include <mcu.h>
+#include <logging.h>
+#include <sid_detection_cache.h>
+
+
+#define RECORD_ERASED 0xFFFFFFFF
+
+typedef struct __attribute__((packed)) DetectionRecord {
+  uint32_t magic;           /* MAGIC_SMOKE of the firmware that detected, 0xFFFFFFFF is an erased slot */
+  uint32_t fingerprint;
+  DetectionResult result;
+  uint32_t crc;             /* CRC32 of the fields above */
+} DetectionRecord;
+
+static_assert(sizeof(DetectionRecord) <= FLASH_PAGE_SIZE, "[DETECT] DetectionRecord doesn't fit in a flash page");
+
+#define cache_slot(slot) \
+  ((const DetectionRecord *)(XIP_BASE + DETECTION_CACHE_OFFSET + ((slot) * FLASH_PAGE_SIZE)))
+
+typedef struct {
+  uint32_t offset;
+  const uint8_t *page;
+  bool erase;  /* Erase the cache sector first */
+} detection_write_t;
+
+
+static void __no_inline_not_in_flash_func(write_detection_lowlevel)(void *param)
+{ /* No logging in this function to avoid errors */
+  const detection_write_t *w = (const detection_write_t *)param;
+  uint32_t ints = save_and_disable_interrupts();
+  if (w->erase) flash_range_erase(DETECTION_CACHE_OFFSET, FLASH_SECTOR_SIZE);
+  flash_range_program(w->offset, w->page, FLASH_PAGE_SIZE);
+  restore_interrupts(ints);
+  return;
+}
+
+static uint32_t record_crc(const DetectionRecord *r)
+{
+  return crc32_update(0, (const uint8_t *)r, offsetof(DetectionRecord, crc));
+}
+
+static bool record_valid(const DetectionRecord *r)
+{
+  return (r->magic == MAGIC_SMOKE && record_crc(r) == r->crc);
+}
+
+/* Records are appended in order, the first erased slot ends the list */
+static int used_slots(void)
+{
+  int used = 0;
+  while (used < DETECTION_CACHE_SLOTS && cache_slot(used)->magic != RECORD_ERASED) used++;
+  return used;
+}
+
+/* Newest valid record for fingerprint or NULL */
+static const DetectionRecord *find_record(uint32_t fingerprint)
+{
+  for (int slot = (used_slots() - 1); slot >= 0; slot--) {
+    const DetectionRecord *r = cache_slot(slot);
+    if (r->fingerprint == fingerprint && record_valid(r)) return r;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Look up a stored detection result for a socket fingerprint
+ *
+ * @param uint32_t fingerprint
+ * @param DetectionResult *result, untouched on a miss
+ * @return bool true on a hit
+ */
+bool detection_cache_lookup(uint32_t fingerprint, DetectionResult *result)
+{
+  const DetectionRecord *r = find_record(fingerprint);
+  if (r == NULL) return false;
+  /* NOTICE: Do not do any logging directly after memcpy without stdio_flush or the Pico will freeze! */
+  memcpy(result, &r->result, sizeof(DetectionResult));
+  stdio_flush();
+  return true;
+}
+
+/**
+ * @brief Store a detection result for a socket fingerprint
+ * @note skips the write if the newest record for the fingerprint already
+ *       holds the same socket results, erases the sector when it's full
+ *
+ * @param uint32_t fingerprint
+ * @param const DetectionResult *result
+ */
+void detection_cache_store(uint32_t fingerprint, const DetectionResult *result)
+{
+  const DetectionRecord *r = find_record(fingerprint);
+  if (r != NULL && memcmp(r->result.socket, result->socket, sizeof(result->socket)) == 0) return;
+
+  uint8_t page[FLASH_PAGE_SIZE];
+  memset(page, 0xFF, FLASH_PAGE_SIZE);
+  DetectionRecord *rec = (DetectionRecord *)page;
+  rec->magic = MAGIC_SMOKE;
+  rec->fingerprint = fingerprint;
+  memcpy(&rec->result, result, sizeof(DetectionResult));
+  rec->crc = record_crc(rec);
+
+  int slot = used_slots();
+  bool erase = (slot >= DETECTION_CACHE_SLOTS);
+  if (erase) slot = 0;
+  detection_write_t w = {
+    .offset = (DETECTION_CACHE_OFFSET + (slot * FLASH_PAGE_SIZE)),
+    .page = page,
+    .erase = erase
+  };
+  int err = flash_safe_execute(write_detection_lowlevel, &w, 100);
+  if (err != PICO_OK) {
+    usERR("[DETECT] Cache write @ 0x%x failed: %d\n", w.offset, err);
+    return;
+  }
+  if (!record_valid(cache_slot(slot))) {
+    usERR("[DETECT] Cache record in slot %d failed to verify\n", slot);
+    return;
+  }
+  usSID("Cached detection result for fingerprint %08x in slot %d%s\n",
+    fingerprint, slot, (erase ? " after erase" : ""));
+  return;
+}
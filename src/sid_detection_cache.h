@@ -0,0 +1,66 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sid_detection_cache.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _USBSID_SID_DETECTION_CACHE_H_
+#define _USBSID_SID_DETECTION_CACHE_H_
+#pragma once
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+/* Default includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Project includes required for this header */
+#include <usbsid_constants.h>
+#include <config_store.h>
+
+
+/* SID detection cache
+ *
+ * The sector after the config journal holds detection results, one flash
+ * page per record, keyed by a fingerprint of the clone id registers and
+ * one oscillator test at all four SID addresses. A boot time detection with
+ * a known fingerprint uses the stored result and skips the full clone
+ * probes, the SID model retries and the re-probe waits, the settle time
+ * before the fingerprint still applies. Records are
+ * appended and the sector is erased when it's full. A firmware with another
+ * MAGIC_SMOKE ignores the records and detects again.
+ */
+#define DETECTION_CACHE_OFFSET (CONFIG_JOURNAL_OFFSET + (CONFIG_JOURNAL_SECTORS * FLASH_SECTOR_SIZE))
+#define DETECTION_CACHE_SLOTS  (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+
+/* Functions from sid_detection_cache.c */
+bool detection_cache_lookup(uint32_t fingerprint, DetectionResult *result);
+void detection_cache_store(uint32_t fingerprint, const DetectionResult *result);
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* _USBSID_SID_DETECTION_CACHE_H_ */
@@ -0,0 +1,281 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sid_upload.c
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if defined(ONBOARD_SIDPLAYER)
+
+#include <globals.h>
+#include <usbsid.h>
+#include <config.h>
+#include <logging.h>
+#include <sid_upload.h>
+#include <sid_cache.h>
+#include <arena.h>
+#include <mcu.h>
+
+
+/* PSID/RSID header fields, big endian */
+#define PSID_VERSION     0x04
+#define PSID_DATAOFFSET  0x06
+#define PSID_LOADADDRESS 0x08
+
+static_assert(UPLOAD_MAX_SIZE <= ARENA_SIDPLAYER_SIZE, "[UPLOAD] UPLOAD_MAX_SIZE doesn't fit the SID player arena layout");
+
+/* Upload state, owned by core 0 */
+static struct {
+  uint8_t *image;     /* File image in the mode arena */
+  uint32_t size;
+  uint32_t crc;       /* CRC32 of the whole file as announced by the host */
+  uint32_t received;  /* Contiguous bytes received from offset 0 */
+  uint32_t needed;    /* Bytes required before the header can be checked */
+  uint8_t filetype;
+  uint8_t status;     /* UploadStatus */
+  bool header_ok;
+} upload = { .status = UPLOAD_IDLE };
+
+/* Verified image waiting for sid_upload_task to copy it to the flash tune cache */
+static struct {
+  const uint8_t *image;
+  uint32_t size;
+  uint32_t crc;
+  uint8_t filetype;
+  bool pending;
+} store = { .pending = false };
+
+
+static inline uint32_t read_be24(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]);
+}
+
+static inline uint32_t read_be32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+}
+
+static void upload_reply(uint8_t cache_id)
+{
+  memset(write_buffer_p, 0, 64);
+  write_buffer_p[0] = upload.status;
+  write_buffer_p[1] = ((upload.received >> 16) & 0xFF);
+  write_buffer_p[2] = ((upload.received >> 8) & 0xFF);
+  write_buffer_p[3] = (upload.received & 0xFF);
+  write_buffer_p[4] = cache_id;
+  write_back_data(5);
+  return;
+}
+
+static void upload_abort(uint8_t status)
+{
+  arena_release(ARENA_SIDPLAYER);
+  upload.image = NULL;
+  upload.received = 0;
+  upload.status = status;
+  return;
+}
+
+/**
+ * @brief Check the header as soon as enough of it is in
+ * @note rejects anything that would not fit in C64 memory
+ *       before the rest of the file is transferred
+ */
+static void upload_check_header(void)
+{
+  const uint8_t *h = upload.image;
+  uint32_t load, data;
+
+  if (upload.filetype == PRG_FILE) {
+    load = (h[0] | h[1] << 8);
+    data = 2;
+  } else {
+    if ((memcmp(h, "PSID", 4) != 0) && (memcmp(h, "RSID", 4) != 0)) {
+      usERR("[UPLOAD] Not a PSID/RSID file\n");
+      upload_abort(UPLOAD_BAD_HEADER);
+      return;
+    }
+    data = (h[PSID_DATAOFFSET] << 8 | h[PSID_DATAOFFSET + 1]);
+    load = (h[PSID_LOADADDRESS] << 8 | h[PSID_LOADADDRESS + 1]);
+    if (data < 0x76 || data > (upload.size - 2)) {
+      usERR("[UPLOAD] Invalid data offset $%04x\n", data);
+      upload_abort(UPLOAD_BAD_HEADER);
+      return;
+    }
+    if (load == 0) {  /* Load address is in the first two data bytes */
+      if (upload.received < (data + 2)) {
+        upload.needed = (data + 2);
+        return;
+      }
+      load = (h[data] | h[data + 1] << 8);
+      data += 2;
+    }
+  }
+  if ((load + (upload.size - data)) > 0x10000) {
+    usERR("[UPLOAD] $%04x + %u bytes does not fit in C64 memory\n", load, (upload.size - data));
+    upload_abort(UPLOAD_BAD_HEADER);
+    return;
+  }
+  usCFG("[UPLOAD] v%u load $%04x, %u bytes\n",
+    (upload.filetype == PRG_FILE ? 0 : h[PSID_VERSION + 1]), load, (upload.size - data));
+  upload.header_ok = true;
+  return;
+}
+
+void sid_upload_begin(uint8_t *buffer)
+{
+  uint8_t filetype = buffer[1];
+  uint32_t size = read_be24(&buffer[2]);
+  uint32_t crc = read_be32(&buffer[5]);
+
+  if (upload.image != NULL && upload.status == UPLOAD_RECEIVING
+      && upload.size == size && upload.crc == crc && upload.filetype == filetype) {
+    usCFG("[UPLOAD] Resuming at %u of %u\n", upload.received, upload.size);
+    upload_reply(0);
+    return;
+  }
+
+  bool pending = sidplayer_init;
+  __dmb();  /* Core 1 sets sidfile_loading before it clears sidplayer_init */
+  if (pending || sidfile_loading || store.pending) {  /* Previous tune not picked up or not cached yet */
+    upload.status = UPLOAD_BUSY;
+    upload_reply(0);
+    return;
+  }
+  if (!sidfile_in_flash) sidfile = NULL;  /* A tune that wasn't played yet is overwritten */
+  upload.image = NULL;
+  upload.size = size;
+  upload.crc = crc;
+  upload.filetype = filetype;
+  upload.received = 0;
+  upload.header_ok = false;
+  upload.needed = ((filetype == PRG_FILE) ? 2 : 0x7C);
+  if (size <= upload.needed || size > UPLOAD_MAX_SIZE) {
+    usERR("[UPLOAD] Invalid file size %u\n", size);
+    upload.status = UPLOAD_BAD_HEADER;
+    upload_reply(0);
+    return;
+  }
+  upload.image = (uint8_t*)arena_acquire(ARENA_SIDPLAYER, size);
+  if (upload.image == NULL) {
+    usERR("[UPLOAD] Arena unavailable for %u bytes\n", size);
+    upload.status = UPLOAD_NO_MEMORY;
+    upload_reply(0);
+    return;
+  }
+  upload.status = UPLOAD_RECEIVING;
+  usCFG("[UPLOAD] Receiving %s of %u bytes\n", ((filetype == PRG_FILE) ? "PRG" : "SID"), size);
+  upload_reply(0);
+  return;
+}
+
+void sid_upload_chunk(uint8_t *buffer)
+{
+  if (upload.status != UPLOAD_RECEIVING) return;
+  uint32_t offset = read_be24(&buffer[1]);
+  uint8_t len = buffer[4];
+  uint32_t crc = read_be32(&buffer[5]);
+  const uint8_t *payload = &buffer[UPLOAD_CHUNK_HEADER];
+
+  if (len == 0 || len > UPLOAD_CHUNK_MAX || (offset + len) > upload.size) return;
+  if (offset > upload.received) return;  /* Gap, the host resumes from the watermark */
+  if (crc32_update(0, payload, len) != crc) {
+    usDBG("[UPLOAD] CRC error in chunk @ %u\n", offset);
+    return;
+  }
+  memcpy(&upload.image[offset], payload, len);
+  if ((offset + len) > upload.received) upload.received = (offset + len);
+
+  if (!upload.header_ok && upload.received >= upload.needed) {
+    upload_check_header();
+  }
+  return;
+}
+
+void sid_upload_commit(uint8_t *buffer)
+{
+  if (upload.status != UPLOAD_RECEIVING || upload.received < upload.size || !upload.header_ok) {
+    upload_reply(0);  /* Tells the host where to resume */
+    return;
+  }
+  if (crc32_update(0, upload.image, upload.size) != upload.crc) {
+    usERR("[UPLOAD] File CRC mismatch\n");
+    upload.received = 0;
+    upload.status = UPLOAD_BAD_CRC;
+    upload_reply(0);
+    upload.status = UPLOAD_RECEIVING;  /* Keep the buffer, the host resends from zero */
+    return;
+  }
+  if (sidplayer_init || sidfile_loading) {  /* Player hasn't picked up the previous tune yet */
+    upload.status = UPLOAD_BUSY;
+    upload_reply(0);
+    upload.status = UPLOAD_RECEIVING;
+    return;
+  }
+
+  /* Flash writes stall USB and playback, only cache on request and after replying */
+  if (buffer[1] == 1) {
+    store.image = upload.image;
+    store.size = upload.size;
+    store.crc = upload.crc;
+    store.filetype = upload.filetype;
+    store.pending = true;
+  }
+
+  /* Hand the image over, the player releases the arena after loading */
+  sidfile = upload.image;
+  sidfile_in_flash = false;
+  sidfile_size = upload.size;
+  is_prg = (upload.filetype == PRG_FILE);
+  upload.image = NULL;
+  upload.status = UPLOAD_OK;
+  usCFG("[UPLOAD] %u bytes verified%s\n", upload.size, (store.pending ? ", caching" : ""));
+  upload_reply(0);
+  upload.status = UPLOAD_IDLE;
+  return;
+}
+
+/**
+ * @brief Copy a committed upload to the flash tune cache
+ * @note runs from the core 0 loop, outside the USB callbacks
+ */
+void sid_upload_task(void)
+{
+  if __us_likely(!store.pending) return;
+  /* The player releases the arena after loading, the image is intact until another mode takes it */
+  ArenaMode owner = arena_owner();
+  if (owner != ARENA_SIDPLAYER && owner != ARENA_FREE) {
+    usWRN("[UPLOAD] Arena taken by mode %d, upload not cached\n", owner);
+  } else if (crc32_update(0, store.image, store.size) != store.crc) {
+    /* e.g. a legacy UPLOAD_SID_START cleared or refilled the arena */
+    usWRN("[UPLOAD] Image changed since commit, upload not cached\n");
+  } else {
+    uint8_t cache_id = sid_cache_store(store.image, store.size, store.crc, store.filetype);
+    usCFG("[UPLOAD] %u bytes cached as id %u\n", store.size, cache_id);
+  }
+  store.image = NULL;
+  store.pending = false;
+  return;
+}
+
+
+#endif /* ONBOARD_SIDPLAYER */
@@ -0,0 +1,81 @@
+/*
+ * USBSID-Pico is a RPi Pico/PicoW (RP2040) & Pico2/Pico2W (RP2350) based board
+ * for interfacing one or two MOS SID chips and/or hardware SID emulators over
+ * (WEB)USB with your computer, phone or ASID supporting player
+ *
+ * sid_upload.h
+ * This file is part of USBSID-Pico (https://github.com/LouDnl/USBSID-Pico)
+ * File author: LouD
+ *
+ * Copyright (c) 2024-2026 LouD
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _USBSID_SID_UPLOAD_H_
+#define _USBSID_SID_UPLOAD_H_
+#pragma once
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+/* Default includes */
+#include <stdint.h>
+#include <stddef.h>
+
+
+/* Framed upload
+ *
+ * All packets are CONFIG packets, byte 0 is the command
+ * UPLOAD_SID_BEGIN  { CMD, FILETYPE, SIZE(3), CRC32(4) }
+ * UPLOAD_SID_CHUNK  { CMD, OFFSET(3), LEN, CRC32(4), PAYLOAD(LEN) }
+ * UPLOAD_SID_COMMIT { CMD, CACHE }
+ * Multi byte values are big endian, the CRC32 is IEEE 802.3
+ *
+ * BEGIN and COMMIT reply with { STATUS, RECEIVED(3), 0 }. With CACHE set
+ * to 1 a verified file is copied to the flash tune cache after the reply,
+ * the host finds its id with SID_CACHE_LOOKUP. A BEGIN replies BUSY until
+ * the copy is done
+ * Chunks are not acknowledged so the host can pipeline them, a chunk
+ * with a bad CRC or past a gap is dropped and the received watermark
+ * stays put. COMMIT tells the host where to resume. A BEGIN with the
+ * same size and CRC as an unfinished upload resumes it.
+ */
+#define UPLOAD_CHUNK_HEADER 9
+#define UPLOAD_CHUNK_MAX    54  /* 63 byte config buffer minus the chunk header */
+#define UPLOAD_MAX_SIZE     (0x7C + 0x10000)  /* v2+ PSID header and a full 64KB payload */
+
+typedef enum {
+  UPLOAD_OK = 0,        /* Verified and handed to the player */
+  UPLOAD_RECEIVING,     /* Waiting for (more) chunks */
+  UPLOAD_BAD_HEADER,    /* Not a PSID/RSID/PRG or it doesn't fit in C64 memory */
+  UPLOAD_BAD_CRC,       /* File CRC mismatch, resend from zero */
+  UPLOAD_NO_MEMORY,
+  UPLOAD_BUSY,          /* Player is still loading the previous tune */
+  UPLOAD_IDLE,          /* No upload in progress */
+} UploadStatus;
+
+/* Functions from sid_upload.c */
+void     sid_upload_begin(uint8_t *buffer);
+void     sid_upload_chunk(uint8_t *buffer);
+void     sid_upload_commit(uint8_t *buffer);
+void     sid_upload_task(void);
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* _USBSID_SID_UPLOAD_H_ */
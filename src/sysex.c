@@ -46,6 +46,8 @@
 /* Custom commands */
 enum {
   SYSEX_TOGGLE_AUDIO = 0x01,
+  SYSEX_ASID_TELEMETRY = 0x02,
+  SYSEX_ASID_LATENCY = 0x03,
 };
 
 
@@ -64,6 +66,17 @@ void decode_sysex_command(uint8_t * buffer, int size)
       config_buffer[0] = TOGGLE_AUDIO;
       handle_config_request(config_buffer, 5);
       break;
+    case SYSEX_ASID_TELEMETRY:  /* ASID buffer telemetry on / off */
+      if (size < 5) break;  /* F0 50 02 <on> F7, no data byte no change */
+      set_asid_telemetry(buffer[3] != 0);
+      break;
+    case SYSEX_ASID_LATENCY:  /* ASID buffer latency in frames, not saved */
+      if (size < 5) break;  /* F0 50 03 <frames> F7 */
+      config_buffer[0] = SET_CONFIG;
+      config_buffer[1] = BOARD_ASIDLAT;
+      config_buffer[2] = buffer[3];
+      handle_config_request(config_buffer, 5);
+      break;
     default:
       break;
   }
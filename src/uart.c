@@ -41,18 +41,28 @@
 /* Locals */
 static PIO uart_pio = pio2;
 static uint sm_uartrx;
-static int8_t pioirq_uartrx;
-static queue_t fifo_uartrx;
 static uint offset_uartrx;
+static int dma_uartrx = -1;
+
+/* DMA ring fed straight from the PIO RX FIFO
+ * Latency: one byte takes ~10.9us on the line at 921600 baud, the worker
+ * polls the ring every UARTRX_POLL_US, so a complete packet reaches the
+ * bus at most ~UARTRX_POLL_US + one byte time + the bus write after its
+ * last stop bit. The ring holds ~2.7ms of continuous line data, anything
+ * older is dropped and counted instead of stalling the receiver */
+static uint8_t uartrx_ring[UARTRX_RING_SIZE] __aligned(UARTRX_RING_SIZE);
+static uint32_t rx_armed = 0;      /* Bytes received before the current DMA arm */
+static uint32_t rx_tail = 0;       /* Bytes consumed by the worker */
+static uint32_t rx_overflows = 0;  /* Bytes dropped because the worker fell behind */
 
 static size_t bytes_per_rxpacket = 8; /* Initial size = init packet */
 static size_t bytes_rxed = 0; /* Counter for incoming bytes */
 
 /* Pre declarations */
-static void async_worker_func(async_context_t *async_context, async_when_pending_worker_t *worker);
-/* An async context is notified by the irq to "do some work" */
+static void async_worker_func(async_context_t *async_context, async_at_time_worker_t *worker);
+/* An async context runs the worker every UARTRX_POLL_US */
 static async_context_threadsafe_background_t async_context;
-static async_when_pending_worker_t worker = { .do_work = async_worker_func };
+static async_at_time_worker_t worker = { .do_work = async_worker_func };
 
 
 static inline void uart_rx_program_init(uint pin, uint baud)
@@ -77,101 +87,150 @@ static inline void uart_rx_program_init(uint pin, uint baud)
   return;
 }
 
-static inline char uart_rx_program_getc(void)
+/**
+ * @brief (Re)arm the RX DMA at the current ring position
+ * @note the PIO FIFO keeps receiving while the channel is stopped
+ */
+static void uart_rx_dma_arm(void)
+{
+  dma_channel_set_write_addr(dma_uartrx, &uartrx_ring[(rx_armed & UARTRX_RING_MASK)], false);
+  dma_channel_set_trans_count(dma_uartrx, UARTRX_DMA_COUNT, true);
+  return;
+}
+
+static void uart_rx_dma_init(void)
 {
+  dma_uartrx = dma_claim_unused_channel(true);
+  dma_channel_config rx_config = dma_channel_get_default_config(dma_uartrx);
+  channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+  channel_config_set_read_increment(&rx_config, false);
+  channel_config_set_write_increment(&rx_config, true);
+  channel_config_set_ring(&rx_config, true, UARTRX_RING_BITS);  /* Wrap the write address */
+  channel_config_set_dreq(&rx_config, pio_get_dreq(uart_pio, sm_uartrx, false));
   /* 8-bit read from the uppermost byte of the FIFO, as data is left-justified */
-  io_rw_8 *rxfifo_shift = (io_rw_8*)&uart_pio->rxf[sm_uartrx] + 3;
-  while (pio_sm_is_rx_fifo_empty(uart_pio, sm_uartrx))
-    tight_loop_contents();
-  return (char)*rxfifo_shift;
+  dma_channel_configure(dma_uartrx, &rx_config, uartrx_ring,
+    ((io_rw_8*)&uart_pio->rxf[sm_uartrx] + 3), UARTRX_DMA_COUNT, false);
+  rx_armed = rx_tail = 0;
+  uart_rx_dma_arm();
+  return;
 }
 
-static void pio_irq_func(void)
+/**
+ * @brief Number of bytes the DMA has written into the ring since init
+ */
+static inline uint32_t uart_rx_head(void)
 {
-  while(!pio_sm_is_rx_fifo_empty(uart_pio, sm_uartrx)) {
-    char rxdata = uart_rx_program_getc();
-    if (!queue_try_add(&fifo_uartrx, &rxdata)) {
-      panic("fifo_uartrx full");
-    }
+  uint32_t remaining = dma_channel_hw_addr(dma_uartrx)->transfer_count;
+  if __us_unlikely(remaining < UARTRX_DMA_REARM) {  /* Running out, restart the count */
+    dma_channel_abort(dma_uartrx);
+    rx_armed += (UARTRX_DMA_COUNT - dma_channel_hw_addr(dma_uartrx)->transfer_count);
+    uart_rx_dma_arm();
+    return rx_armed;
   }
-  /* Tell the async worker that there are some characters waiting for us */
-  async_context_set_work_pending(&async_context.core, &worker);
-  return;
+  return (rx_armed + (UARTRX_DMA_COUNT - remaining));
 }
 
-static void async_worker_func(__unused async_context_t *async_context, __unused async_when_pending_worker_t *worker)
-{ /* TODO: Finish */
+/**
+ * @brief Feed a chunk of received bytes to the USBSID packet parser
+ *
+ * @param const uint8_t *chunk
+ * @param size_t n
+ */
+static void uart_packet_chunk(const uint8_t *chunk, size_t n)
+{
   usbdata = 1;
   dtype = uart;
-  if (offload_ledrunner == false) bytes_rxed = 0;
-  offload_ledrunner = true;
-  while(!queue_is_empty(&fifo_uartrx)) {
-    if (!queue_try_remove(&fifo_uartrx, &uart_buffer[bytes_rxed])) {
-      panic("fifo_uartrx empty");
-    } else {
-      // usDBG("[%d/%d] %02X $%02X:%02X\n",i,bytes_per_rxpacket,uart_buffer[0],uart_buffer[1],uart_buffer[2]);
-      if ((uart_buffer[0] == 0xFF && uart_buffer[1] == 0xFF)
-          || (uart_buffer[1] == 0xFF && uart_buffer[2] == 0xFF)
-          || (uart_buffer[2] == 0xFF && uart_buffer[3] == 0xFF)) {
-        usDBG("[UART CONFIG] RESET\n");
+  for (size_t i = 0; i < n; i++) {
+    if (offload_ledrunner == false) {
+      bytes_rxed = 0;
+      usbdata = 1;
+      dtype = uart;
+      offload_ledrunner = true;
+    }
+    uart_buffer[bytes_rxed] = chunk[i];
+    // usDBG("[%d/%d] %02X $%02X:%02X\n",i,bytes_per_rxpacket,uart_buffer[0],uart_buffer[1],uart_buffer[2]);
+    if ((uart_buffer[0] == 0xFF && uart_buffer[1] == 0xFF)
+        || (uart_buffer[1] == 0xFF && uart_buffer[2] == 0xFF)
+        || (uart_buffer[2] == 0xFF && uart_buffer[3] == 0xFF)) {
+      usDBG("[UART CONFIG] RESET\n");
+      memset(uart_buffer, 0, 8);
+      bytes_per_rxpacket = 8;
+      bytes_rxed = 0;
+      usbdata = 0;
+      dtype = ntype;
+      offload_ledrunner = false;
+      /* reset_sid(); */
+      continue;
+    }
+    if ((bytes_per_rxpacket == 2) && (bytes_rxed == (bytes_per_rxpacket - 1))) {
+      cycled_write_operation(uart_buffer[0], uart_buffer[1], 6);
+      memset(uart_buffer, 0, 2);
+      bytes_rxed = 0;
+    } else if ((bytes_per_rxpacket == 4) && (bytes_rxed == (bytes_per_rxpacket - 1))) {
+      cycled_write_operation(uart_buffer[0], uart_buffer[1], (uart_buffer[2] << 8 | uart_buffer[3]));
+      memset(uart_buffer, 0, 4);
+      bytes_rxed = 0;
+    } else if ((bytes_per_rxpacket == 8) && (bytes_rxed == (bytes_per_rxpacket - 1))) {
+      /* ISSUE: At the moment a restart is required to reset back to packet size 8 */
+      if (uart_buffer[0] == 0xFF
+        && uart_buffer[1] == 0xEE
+        && uart_buffer[2] == 0xDD
+        && uart_buffer[5] == 0xDD
+        && uart_buffer[6] == 0xEE
+        && uart_buffer[7] == 0xFF) { /* Receiving initiator packet */
+        bytes_per_rxpacket = (size_t)(uart_buffer[3] << 8 | uart_buffer[4]);
+        usDBG("[UART CONFIG] BYTES PER PACKET SET TO %d\n", bytes_per_rxpacket);
         memset(uart_buffer, 0, 8);
-        bytes_per_rxpacket = 8;
         bytes_rxed = 0;
-        usbdata = 0;
-        dtype = ntype;
-        offload_ledrunner = false;
-        /* reset_sid(); */
-        return;
-      }
-      if ((bytes_per_rxpacket == 2) && (bytes_rxed == (bytes_per_rxpacket - 1))) {
-        cycled_write_operation(uart_buffer[0], uart_buffer[1], 6);
-        memset(uart_buffer, 0, 2);
-        bytes_rxed = 0;
-      } else if ((bytes_per_rxpacket == 4) && (bytes_rxed == (bytes_per_rxpacket - 1))) {
-        cycled_write_operation(uart_buffer[0], uart_buffer[1], (uart_buffer[2] << 8 | uart_buffer[3]));
-        memset(uart_buffer, 0, 4);
-        bytes_rxed = 0;
-      } else if ((bytes_per_rxpacket == 8) && (bytes_rxed == (bytes_per_rxpacket - 1))) {
-        /* ISSUE: At the moment a restart is required to reset back to packet size 8 */
-        if (uart_buffer[0] == 0xFF
-          && uart_buffer[1] == 0xEE
-          && uart_buffer[2] == 0xDD
-          && uart_buffer[5] == 0xDD
-          && uart_buffer[6] == 0xEE
-          && uart_buffer[7] == 0xFF) { /* Receiving initiator packet */
-          bytes_per_rxpacket = (size_t)(uart_buffer[3] << 8 | uart_buffer[4]);
-          usDBG("[UART CONFIG] BYTES PER PACKET SET TO %d\n", bytes_per_rxpacket);
-          memset(uart_buffer, 0, 8);
-          bytes_rxed = 0;
-        }
-      } else if (bytes_rxed <= (bytes_per_rxpacket - 1)) {
-        bytes_rxed++;
       }
+    } else if (bytes_rxed < (bytes_per_rxpacket - 1)) {
+      bytes_rxed++;
+    } else {  /* Unsupported packet size, start over instead of running off the buffer */
+      bytes_rxed = 0;
     }
   }
   return;
 }
 
+static void async_worker_func(async_context_t *async_context, async_at_time_worker_t *worker)
+{
+  uint32_t head = uart_rx_head();
+  uint32_t pending = (head - rx_tail);
+  if __us_unlikely(pending > UARTRX_RING_SIZE) {  /* Overwritten before we got to it */
+    rx_overflows += (pending - UARTRX_RING_SIZE);
+    usDBG("[UART] RX overflow, %u bytes dropped (%u total)\n", (pending - UARTRX_RING_SIZE), rx_overflows);
+    rx_tail = (head - UARTRX_RING_SIZE);
+    bytes_rxed = 0;  /* Resync on the next packet */
+  }
+  if __us_unlikely(!boot_ready()) {  /* Drop incoming data until core 1 finished the SID bring-up */
+    rx_tail = head;
+    bytes_rxed = 0;
+  }
+  while (rx_tail != head) {  /* At most two contiguous chunks, before and after the wrap */
+    uint32_t pos = (rx_tail & UARTRX_RING_MASK);
+    uint32_t n = MIN((head - rx_tail), (UARTRX_RING_SIZE - pos));
+    uart_packet_chunk(&uartrx_ring[pos], n);
+    rx_tail += n;
+  }
+  async_context_add_at_time_worker_at(async_context, worker, make_timeout_time_us(UARTRX_POLL_US));
+  return;
+}
+
 static void init_async(void)
 {
   /* Setup an async context and worker to perform work when needed */
   if (!async_context_threadsafe_background_init_with_defaults(&async_context)) {
       panic("failed to setup context");
   }
-  async_context_add_when_pending_worker(&async_context.core, &worker);
+  async_context_add_at_time_worker_at(&async_context.core, &worker, make_timeout_time_us(UARTRX_POLL_US));
   return;
 }
 
 void init_uart(void)
 {
   /* Explicitely set bytes_per_rxpacket to 8 at start for potential compiler zeroing issue */
-  bytes_per_rxpacket = 8
-
-  /* create a queue so the irq can save the data somewhere */
-  queue_init(&fifo_uartrx, 1, UART_FIFO_SIZE);
-
-  /* Setup an async context and worker to perform work when needed */
-  init_async();
+  bytes_per_rxpacket = 8;
+  rx_overflows = 0;
 
   /* This will find a free pio and state machine for our program and load it for us */
   /* We use pio_claim_free_sm_and_add_program_for_gpio_range (for_gpio_range variant) */
@@ -182,49 +241,28 @@ void init_uart(void)
   /* Init uart rx program */
   uart_rx_program_init(PIOUART_RX, FFIN_FAST_BAUD_RATE);
 
-  /* Find a free irq */
-  pioirq_uartrx = pio_get_irq_num(uart_pio, 0);
-  if (irq_get_exclusive_handler(pioirq_uartrx)) {
-    pioirq_uartrx++;
-    if (irq_get_exclusive_handler(pioirq_uartrx)) {
-      panic("All IRQs are in use");
-    }
-  }
+  /* Start draining the RX FIFO into the ring */
+  uart_rx_dma_init();
 
-  /* Enable interrupt */
-  irq_add_shared_handler(pioirq_uartrx, pio_irq_func, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY); /* Add a shared IRQ handler */
-  irq_set_enabled(pioirq_uartrx, true); /* Enable the IRQ */
-  const uint irq_index = pioirq_uartrx - pio_get_irq_num(uart_pio, 0); /* Get index of the IRQ */
-  pio_set_irqn_source_enabled(uart_pio, irq_index, pio_get_rx_fifo_not_empty_interrupt_source(sm_uartrx), true); /* Set uart_pio to tell us when the FIFO is NOT empty */
+  /* Setup an async context and worker to perform work when needed */
+  init_async();
 
   return;
 }
 
 void deinit_uart(void)
 {
-  // /* Echo characters received from PIO to the console */
-  // while (counter < MAX_COUNTER || work_done) {
-  //     // Note that we could just sleep here as we're using "threadsafe_background" that uses a low priority interrupt
-  //     // But if we changed to use a "polling" context that wouldn't work. The following works for both types of context.
-  //     // When using "threadsafe_background" the poll does nothing. This loop is just preventing main from exiting!
-  //     work_done = false;
-  //     async_context_poll(&async_context.core);
-  //     async_context_wait_for_work_ms(&async_context.core, 2000);
-  // }
-
-  /* Disable interrupt */
-  const uint irq_index = pioirq_uartrx - pio_get_irq_num(uart_pio, 0); /* Get index of the IRQ */
-  pio_set_irqn_source_enabled(uart_pio, irq_index, pio_get_rx_fifo_not_empty_interrupt_source(sm_uartrx), false);
-  irq_set_enabled(pioirq_uartrx, false);
-  irq_remove_handler(pioirq_uartrx, pio_irq_func);
+  async_context_remove_at_time_worker(&async_context.core, &worker);
+  async_context_deinit(&async_context.core);
+
+  /* Stop and release the RX DMA */
+  dma_channel_abort(dma_uartrx);
+  dma_channel_unclaim(dma_uartrx);
+  dma_uartrx = -1;
 
   /* This will free resources and unload our program */
   pio_remove_program_and_unclaim_sm(&uart_rx_program, uart_pio, sm_uartrx, offset_uartrx);
 
-  async_context_remove_when_pending_worker(&async_context.core, &worker);
-  async_context_deinit(&async_context.core);
-  queue_free(&fifo_uartrx);
-
   return;
 }
 
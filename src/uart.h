@@ -43,11 +43,11 @@
 /* Pico libs */
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
-#include "pico/util/queue.h"
 #include "pico/async_context_threadsafe_background.h"
 
 /* Pico hardware api's */
 #include "hardware/clocks.h"
+#include "hardware/dma.h"
 #include "hardware/pio.h"
 #include "hardware/uart.h"
 
@@ -55,8 +55,13 @@
 #include "uart_rx.pio.h"
 
 
-/* What am I doing here? */
-#define UART_FIFO_SIZE 65535 /* TODO: Verify size */
+/* RX DMA ring, must be a power of two for the DMA address wrap */
+#define UARTRX_RING_BITS  8
+#define UARTRX_RING_SIZE  (1u << UARTRX_RING_BITS)  /* 256 bytes ~ 2.7ms @ 921600 baud */
+#define UARTRX_RING_MASK  (UARTRX_RING_SIZE - 1)
+#define UARTRX_DMA_COUNT  0x0FFFFFFFu  /* Max transfer count, ~48 minutes of line data */
+#define UARTRX_DMA_REARM  0x00100000u  /* Restart the count below this */
+#define UARTRX_POLL_US    500          /* Worker period */
 
 /* Functions from uart.c */
 void init_uart(void);
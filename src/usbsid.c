@@ -34,12 +34,16 @@
 #include <dma.h>
 #include <bus.h>
 #include <uart.h>
+#include <arena.h>
 #include <vu.h>
 #include <mcu.h>
 #include <sid.h>
 #include <sid_tests.h>
 #include <midi.h>
+#include <midi_handler.h>
+#include <midi_sequencer.h>
 #include <asid.h>
+#include <sid_upload.h>
 #include <logging.h>
 
 
@@ -78,6 +82,10 @@ volatile bool sid_change_unacknowledged = true;
 const bool detected_sid_change = false;
 #endif
 
+/* Staged boot */
+volatile BootStage boot_stage = BOOT_HARDWARE;
+volatile uint32_t boot_connect_ms = 0, boot_mount_ms = 0, boot_ready_ms = 0;
+
 /* Cynthcart emulator */
 #if defined(ONBOARD_EMULATOR)
 #include <emudore_emulator.h>
@@ -95,10 +103,12 @@ volatile bool sidplayer_playing = false;
 volatile bool sidplayer_stop = false;
 volatile bool sidplayer_next = false;
 volatile bool sidplayer_prev = false;
-uint8_t * sidfile = NULL; /* Temporary buffer to store incoming data */
+uint8_t * sidfile = NULL; /* Incoming file image, in the mode arena or the flash tune cache */
 volatile int sidfile_size = 0;
 volatile char tuneno = 0;
 volatile bool is_prg = false; /* Default to SID file */
+volatile bool sidfile_in_flash = false; /* sidfile points at the flash tune cache, not the mode arena */
+volatile bool sidfile_loading = false; /* Core 1 is reading sidfile, don't touch the arena */
 #endif /* ONBOARD_SIDPLAYER */
 
 /* Queues */
@@ -230,6 +240,10 @@ void __no_inline_not_in_flash_func(process_buffer)(volatile uint8_t * itf, volat
     && (command != COMMAND)
     && ((subcommand != CYCLED_READ)
       && (subcommand != DELAY_CYCLES))) { return; };  /* Drop incoming data if in reset state */
+  if __us_unlikely(!boot_ready()
+    && !((command == COMMAND)
+      && (subcommand == CONFIG)
+      && boot_allows_config(sid_buffer[1]))) { return; };  /* Drop incoming data until core 1 finished the SID bring-up */
 
   if __us_unlikely(config_unacknowledged()) {
     goto SIDCHANGEDETECTED; /* Skip to command sequence of unacknowledged */
@@ -363,6 +377,10 @@ void tud_mount_cb(void)
   /* usDBG("[%s]\n", __func__); */
   usNFO("[CDC] Mount\n");
   usb_connected = 1;
+  if (boot_mount_ms == 0) {
+    boot_mount_ms = to_ms_since_boot(get_absolute_time());
+    usBOOT("USB mounted %lums after boot\n", boot_mount_ms);
+  }
 }
 
 void tud_umount_cb(void)
@@ -370,7 +388,7 @@ void tud_umount_cb(void)
   usb_connected = 0, usbdata = 0, dtype = rtype = ntype;
   /* usDBG("[%s]\n", __func__); */
   usNFO("[CDC] Unmount\n");
-  disable_sid();  /* NOTICE: Testing if this is causing the random lockups */
+  if (boot_ready()) disable_sid();  /* NOTICE: Testing if this is causing the random lockups ~ core 1 owns the SID's during boot */
 }
 
 void tud_suspend_cb(bool remote_wakeup_en)
@@ -393,13 +411,11 @@ void tud_resume_cb(void)
 void midi_task(void) /* Disabled in loop ~ keeping for optional later use */
 { /* Same as the callback routine */
   if (tud_midi_n_mounted(MIDI_ITF)) {
-    while (tud_midi_n_available(MIDI_ITF, MIDI_CABLE)) {  /* Loop as long as there is data available */
+    uint8_t packet[4];
+    while (tud_midi_n_packet_read(MIDI_ITF, packet)) {  /* Loop as long as there are event packets available */
       usbdata = 1;
-      uint32_t available = tud_midi_n_stream_read(MIDI_ITF, MIDI_CABLE, midimachine.usbstreambuffer, MAX_BUFFER_SIZE);  /* Reads all available bytes at once */
-      process_stream(midimachine.usbstreambuffer, available);
+      process_packet(packet);
     }
-    /* Clear usb buffer after use ~ Disabled due to prematurely cut off tunes */
-    /* memset(midimachine.usbstreambuffer, 0, count_of(midimachine.usbstreambuffer)); */
     return;
   }
   return;
@@ -408,13 +424,12 @@ void midi_task(void) /* Disabled in loop ~ keeping for optional later use */
 void tud_midi_rx_cb(uint8_t itf)
 {
   if (tud_midi_n_mounted(itf)) {
-    while (tud_midi_n_available(itf, MIDI_CABLE)) {  /* Loop as long as there is data available */
+    uint8_t packet[4];
+    while (tud_midi_n_packet_read(itf, packet)) {  /* Loop as long as there are event packets available */
+      if __us_unlikely(!boot_ready()) continue;  /* Drain and drop until boot is done */
       usbdata = 1;
-      uint32_t available = tud_midi_n_stream_read(itf, MIDI_CABLE, midimachine.usbstreambuffer, MAX_BUFFER_SIZE);  /* Reads all available bytes at once */
-      process_stream(midimachine.usbstreambuffer, available);
+      process_packet(packet);  /* Complete messages are dispatched directly from the packet */
     }
-    /* Clear usb buffer after use ~ Disabled due to prematurely cut off tunes */
-    /* memset(midimachine.usbstreambuffer, 0, count_of(midimachine.usbstreambuffer)); */
     return;
   }
   return;
@@ -622,9 +637,68 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_requ
 
 /* MAIN */
 
+/**
+ * @brief Slow part of the boot, runs on core 1 while core 0 serves USB
+ * @note regulators and detection sleep for seconds, the host can poll
+ *       READ_BOOTSTATE meanwhile, everything else is dropped until ready
+ */
+static void boot_sid_bringup(void)
+{
+  /* Init SID states */
+  usBOOT("<CORE 1> Init SID states\n");
+  boot_stage = BOOT_SIDSTATES;
+  init_sid_states(); /* NOTE: Detecting SID types require 9v to be enabled for all MOS SID types */
+
+  /* Check for default config bit */
+  boot_stage = BOOT_DETECT;
+#if PCB_VERSION_INT >= 15
+  /* Only run autodetect sequence if not already waiting for confirmation */
+  if (!usbsid_config.need_confirmation) {
+    detect_default_config(); /* Saves config, always */
+  }
+#else
+  detect_default_config(); /* Saves config, always */
+#endif
+
+  /* No need to reset SID registers or resetting the SID's
+     at this point on boot on pre v1.4 boards */
+
+#if PCB_VERSION_INT >= 15
+  boot_stage = BOOT_VERIFY;
+  verify_socket_config();
+#endif
+  /* Print config once at end of boot routine
+     detected_sid_change is always false on pre v1.5 boards */
+  if (!detected_sid_change) print_config();
+
+  {
+    usNFO("\n");
+#ifdef ONBOARD_EMULATOR
+    usDBG("Firmware is compiled with Cynthcart support\n");
+#endif
+#ifdef ONBOARD_SIDPLAYER
+    usDBG("Firmware is compiled with onboard SID player\n");
+#endif
+    if (!detected_sid_change) {
+      usDBG("%s v%s Started successfully\n\n", us_product, project_version);
+    } else {
+      usDBG("%s v%s\n", us_product, project_version);
+      usWRN("Please verify socket configuration before further use!\n\n");
+    }
+  }
+
+  boot_ready_ms = to_ms_since_boot(get_absolute_time());
+  __dmb();  /* Data Memory Barrier - everything above is visible before ready */
+  boot_stage = BOOT_READY;
+  usBOOT("<CORE 1> Boot ready %lums after boot, USB connected after %lums\n",
+    boot_ready_ms, boot_connect_ms);
+  return;
+}
+
 /* Multicore sync using atomic memory (avoids semaphore spin locks AND
  * FIFO which is consumed by flash_safe_execute IRQ handler)
  *
+ * Core 0 -> init flash safe execute
  * Core 0 -> launch core 1
  * Core 0 -> poll for SYNC_CORE1_STAGE1
  * Core 1 -> init flash safe execute
@@ -637,11 +711,13 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_requ
  * Core 1 -> set SYNC_CORE1_STAGE2
  * Core 1 -> poll for SYNC_CORE0_STAGE2
  * Core 0 -> init GPIO, SID clock, PIO, DMA, etc.
- * Core 0 -> boot finished uart log
  * Core 0 -> set SYNC_CORE0_STAGE2
- * Core 0 -> enter while loop
+ * Core 0 -> connect USB and enter while loop
+ * Core 1 -> SID states, detection and socket verification
+ * Core 1 -> boot finished uart log, set BOOT_READY
  * Core 1 -> enter while loop
  */
+
 void core1_main(void)
 {
   /* Set core locking for flash saving ~ note this makes SIO_IRQ_PROC1 unavailable */
@@ -694,6 +770,9 @@ void core1_main(void)
   }
   __dmb();  /* Data Memory Barrier after read */
 
+  /* USB is up, do the slow SID bring-up */
+  boot_sid_bringup();
+
   while (1) {
 
     if (get_reset_state()) continue;
@@ -720,6 +799,8 @@ void core1_main(void)
 
 #ifdef ONBOARD_SIDPLAYER
     if (sidplayer_init) {
+      sidfile_loading = true;  /* Before clearing init, an upload checks both */
+      __dmb();  /* Data Memory Barrier */
       sidplayer_init = false;
       sidplayer_start = false;
       sidplayer_playing = false;
@@ -730,8 +811,10 @@ void core1_main(void)
         load_sidtune(sidfile, sidfile_size, tuneno);
       }
       sidplayer_start = true;
-      free(sidfile);
+      if (!sidfile_in_flash) arena_release(ARENA_SIDPLAYER);
       sidfile = NULL;
+      sidfile_in_flash = false;
+      sidfile_loading = false;
     }
     if (sidplayer_start) {
       sidplayer_init = false;
@@ -774,6 +857,7 @@ void core1_main(void)
       start_cynthcart();
     }
     if (emulator_running && !starting_emulator) {
+      emulator_midi_pump();
       run_cynthcart();
     }
 #endif /* ONBOARD_EMULATOR */
@@ -822,12 +906,16 @@ int main()
     .speed = TUSB_SPEED_FULL
   };
   tusb_init(BOARD_TUD_RHPORT, &dev_init);
-  tud_disconnect();  /* Keep USB invisible to host during boot — set_base_voltages sleeps up to 4.5s */
+  tud_disconnect();  /* Keep USB invisible to host until the bus is up, the slow SID bring-up runs after connecting */
   /* Init logging */
   init_logging();
   /* Log reset reason */
   reset_reason();
 
+  /* Core 1 saves the config during the SID bring-up while core 0 runs USB from flash
+     ~ note this makes SIO_IRQ_PROC0 unavailable */
+  flash_safe_execute_core_init();
+
   /* Launch Core 1 and wait for flash_safe_execute_core_init to complete */
   usBOOT("CORE0 Launching core1\n");
   multicore_launch_core1(core1_main);
@@ -848,6 +936,12 @@ int main()
   if (err != CFG_OK) {
     usERR("%s\n", config_error_str(err));
   };
+  /* Retune clk_sys for an integer PHI1 divider before anything derives from it */
+  if (mcu_tune_sysclock(usbsid_config.clock_rate)) {
+#if defined(USBSID_UART)
+    uart_set_baudrate(uart0, BAUD_RATE);  /* clk_peri follows clk_sys */
+#endif
+  }
 
   /* Log boot CPU and C64 clock speeds */
   cpu_mhz = (clock_get_hz(clk_sys) / 1000 / 1000);
@@ -925,55 +1019,17 @@ int main()
   usBOOT("Initialise ASID\n");
   asid_init();
 
-  /* Init SID states */
-  usBOOT("Init SID states\n");
-  init_sid_states(); /* NOTE: Detecting SID types require 9v to be enabled for all MOS SID types */
-
-  /* Check for default config bit */
-#if PCB_VERSION_INT >= 15
-  /* Only run autodetect sequence if not already waiting for confirmation */
-  if (!usbsid_config.need_confirmation) {
-    detect_default_config(); /* Saves config, always */
-  }
-#else
-  detect_default_config(); /* Saves config, always */
-#endif
-
-  /* No need to reset SID registers or resetting the SID's
-     at this point on boot on pre v1.4 boards */
-
-#if PCB_VERSION_INT >= 15
-  verify_socket_config();
-#endif
-  /* Print config once at end of boot routine
-     detected_sid_change is always false on pre v1.5 boards */
-  if (!detected_sid_change) print_config();
-
-  {
-    usNFO("\n");
-#ifdef ONBOARD_EMULATOR
-    usDBG("Firmware is compiled with Cynthcart support\n");
-#endif
-#ifdef ONBOARD_SIDPLAYER
-    usDBG("Firmware is compiled with onboard SID player\n");
-#endif
-    if (!detected_sid_change) {
-      usDBG("%s v%s Started successfully\n\n", us_product, project_version);
-    } else {
-      usDBG("%s v%s\n", us_product, project_version);
-      usWRN("Please verify socket configuration before further use!\n\n");
-    }
-  }
+  /* Bus ready - allow host to enumerate, core 1 finishes the SID bring-up */
+  if (!tud_connect()) usERR("!! USB CONNECTION ERROR !!");
+  boot_connect_ms = to_ms_since_boot(get_absolute_time());
+  usBOOT("<CORE 0> USB connected %lums after boot\n", boot_connect_ms);
 
-  /* Signal Core 1 to enter main loop (sync point 2) */
+  /* Signal Core 1 to start the SID bring-up (sync point 2) */
   usBOOT("<CORE 0> Signaling core1 ~ 2\n");
   core_sync_state = SYNC_CORE0_STAGE2;
   __dsb();  /* Data Synchronisation Barrier - ensures store completes before SEV */
   __sev();  /* Signal event to wake Core 1 from WFE */
 
-  /* All hardware ready - allow host to enumerate */
-  if (!tud_connect()) usERR("!! USB CONNECTION ERROR !!");
-
   /* Loop IO tasks forever */
   while (1) {
     tud_task_ext(0, false);  /* equals tud_task(); timout_ms already at 0 and is _always_ discarded in osal_none.h */
@@ -983,6 +1039,14 @@ int main()
 #ifndef USE_VENDOR_CALLBACK
     vendor_task();  /* Only use this if buffering and fifo are enabled */
 #endif
+    if __us_likely(boot_ready()) {
+      asid_telemetry_task();  /* Sends ASID buffer health on MIDI IN when due */
+      midi_modulation_task();  /* Steps MIDI LFOs and envelopes at raster rate */
+      midi_sequencer_task();   /* Hands arpeggiator & sequencer notes to the bus ahead of their cycle */
+#if defined(ONBOARD_SIDPLAYER)
+      sid_upload_task();       /* Copies a committed upload to the flash tune cache */
+#endif
+    }
 
     if (offload_ledrunner) {
       led_runner();
@@ -74,6 +74,8 @@ extern uint8_t * sidfile; /* Temporary buffer to store incoming data */
 extern volatile int sidfile_size;
 extern volatile char tuneno;
 extern volatile bool is_prg;
+extern volatile bool sidfile_in_flash; /* sidfile points at the flash tune cache instead of the mode arena */
+extern volatile bool sidfile_loading;
 #endif /* ONBOARD_SIDPLAYER */
 
 /* Runtime flags intercore changeable */
@@ -83,6 +85,24 @@ extern volatile bool offload_ledrunner;
 extern volatile bool detected_sid_change, sid_change_unacknowledged;
 #endif
 
+/* Staged boot from usbsid.c
+ *
+ * USB connects as soon as the bus, PIO and DMA are up, the slow SID bring-up
+ * (regulators, detection and socket verification) runs on core 1 after that.
+ * Until boot_stage reaches BOOT_READY all SID data is dropped and only the
+ * read only config commands are answered, see boot_allows_config.
+ */
+typedef enum {
+  BOOT_HARDWARE = 0,  /* Core 0 bus, PIO & DMA init, USB not connected yet */
+  BOOT_SIDSTATES,     /* Core 1 powering and resetting the SID's */
+  BOOT_DETECT,        /* Core 1 detecting the default config */
+  BOOT_VERIFY,        /* Core 1 verifying the socket config (v1.5+ boards only) */
+  BOOT_READY,         /* Everything done, data is accepted */
+} BootStage;
+extern volatile BootStage boot_stage;
+extern volatile uint32_t boot_connect_ms, boot_mount_ms, boot_ready_ms;
+#define boot_ready() (boot_stage == BOOT_READY)
+
 /* Inter-core queues */
 extern queue_t sidtest_queue;
 extern queue_t logging_queue;